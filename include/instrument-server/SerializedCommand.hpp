@@ -2,6 +2,7 @@
 #include "instrument-server/export.h"
 
 #include <chrono>
+#include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -25,6 +26,12 @@ struct INSTRUMENT_SERVER_API SerializedCommand {
   // Synchronization fields
   std::optional<uint64_t> sync_token; // Groups commands in parallel block
   bool is_sync_barrier{false};        // Marks end of sync group
+
+  // Shared-memory barrier ticket (ipc::SharedBarrierTable). When set, the
+  // worker waits at this slot after the command instead of exchanging
+  // SYNC_ACK/SYNC_CONTINUE with the server.
+  std::optional<uint32_t> barrier_slot;
+  uint32_t barrier_epoch{0};
 };
 
 struct INSTRUMENT_SERVER_API CommandResponse {
@@ -41,6 +48,9 @@ struct INSTRUMENT_SERVER_API CommandResponse {
   std::string buffer_id;
   uint64_t element_count{0};
   std::string data_type;
+  // Server-side reference to the buffer, shared by every copy of this
+  // response and released with the last one. Not serialized.
+  std::shared_ptr<const void> buffer_ref;
 };
 
 } // namespace instserver
@@ -0,0 +1,97 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include "instrument-server/SerializedCommand.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace instserver {
+namespace ipc {
+
+/// Encoding used for COMMAND/RESPONSE payloads on one worker channel
+enum class PayloadCodec {
+  JSON,  // nlohmann::json text (debug fallback)
+  BINARY // compact tagged binary with interned strings
+};
+
+/// Parse a codec name ("json" / "binary")
+INSTRUMENT_SERVER_API std::optional<PayloadCodec>
+parse_payload_codec(const std::string &name);
+
+/// Codec name as used in configuration files
+INSTRUMENT_SERVER_API const char *payload_codec_name(PayloadCodec codec);
+
+/// First byte of every binary payload. JSON payloads always start with '{',
+/// so a receiver can tell the codecs apart without negotiation state.
+constexpr uint8_t BINARY_CODEC_MAGIC = 0xB1;
+
+/// True if payload was produced by BinaryEncoder
+INSTRUMENT_SERVER_API bool is_binary_payload(const std::string &payload);
+
+/// Frame already-encoded payloads (either codec) as one COMMAND_BATCH or
+/// RESPONSE_BATCH payload. Items keep their own magic byte / '{'.
+INSTRUMENT_SERVER_API std::string
+pack_batch(const std::vector<std::string> &payloads);
+
+/// Split a batch payload back into its items.
+/// Throws std::runtime_error on malformed input.
+INSTRUMENT_SERVER_API std::vector<std::string>
+unpack_batch(const std::string &payload);
+
+/// Sending half of the binary codec for one direction of one channel.
+///
+/// Verbs, param keys, instrument names and data types are interned: the
+/// first message that uses a string carries it inline together with a new
+/// ID, later messages carry only the ID. IDs allocated while encoding are
+/// staged until commit() so a message that never reaches the peer (send
+/// timeout) does not leave the two tables out of step; call discard() then.
+/// Not thread-safe; encode + send + commit must happen under one lock.
+class INSTRUMENT_SERVER_API BinaryEncoder {
+public:
+  std::string encode_command(const SerializedCommand &cmd);
+  std::string encode_response(const CommandResponse &resp);
+
+  /// Last encoded message was delivered; keep its new interned strings
+  void commit();
+
+  /// Last encoded message was dropped; forget its new interned strings
+  void discard();
+
+  /// Number of committed interned strings
+  size_t interned_count() const { return ids_.size(); }
+
+  /// Forget every interned string; the peer must start a fresh decoder
+  void reset() {
+    ids_.clear();
+    staged_.clear();
+  }
+
+private:
+  std::unordered_map<std::string, uint32_t> ids_;
+  std::unordered_map<std::string, uint32_t> staged_;
+
+  void put_symbol(std::string &out, const std::string &s);
+};
+
+/// Receiving half of the binary codec; mirrors the peer's BinaryEncoder.
+/// Throws std::runtime_error on malformed input. Not thread-safe.
+class INSTRUMENT_SERVER_API BinaryDecoder {
+public:
+  SerializedCommand decode_command(const std::string &payload);
+  CommandResponse decode_response(const std::string &payload);
+
+  /// Forget every interned string, e.g. when the peer process restarts
+  void reset() { strings_.clear(); }
+
+private:
+  std::vector<std::string> strings_;
+
+  friend struct BinaryReader;
+};
+
+} // namespace ipc
+} // namespace instserver
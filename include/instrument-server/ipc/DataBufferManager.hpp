@@ -3,8 +3,11 @@
 #include "instrument-server/export.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -86,8 +89,14 @@ struct INSTRUMENT_SERVER_API DataBufferMetadata {
 /// Handle to shared memory data buffer
 class INSTRUMENT_SERVER_API DataBuffer {
 public:
+  /// Take ownership of malloc'd memory
   DataBuffer(const std::string &buffer_id, void *data, size_t byte_size,
              DataType data_type, size_t element_count);
+
+  /// View into memory kept alive by `backing` (e.g. a shared memory mapping)
+  DataBuffer(const std::string &buffer_id, void *data, size_t byte_size,
+             DataType data_type, size_t element_count,
+             std::shared_ptr<void> backing, bool read_only);
   ~DataBuffer();
 
   // Non-copyable, movable
@@ -103,6 +112,10 @@ public:
   size_t element_count() const { return element_count_; }
   DataType data_type() const { return data_type_; }
 
+  /// True if mapped read-only (buffer created by another process). Writing
+  /// through the mutable accessors of such a buffer faults.
+  bool read_only() const { return read_only_; }
+
   // Type-safe accessors
   float *as_float32();
   double *as_float64();
@@ -128,11 +141,66 @@ private:
   size_t element_count_;
   DataType data_type_;
   bool owns_memory_;
+  std::shared_ptr<void> backing_;
+  bool read_only_{false};
+};
+
+/// Counters for the segment pool kept by the creating process
+struct BufferPoolStats {
+  uint64_t hits{0};       // Creations served from a pooled segment
+  uint64_t misses{0};     // Creations that needed a new segment
+  uint64_t recycled{0};   // Released segments kept for reuse
+  uint64_t evicted{0};    // Released segments unlinked (pool full)
+  size_t pooled_segments{0};
+  size_t pooled_bytes{0}; // Capacity held by idle pooled segments
 };
 
-/// Manages shared memory buffers for large data transfers
+/// Counters for the live-buffer memory budget
+struct BufferBudgetStats {
+  size_t budget_bytes{0};   // 0 = unlimited
+  size_t resident_bytes{0}; // Live buffers held in shared memory
+  size_t spilled_bytes{0};  // Live buffers moved to spill files
+  uint64_t spills{0};
+  uint64_t restores{0};   // Spilled buffers mapped back by get_buffer()
+  uint64_t waits{0};      // Creations that had to wait for room
+  uint64_t rejections{0}; // Creations refused once the wait timed out
+};
+
+/// Manages shared memory buffers for large data transfers.
+///
+/// Each buffer is a named shared memory object (the name is the buffer ID)
+/// holding a small metadata header followed by the samples. The process that
+/// creates a buffer (normally a worker) owns it; any other process can map the
+/// same pages read-only by ID through get_buffer() or adopt_buffer(). When the
+/// last reference in an attaching process is released, the release handler
+/// registered for the buffer's instrument is called so the owner can drop its
+/// reference too.
+///
+/// On the owner's final release the segment goes back to a pool keyed by
+/// power-of-two size class instead of being unlinked, so repeated
+/// acquisitions of similar sizes reuse already-faulted pages. A reused
+/// segment gets a new buffer ID (`<segment>.g<generation>`); stale IDs no
+/// longer attach. Idle pooled capacity is capped by
+/// INSTRUMENT_SCRIPT_SERVER_BUFFER_POOL_MB (default 256) and counted in
+/// total_memory_usage().
+///
+/// Live buffers can be held to a memory budget
+/// (INSTRUMENT_SCRIPT_SERVER_BUFFER_BUDGET_MB, per process, default
+/// unlimited). An attaching process that could not adopt another buffer of
+/// the same size without going over budget spills its least recently
+/// used adopted buffers that nobody else references to files in the spill
+/// directory and lets the creator free the shared memory; get_buffer() maps
+/// them back. A creating process over budget blocks new buffers until room
+/// frees up or the backpressure timeout expires, then rejects them.
 class INSTRUMENT_SERVER_API DataBufferManager {
 public:
+  /// Called when an attached buffer is no longer referenced in this process
+  using ReleaseHandler = std::function<void(const std::string &buffer_id)>;
+
+  /// Called while a creation waits for budget; should process pending
+  /// buffer releases for up to `wait` (e.g. by draining the IPC queue)
+  using ReclaimHandler = std::function<void(std::chrono::milliseconds wait)>;
+
   static DataBufferManager &instance();
 
   /// Create a new buffer and return its ID
@@ -140,13 +208,42 @@ public:
                             const std::string &command_id, DataType data_type,
                             size_t element_count, const void *data = nullptr);
 
+  /// Reserve a buffer for the caller to fill in place. `*data_out` points at
+  /// the shared pages; the buffer stays invisible to get_buffer() (in this
+  /// and other processes) until commit_buffer(). Returns "" on failure.
+  std::string acquire_buffer(const std::string &instrument_name,
+                             const std::string &command_id,
+                             DataType data_type, size_t element_count,
+                             void **data_out);
+
+  /// Publish a buffer obtained from acquire_buffer()
+  bool commit_buffer(const std::string &buffer_id);
+
+  /// Discard an acquired buffer that was never committed
+  bool abort_buffer(const std::string &buffer_id);
+
   /// Create buffer with metadata
   std::string create_buffer_with_metadata(const DataBufferMetadata &metadata,
                                           const void *data = nullptr);
 
-  /// Get buffer by ID
+  /// Get buffer by ID (increments ref count). Buffers created by another
+  /// process are mapped read-only on first access.
   std::shared_ptr<DataBuffer> get_buffer(const std::string &buffer_id);
 
+  /// Map a buffer created by another process and take one reference to it,
+  /// without handing out a pointer. Drop it with release_buffer().
+  bool adopt_buffer(const std::string &buffer_id);
+
+  /// Route releases of attached buffers from `instrument_name` to `handler`
+  void set_release_handler(const std::string &instrument_name,
+                           ReleaseHandler handler);
+
+  /// Remove handler; waits for an in-flight call to finish
+  void clear_release_handler(const std::string &instrument_name);
+
+  /// Set (or clear, with nullptr) the handler run by blocked creations
+  void set_reclaim_handler(ReclaimHandler handler);
+
   /// Get buffer metadata
   std::optional<DataBufferMetadata>
   get_metadata(const std::string &buffer_id) const;
@@ -157,25 +254,61 @@ public:
   /// List all active buffers
   std::vector<std::string> list_buffers() const;
 
-  /// Get total memory usage
+  /// Get total memory usage, including idle pooled segments
   size_t total_memory_usage() const;
 
-  /// Clear all buffers (for cleanup)
+  /// Snapshot of pool counters
+  BufferPoolStats pool_stats() const;
+
+  /// Cap on idle pooled bytes; 0 disables pooling. Trims the pool if needed.
+  void set_pool_limit(size_t bytes);
+
+  /// Cap on live buffer bytes in this process; 0 means unlimited
+  void set_memory_budget(size_t bytes);
+
+  /// Directory for spilled buffers; should be on disk, not tmpfs
+  void set_spill_directory(const std::string &directory);
+
+  /// How long a creation over budget waits before it is rejected
+  void set_backpressure_timeout(std::chrono::milliseconds timeout);
+
+  /// Snapshot of budget counters
+  BufferBudgetStats budget_stats() const;
+
+  /// Clear all buffers and empty the pool (for cleanup)
   void clear_all();
 
 private:
-  DataBufferManager() = default;
+  DataBufferManager();
+
+  /// Shared memory backing of a buffer this process created
+  struct OwnedSegment {
+    std::string name;       // Shared memory object name
+    uint32_t generation{0}; // Bumped on each reuse; part of the buffer ID
+    size_t capacity{0};     // Usable bytes after the header
+    std::shared_ptr<void> region;
+  };
 
   struct BufferEntry {
     std::shared_ptr<DataBuffer> buffer;
     DataBufferMetadata metadata;
     std::atomic<uint32_t> ref_count;
+    bool attached;  // Mapped from another process's segment
+    bool committed; // False between acquire_buffer() and commit_buffer()
+    OwnedSegment segment; // Empty when attached
+    bool adopted{false};  // One reference is held by the manager itself
+    bool spilled{false};  // Data lives in spill_path, not shared memory
+    bool spilling{false}; // Being written out; spill aborts if referenced
+    std::string spill_path;
+    uint64_t last_used{0}; // For LRU spill order
 
     // Constructor to initialize atomic properly
     BufferEntry(std::shared_ptr<DataBuffer> buf, DataBufferMetadata meta,
-                uint32_t initial_ref_count)
+                uint32_t initial_ref_count, bool is_attached = false,
+                bool is_committed = true)
         : buffer(std::move(buf)), metadata(std::move(meta)),
-          ref_count(initial_ref_count) {}
+          ref_count(initial_ref_count), attached(is_attached),
+          committed(is_committed) {}
 
     // Explicitly delete copy operations
     BufferEntry(const BufferEntry &) = delete;
@@ -186,11 +319,79 @@ private:
     BufferEntry &operator=(BufferEntry &&) = delete;
   };
 
+  using BufferMap = std::unordered_map<std::string, BufferEntry>;
+
+  /// What is left of an entry once removed from the map; cleaned up
+  /// outside the lock
+  struct RetiredEntry {
+    std::string buffer_id;
+    std::string instrument_name;
+    bool attached{false};
+    bool spilled{false};
+    std::string spill_path;
+    OwnedSegment segment;
+  };
+
   mutable std::mutex mutex_;
-  std::unordered_map<std::string, BufferEntry> buffers_;
+  BufferMap buffers_;
   std::atomic<uint64_t> next_buffer_id_{1};
 
+  // Budget state, guarded by mutex_
+  size_t budget_bytes_{0};
+  std::string spill_dir_;
+  std::chrono::milliseconds backpressure_timeout_;
+  size_t resident_bytes_{0};
+  uint64_t use_clock_{0};
+  BufferBudgetStats budget_stats_;
+  std::condition_variable budget_cv_;
+
+  std::mutex reclaim_mutex_;
+  ReclaimHandler reclaim_handler_;
+
+  std::mutex handlers_mutex_;
+  std::unordered_map<std::string, ReleaseHandler> release_handlers_;
+
+  mutable std::mutex pool_mutex_;
+  std::unordered_map<size_t, std::vector<OwnedSegment>> pool_;
+  size_t pool_limit_bytes_;
+  BufferPoolStats pool_stats_;
+
   std::string generate_buffer_id();
+
+  /// Take a pooled segment or create one, then write its header (not yet
+  /// marked valid). Fills metadata.buffer_id. Returns nullptr on failure.
+  std::shared_ptr<DataBuffer> allocate_segment(DataBufferMetadata &metadata,
+                                               OwnedSegment &segment,
+                                               bool zero_fill);
+
+  /// Return a released segment to the pool, or unlink it if full
+  void recycle_segment(OwnedSegment segment);
+
+  /// Map an existing segment read-only; nullptr if it does not exist
+  std::shared_ptr<DataBuffer> attach_segment(const std::string &buffer_id,
+                                             DataBufferMetadata &metadata);
+
+  /// Erase an entry and update accounting; caller holds mutex_
+  RetiredEntry take_entry(BufferMap::iterator it);
+
+  /// Drop an entry's backing: recycle if owned, notify creator if attached,
+  /// delete the file if spilled
+  void retire_entry(RetiredEntry entry);
+
+  /// Account `bytes` of new live data, waiting for room if over budget.
+  /// False if the wait timed out.
+  bool reserve_budget(size_t bytes);
+
+  /// Spill idle adopted buffers until `incoming` more bytes fit the budget
+  void enforce_budget(size_t incoming = 0);
+
+  /// Write one buffer to its spill file and drop the shared memory
+  void spill_buffer(const std::string &buffer_id,
+                    std::shared_ptr<DataBuffer> buffer);
+
+  /// Map a spill file read-only; nullptr on failure
+  static std::shared_ptr<DataBuffer>
+  map_spill_file(const std::string &path, const DataBufferMetadata &metadata);
 };
 
 } // namespace ipc
@@ -30,6 +30,41 @@ data_buffer_create(const char *instrument_name, const char *command_id,
                    uint8_t data_type, size_t element_count, const void *data,
                    char *buffer_id_out);
 
+/**
+ * Reserve a data buffer to be filled in place (e.g. by reading from the
+ * instrument directly into it), avoiding a staging allocation and copy
+ * @param instrument_name Name of the instrument
+ * @param command_id Command that generates this data
+ * @param data_type Type of data (0=float32, 1=float64, 2=int32, etc.)
+ * @param element_count Number of elements
+ * @param data_out Receives a writable pointer to element_count elements.
+ * The contents are unspecified (the memory may be recycled from an earlier
+ * buffer); valid until the buffer is released or aborted
+ * @param buffer_id_out Output buffer for the generated buffer ID (must be at
+ * least 128 bytes)
+ * @return 0 on success, -1 on failure
+ *
+ * The buffer cannot be seen by the server until data_buffer_commit() is
+ * called. On error paths call data_buffer_abort() instead.
+ */
+INSTRUMENT_SERVER_API int
+data_buffer_acquire(const char *instrument_name, const char *command_id,
+                    uint8_t data_type, size_t element_count, void **data_out,
+                    char *buffer_id_out);
+
+/**
+ * Publish a buffer filled after data_buffer_acquire(). The pointer must not
+ * be written after this call.
+ * @return 0 on success, -1 if the ID is unknown
+ */
+INSTRUMENT_SERVER_API int data_buffer_commit(const char *buffer_id);
+
+/**
+ * Discard a buffer from data_buffer_acquire() that was never committed
+ * @return 0 on success, -1 if the ID is unknown or already committed
+ */
+INSTRUMENT_SERVER_API int data_buffer_abort(const char *buffer_id);
+
 /**
  * Get total memory usage of all buffers
  */
@@ -0,0 +1,72 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace instserver {
+namespace ipc {
+
+/// One server thread that waits on every worker channel at once.
+///
+/// Each worker rings a doorbell (an eventfd inherited at spawn) after it
+/// puts a frame on its response queue, and the kernel makes a pidfd
+/// readable when the worker exits. The reactor sleeps in epoll_wait on all
+/// of them, so idle instruments cost no wakeups and a dead worker is noticed
+/// immediately rather than at the next heartbeat check. Linux only; on
+/// other platforms supported() is false and callers poll their queues.
+class INSTRUMENT_SERVER_API EventReactor {
+public:
+  struct Handlers {
+    std::function<void()> on_readable; // Doorbell rang; drain the queue
+    std::function<void()> on_exit;     // Worker exited; called once
+  };
+
+  static EventReactor &instance();
+
+  /// True if doorbells and the reactor thread are available here
+  static bool supported();
+
+  /// New doorbell descriptor (close-on-exec, non-blocking), or -1
+  static int make_doorbell();
+
+  /// Wake whoever waits on `fd`; safe from any process holding it
+  static void ring_doorbell(int fd);
+
+  /// Watch `doorbell_fd` and optionally `exit_fd` (-1 to skip) for `owner`.
+  /// The reactor does not take ownership of the descriptors.
+  bool add(const void *owner, int doorbell_fd, int exit_fd,
+           Handlers handlers);
+
+  /// Stop watching `owner`. Waits for a callback already running for it,
+  /// so the owner may be destroyed afterwards. Must not be called from
+  /// one of the owner's own callbacks.
+  void remove(const void *owner);
+
+private:
+  EventReactor() = default;
+
+  struct Watch {
+    int doorbell_fd{-1};
+    int exit_fd{-1};
+    Handlers handlers;
+  };
+
+  int epoll_fd_{-1};
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable idle_cv_;
+  std::unordered_map<const void *, Watch> watches_;
+  std::unordered_map<int, const void *> fd_owners_;
+  const void *dispatching_{nullptr}; // Owner whose callback is running
+
+  bool start_locked();
+  void run();
+};
+
+} // namespace ipc
+} // namespace instserver
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace instserver {
+namespace ipc {
+
+/// Block while *word == expected, for at most `timeout`. May return early.
+/// The futex is deliberately not FUTEX_PRIVATE: the word lives in shared
+/// memory and the waker is in another process.
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t expected,
+                       std::chrono::nanoseconds timeout) {
+#if defined(__linux__)
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+  ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT,
+          expected, &ts, nullptr, 0);
+#else
+  // No cross-process address wait available; fall back to short sleeps.
+  if (word.load(std::memory_order_acquire) == expected) {
+    std::this_thread::sleep_for(
+        std::min<std::chrono::nanoseconds>(timeout,
+                                           std::chrono::microseconds(50)));
+  }
+#endif
+}
+
+/// Wake every process waiting on `word`
+inline void futex_wake_all(std::atomic<uint32_t> &word) {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE,
+          INT32_MAX, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+} // namespace ipc
+} // namespace instserver
@@ -1,13 +1,18 @@
 #pragma once
 #include "instrument-server/export.h"
 
+#include <cstddef>
 #include <cstdint>
-#include <cstring>
+#include <string>
 
 namespace instserver {
 namespace ipc {
 
-constexpr size_t IPC_MAX_PAYLOAD = 4096;
+/// Largest single frame (header + body) placed on a queue
+constexpr size_t IPC_MAX_FRAME = 4096;
+
+/// Upper bound on a reassembled payload; larger sends are rejected
+constexpr size_t IPC_MAX_MESSAGE_SIZE = 64 * 1024 * 1024;
 
 /// IPC message types
 struct INSTRUMENT_SERVER_API IPCMessage {
@@ -16,22 +21,41 @@ struct INSTRUMENT_SERVER_API IPCMessage {
     RESPONSE = 2,
     HEARTBEAT = 3,
     SHUTDOWN = 4,
-    SYNC_ACK = 5,     // Worker -> Server:  "I finished sync command"
-    SYNC_CONTINUE = 6 // Server -> Worker: "All workers ready, proceed"
+    SYNC_ACK = 5,       // Worker -> Server:  "I finished sync command"
+    SYNC_CONTINUE = 6,  // Server -> Worker: "All workers ready, proceed"
+    BUFFER_RELEASE = 7, // Server -> Worker: "Done with data buffer <payload>"
+    COMMAND_BATCH = 8,  // Server -> Worker: several commands, run in order
+    RESPONSE_BATCH = 9  // Worker -> Server: their responses, same order
   };
 
   Type type;
   uint64_t id;         // Message/command ID
   uint64_t sync_token; // For synchronization across instruments
-  uint32_t payload_size;
-  char payload[IPC_MAX_PAYLOAD];
+  std::string payload; // Variable length; split into frames on the wire
+
+  IPCMessage() : type(Type::COMMAND), id(0), sync_token(0) {}
+};
 
-  IPCMessage() : type(Type::COMMAND), id(0), sync_token(0), payload_size(0) {
-    std::memset(payload, 0, sizeof(payload));
-  }
+/// Frame flags
+constexpr uint32_t IPC_FRAME_MORE = 1u << 0;         // More frames follow
+constexpr uint32_t IPC_FRAME_CONTINUATION = 1u << 1; // Not the first frame
+
+/// Fixed header preceding every frame body on the wire. A message whose
+/// payload does not fit in one frame is sent as consecutive frames sharing
+/// type/id/sync_token; total_size lets the receiver reserve once.
+struct IPCFrameHeader {
+  uint32_t type;
+  uint32_t flags;
+  uint64_t id;
+  uint64_t sync_token;
+  uint32_t total_size; // Payload bytes across all frames
+  uint32_t body_size;  // Payload bytes in this frame
 };
 
-static_assert(sizeof(IPCMessage) <= 8192, "IPCMessage too large for SHM");
+static_assert(sizeof(IPCFrameHeader) == 32, "IPCFrameHeader layout changed");
+
+/// Payload bytes that fit in one frame
+constexpr size_t IPC_MAX_FRAME_BODY = IPC_MAX_FRAME - sizeof(IPCFrameHeader);
 
 } // namespace ipc
 } // namespace instserver
@@ -15,6 +15,9 @@
 namespace instserver {
 namespace ipc {
 
+/// Descriptor number a worker's doorbell is inherited as
+constexpr int WORKER_DOORBELL_FD = 3;
+
 /// Manages worker process lifecycle
 class INSTRUMENT_SERVER_API ProcessManager {
 public:
@@ -32,11 +35,15 @@ public:
   ~ProcessManager();
 
   /// Spawn worker process
-  /// Returns process ID on success, 0 on failure
+  /// Returns process ID on success, 0 on failure. A doorbell_fd >= 0 is
+  /// passed to the worker as WORKER_DOORBELL_FD (POSIX only). extra_args
+  /// are appended to the worker's command line.
   ProcessId
   spawn_worker(const std::string &instrument_name,
                const std::string &plugin_path,
-               const std::string &worker_executable = "instrument-worker");
+               const std::string &worker_executable = "instrument-worker",
+               int doorbell_fd = -1,
+               const std::vector<std::string> &extra_args = {});
 
   /// Check if process is alive
   bool is_alive(ProcessId pid) const;
@@ -47,6 +54,10 @@ public:
   /// Wait for process to exit (with timeout)
   bool wait_for_exit(ProcessId pid, std::chrono::milliseconds timeout);
 
+  /// Descriptor that becomes readable when the process exits (Linux pidfd),
+  /// or -1 if unavailable. The caller closes it.
+  int open_exit_fd(ProcessId pid) const;
+
   /// Get process info
   const ProcessInfo *get_process_info(ProcessId pid) const;
 
@@ -79,7 +90,8 @@ private:
   void heartbeat_monitor_loop();
 
   // Platform-specific helpers
-  ProcessId spawn_process_impl(const std::vector<std::string> &args);
+  ProcessId spawn_process_impl(const std::vector<std::string> &args,
+                               int doorbell_fd = -1);
   bool kill_process_impl(ProcessHandle handle, bool force);
   bool is_alive_impl(ProcessHandle handle) const;
 };
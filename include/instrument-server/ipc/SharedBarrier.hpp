@@ -0,0 +1,102 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace instserver {
+namespace ipc {
+
+/// Barrier slots in the shared segment. A parallel block holds one from
+/// dispatch until its responses are in; when all are busy, blocks fall
+/// back to SYNC_ACK/SYNC_CONTINUE.
+constexpr uint32_t SHARED_BARRIER_SLOTS = 256;
+
+/// Most workers one shared barrier can wait for
+constexpr uint32_t SHARED_BARRIER_MAX_PARTICIPANTS = 0xFFFF;
+
+/// One use of a barrier slot. The epoch changes every time the server arms
+/// the slot, so an arrival left over from an earlier use is recognised as
+/// stale instead of being counted.
+struct SharedBarrierTicket {
+  uint32_t slot{0};
+  uint32_t epoch{0};
+};
+
+/// Barrier slots in a shared-memory segment mapped by the server and every
+/// worker. The server arms a slot with the number of participants and
+/// sends each worker the ticket with its last command. The worker arrives
+/// with one atomic add and spins, then futex-waits, until the last arrival
+/// opens the slot; nothing goes through the server in between.
+class INSTRUMENT_SERVER_API SharedBarrierTable {
+public:
+  enum class WaitResult {
+    RELEASED,  // Every participant arrived
+    BROKEN,    // Abandoned by the server or by a participant that timed out
+    STALE,     // The slot has moved on to another use
+    TIMED_OUT, // Gave up waiting; the barrier is now broken for the rest
+  };
+
+  ~SharedBarrierTable();
+
+  SharedBarrierTable(const SharedBarrierTable &) = delete;
+  SharedBarrierTable &operator=(const SharedBarrierTable &) = delete;
+
+  /// The server's table, created on first use. nullptr unless enabled by
+  /// INSTRUMENT_SCRIPT_SERVER_SHARED_BARRIERS, or if the segment could not
+  /// be created.
+  static SharedBarrierTable *server();
+
+  /// Create a table named `name`, replacing any stale one. The creator
+  /// arms and disarms slots and unlinks the segment when destroyed.
+  static std::unique_ptr<SharedBarrierTable> create(const std::string &name);
+
+  /// Map the table `name` created by the server (worker side)
+  static std::unique_ptr<SharedBarrierTable> open(const std::string &name);
+
+  const std::string &name() const { return name_; }
+
+  /// Arm a free slot for `participants` arrivals; nullopt if none is free
+  std::optional<SharedBarrierTicket> arm(uint32_t participants);
+
+  /// Give the slot back. A barrier that has not opened yet is broken first
+  /// so no worker stays parked on it.
+  void disarm(SharedBarrierTicket ticket);
+
+  /// Slots currently armed
+  size_t armed_count() const;
+
+  /// Arrive at the barrier and wait up to `timeout` for the others.
+  /// `on_idle` runs about every `idle_interval` while parked.
+  WaitResult arrive_and_wait(
+      SharedBarrierTicket ticket, std::chrono::milliseconds timeout,
+      const std::function<void()> &on_idle = {},
+      std::chrono::milliseconds idle_interval = std::chrono::milliseconds(100));
+
+private:
+  struct Segment;
+
+  SharedBarrierTable(std::string name, std::shared_ptr<void> region,
+                     Segment *segment, bool owner);
+
+  std::string name_;
+  std::shared_ptr<void> region_;
+  Segment *segment_;
+  bool owner_;
+
+  // Server side: which slots are free and the epoch each is on
+  mutable std::mutex mutex_;
+  std::vector<uint32_t> free_slots_;
+  std::vector<uint32_t> epochs_;
+  std::vector<bool> armed_;
+};
+
+} // namespace ipc
+} // namespace instserver
@@ -5,14 +5,29 @@
 #include "instrument-server/export.h"
 
 #include "instrument-server/ipc/IPCMessage.hpp"
+#include "instrument-server/ipc/SpscRing.hpp"
 
 #include <chrono>
+#include <mutex>
 #include <optional>
 #include <string>
 
 namespace instserver {
 namespace ipc {
 
+/// Underlying IPC mechanism used by a SharedQueue
+enum class QueueTransport {
+  MESSAGE_QUEUE, // boost::interprocess::message_queue (mutex + condvar)
+  SPSC_RING      // lock-free SPSC rings in shared memory, futex wakeup
+};
+
+/// Parse a transport name ("message_queue" / "spsc_ring")
+INSTRUMENT_SERVER_API std::optional<QueueTransport>
+parse_queue_transport(const std::string &name);
+
+/// Transport name as used in configuration files
+INSTRUMENT_SERVER_API const char *queue_transport_name(QueueTransport t);
+
 /// Bidirectional IPC queue pair (request + response queues)
 class INSTRUMENT_SERVER_API SharedQueue {
 public:
@@ -21,31 +36,57 @@ public:
               const std::string &req_name, const std::string &resp_name,
               bool is_server);
 
+  SharedQueue(
+      std::unique_ptr<boost::interprocess::managed_shared_memory> segment,
+      SpscRingPair *rings, const std::string &segment_name, bool is_server);
+
   /// Create/open queue for server (creates both queues)
   static std::unique_ptr<SharedQueue>
-  create_server_queue(const std::string &instrument_name);
+  create_server_queue(const std::string &instrument_name,
+                      QueueTransport transport = QueueTransport::MESSAGE_QUEUE);
 
-  /// Create/open queue for worker (opens existing queues)
+  /// Create/open queue for worker (opens existing queues). The transport is
+  /// whatever the server created: the ring segment is tried first, then the
+  /// message queues.
   static std::unique_ptr<SharedQueue>
   create_worker_queue(const std::string &instrument_name);
 
   /// Close and cleanup queues
   ~SharedQueue();
 
-  /// Send message (non-blocking with timeout)
+  /// Send message (non-blocking with timeout). Payloads larger than one
+  /// frame are split into continuation frames; the timeout covers all of them.
+  /// Safe to call from several threads.
   bool
   send(const IPCMessage &msg,
        std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
 
-  /// Receive message (blocking with timeout)
+  /// Receive message (blocking with timeout), reassembling multi-frame
+  /// payloads. Must only be called from one thread.
   std::optional<IPCMessage>
   receive(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
 
   /// Check if queue is valid
   bool is_valid() const {
+    if (transport_ == QueueTransport::SPSC_RING)
+      return rings_ != nullptr;
     return request_queue_ != nullptr && response_queue_ != nullptr;
   }
 
+  /// Ring `fd` (an eventfd) after every frame this side sends so a peer
+  /// waiting in EventReactor wakes up. -1 disables.
+  void set_doorbell(int fd) { doorbell_fd_ = fd; }
+
+  /// Frames waiting in this side's outbound queue (the request queue on the
+  /// server). Approximate while the peer is receiving.
+  size_t send_depth() const;
+
+  /// Frames the outbound queue can hold
+  size_t send_capacity() const;
+
+  /// Get transport in use
+  QueueTransport transport() const { return transport_; }
+
   /// Get queue names
   std::string get_request_queue_name() const { return request_queue_name_; }
   std::string get_response_queue_name() const { return response_queue_name_; }
@@ -54,11 +95,32 @@ public:
   static void cleanup(const std::string &instrument_name);
 
 private:
+  QueueTransport transport_;
   std::unique_ptr<boost::interprocess::message_queue> request_queue_;
   std::unique_ptr<boost::interprocess::message_queue> response_queue_;
+  std::unique_ptr<boost::interprocess::managed_shared_memory> ring_segment_;
+  SpscRingPair *rings_{nullptr};
   std::string request_queue_name_;
   std::string response_queue_name_;
   bool is_server_;
+  int doorbell_fd_{-1};
+
+  // Serializes senders in this process (frame ordering, single ring producer)
+  std::mutex send_mutex_;
+
+  // Receive-side reassembly state; survives a timeout between frames
+  IPCMessage partial_;
+  uint32_t partial_total_size_{0};
+  bool partial_active_{false};
+
+  boost::interprocess::message_queue *send_queue() const {
+    return is_server_ ? request_queue_.get() : response_queue_.get();
+  }
+
+  bool send_frame(const char *frame, size_t size,
+                  std::chrono::milliseconds timeout);
+  bool receive_frame(char *frame, size_t &size,
+                     std::chrono::milliseconds timeout);
 };
 
 } // namespace ipc
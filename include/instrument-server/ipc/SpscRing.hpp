@@ -0,0 +1,83 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include "instrument-server/ipc/IPCMessage.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace instserver {
+namespace ipc {
+
+/// Size of a cache line; head/tail/wakeup words are padded to this so the
+/// producer and consumer never write to the same line.
+constexpr size_t SPSC_CACHE_LINE = 64;
+
+/// Number of slots in each ring (must be a power of two)
+constexpr uint32_t SPSC_RING_SLOTS = 128;
+
+/// Largest frame a single slot can hold
+constexpr size_t SPSC_SLOT_CAPACITY = IPC_MAX_FRAME;
+
+static_assert((SPSC_RING_SLOTS & (SPSC_RING_SLOTS - 1)) == 0,
+              "SPSC_RING_SLOTS must be a power of two");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "SPSC ring requires lock-free 32-bit atomics in shared memory");
+
+/// Single-producer/single-consumer ring of fixed-size slots, designed to be
+/// placed in shared memory. Exactly one thread (in any process) may push and
+/// exactly one may pop. Neither side takes a lock; an idle consumer or a
+/// producer facing a full ring parks on a futex (Linux) instead of polling.
+struct INSTRUMENT_SERVER_API SpscRing {
+  SpscRing();
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  /// Copy `size` bytes into the next free slot. Returns false if full.
+  bool try_push(const void *data, size_t size);
+
+  /// Push, waiting up to `timeout` for a free slot
+  bool push(const void *data, size_t size, std::chrono::milliseconds timeout);
+
+  /// Copy the oldest slot into `out` (at most `capacity` bytes) and store its
+  /// length in `size`. Returns false if empty.
+  bool try_pop(void *out, size_t capacity, size_t &size);
+
+  /// Pop, waiting up to `timeout` for a message
+  bool pop(void *out, size_t capacity, size_t &size,
+           std::chrono::milliseconds timeout);
+
+  /// Number of messages currently queued (approximate under concurrency)
+  uint32_t size() const;
+
+private:
+  struct Slot {
+    uint32_t size;
+    alignas(8) char data[SPSC_SLOT_CAPACITY];
+  };
+
+  // Producer-owned
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> head_;
+  // Consumer-owned
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> tail_;
+  // Bumped on every push; the consumer futex-waits on it when empty
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> data_seq_;
+  std::atomic<uint32_t> consumer_waiting_;
+  // Bumped on every pop; the producer futex-waits on it when full
+  alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> space_seq_;
+  std::atomic<uint32_t> producer_waiting_;
+
+  alignas(SPSC_CACHE_LINE) Slot slots_[SPSC_RING_SLOTS];
+};
+
+/// The two rings shared between server and one worker
+struct SpscRingPair {
+  SpscRing request;  // server -> worker
+  SpscRing response; // worker -> server
+};
+
+} // namespace ipc
+} // namespace instserver
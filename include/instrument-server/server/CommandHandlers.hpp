@@ -21,6 +21,8 @@ int INSTRUMENT_SERVER_API handle_status(const nlohmann::json &params,
                                         nlohmann::json &out);
 int INSTRUMENT_SERVER_API handle_list(const nlohmann::json &params,
                                       nlohmann::json &out);
+int INSTRUMENT_SERVER_API handle_sync_stats(const nlohmann::json &params,
+                                            nlohmann::json &out);
 int INSTRUMENT_SERVER_API handle_measure(const nlohmann::json &params,
                                          nlohmann::json &out);
 int INSTRUMENT_SERVER_API handle_test(const nlohmann::json &params,
@@ -41,6 +43,8 @@ int INSTRUMENT_SERVER_API handle_job_list(const nlohmann::json &params,
                                           nlohmann::json &out);
 int INSTRUMENT_SERVER_API handle_job_cancel(const nlohmann::json &params,
                                             nlohmann::json &out);
+int INSTRUMENT_SERVER_API handle_job_reprioritize(const nlohmann::json &params,
+                                                  nlohmann::json &out);
 
 } // namespace server
 } // namespace instserver
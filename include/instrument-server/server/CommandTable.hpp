@@ -0,0 +1,53 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace instserver {
+
+/// One parameter of a command, with its type resolved from the io section
+/// when the API definition only references it by name
+struct INSTRUMENT_SERVER_API CommandParamSpec {
+  std::string name;
+  std::string type; // Empty if the API definition does not say
+};
+
+/// Everything the server needs to know about a command to send it
+struct INSTRUMENT_SERVER_API CommandSpec {
+  std::string verb;
+  std::string template_str;
+  std::string channel_group; // Empty unless the command is per channel
+  std::vector<CommandParamSpec> params;
+  bool expects_response{false};           // Command has outputs
+  std::optional<std::string> output;      // First output, if any
+  std::optional<std::string> return_type; // Type of that output
+};
+
+/// Commands of one instrument, built from its API definition when the
+/// instrument is created and never modified afterwards, so lookups need no
+/// lock
+class INSTRUMENT_SERVER_API CommandTable {
+public:
+  /// Build the table for `instrument_name`. Commands that cannot be resolved
+  /// fully are still added, with whatever could be resolved.
+  static std::shared_ptr<const CommandTable>
+  build(const std::string &instrument_name, const nlohmann::json &api_def);
+
+  /// Command `verb`, or nullptr if the API definition has no such command
+  const CommandSpec *find(const std::string &verb) const {
+    auto it = commands_.find(verb);
+    return it == commands_.end() ? nullptr : &it->second;
+  }
+
+  size_t size() const { return commands_.size(); }
+
+private:
+  std::unordered_map<std::string, CommandSpec> commands_;
+};
+
+} // namespace instserver
@@ -0,0 +1,68 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace instserver {
+
+/// One field of a runtime context type
+struct INSTRUMENT_SERVER_API ContextFieldDef {
+  std::string name;
+  std::string type; // Annotation as in lua_types, e.g. "InstrumentTarget[]"
+  std::string description;
+  bool optional{false};
+};
+
+/// One entry of a definitions document's "contexts" object
+struct INSTRUMENT_SERVER_API ContextTypeDef {
+  std::string name; // e.g. "RuntimeContext_DCGetSet"
+  std::string description;
+  std::vector<ContextFieldDef> fields;
+};
+
+/// Problem found in a definitions document or a payload. `path` is a JSON
+/// pointer to the offending value.
+struct INSTRUMENT_SERVER_API ContextTypeError {
+  std::string path;
+  std::string message;
+};
+
+/// Runtime context types a measure job can be handed a payload for. Each
+/// type lists the fields a payload must (or may) set and their types, as
+/// described by schemas/runtime_contexts.schema.json.
+///
+/// Field types are the annotations used in lua_types: number, integer,
+/// string, boolean, InstrumentTarget, Domain, `T[]` for arrays and
+/// `table<string, T>` for maps.
+class INSTRUMENT_SERVER_API ContextTypes {
+public:
+  /// The types described in lua_types/runtime_context_*.lua: dc_getset,
+  /// waveform_1d and waveform_2d
+  static const ContextTypes &builtin();
+
+  /// Read a {"contexts": {...}} definitions document. Entries that break the
+  /// schema, use an unknown field type, or shadow a context method (call,
+  /// bind, parallel, log) are added to `errors` and left out.
+  static ContextTypes from_json(const nlohmann::json &doc,
+                                std::vector<ContextTypeError> &errors);
+
+  /// Type `key`, or nullptr if there is none
+  const ContextTypeDef *find(const std::string &key) const;
+
+  /// Keys of all types, sorted
+  std::vector<std::string> keys() const;
+
+  /// Check that `payload` is an object that sets every required field of
+  /// type `key` with a value of the right type, and nothing else. Returns
+  /// the problems found; empty if the payload is valid.
+  std::vector<ContextTypeError> validate(const std::string &key,
+                                         const nlohmann::json &payload) const;
+
+private:
+  std::map<std::string, ContextTypeDef> types_;
+};
+
+} // namespace instserver
@@ -0,0 +1,60 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include "instrument-server/ipc/DataBufferManager.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace instserver {
+
+/// Read-only view of command return data, handed to scripts in place of a
+/// Lua table. A view of a large-data buffer reads the shared memory pages
+/// directly and holds a reference to the buffer for as long as it (or any
+/// slice of it) lives. Element access and reductions run in C++; values are
+/// read as doubles whatever the stored type.
+class INSTRUMENT_SERVER_API DataHandle {
+public:
+  /// View of buffer `buffer_id`, or nullopt if it cannot be mapped
+  static std::optional<DataHandle> from_buffer(const std::string &buffer_id);
+
+  /// View of an array returned inline in the response
+  explicit DataHandle(std::vector<double> values);
+
+  /// Buffer ID, or empty for inline arrays
+  const std::string &id() const { return buffer_id_; }
+
+  size_t size() const { return count_; }
+
+  /// Name of the stored element type (see ipc::data_type_to_string)
+  const char *data_type() const { return ipc::data_type_to_string(type_); }
+
+  /// Element `index` (0-based), or nullopt if out of range
+  std::optional<double> at(size_t index) const;
+
+  /// Elements [first, first + count), clamped to the data; shares storage
+  DataHandle slice(size_t first, size_t count) const;
+
+  double sum() const;
+  /// Mean, min and max of an empty view are NaN
+  double mean() const;
+  double min() const;
+  double max() const;
+
+  /// Copy out as doubles
+  std::vector<double> to_vector() const;
+
+private:
+  DataHandle() = default;
+
+  std::string buffer_id_;
+  std::shared_ptr<const void> backing_; // Keeps data_ mapped
+  const void *data_{nullptr};
+  ipc::DataType type_{ipc::DataType::FLOAT64};
+  size_t count_{0};
+};
+
+} // namespace instserver
@@ -1,6 +1,7 @@
 #pragma once
 #include "instrument-server/export.h"
 
+#include "instrument-server/server/CommandTable.hpp"
 #include "instrument-server/server/InstrumentWorkerProxy.hpp"
 #include "instrument-server/server/SyncCoordinator.hpp"
 
@@ -9,7 +10,9 @@
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace instserver {
@@ -36,7 +39,9 @@ public:
                                    const std::string &config_json,
                                    const std::string &api_def_json);
 
-  /// Get instrument proxy
+  /// Get instrument proxy. Reads a snapshot of the instrument map without
+  /// taking the registry lock, so it never waits for instruments being
+  /// created or removed.
   std::shared_ptr<InstrumentWorkerProxy>
   get_instrument(const std::string &name);
 
@@ -44,11 +49,18 @@ public:
   std::optional<InstrumentMetadata>
   get_instrument_metadata(const std::string &name) const;
 
+  /// Command table built from the instrument's API definition, or nullptr
+  /// if there is no such instrument. Does not take the registry lock.
+  std::shared_ptr<const CommandTable>
+  command_table(const std::string &name) const;
+
   /// Check if command expects response based on API definition
+  /// (lock-free, via command_table())
   bool command_expects_response(const std::string &instrument_name,
                                 const std::string &verb) const;
 
-  /// Get expected response type for command
+  /// Get expected response type for command (lock-free, via
+  /// command_table())
   std::optional<std::string>
   get_response_type(const std::string &instrument_name,
                     const std::string &verb) const;
@@ -56,7 +68,7 @@ public:
   /// Check if instrument exists
   bool has_instrument(const std::string &name) const;
 
-  /// Remove instrument (stops worker)
+  /// Remove instrument (stops worker, after it has been unpublished)
   void remove_instrument(const std::string &name);
 
   /// Start all instruments
@@ -68,6 +80,10 @@ public:
   /// List all instruments
   std::vector<std::string> list_instruments() const;
 
+  /// Coordinator the instruments' SYNC_ACKs are delivered to. Scripts must
+  /// register their barriers here for ACKs and arrival times to count.
+  SyncCoordinator &sync_coordinator() { return sync_coordinator_; }
+
 private:
   InstrumentRegistry() = default;
   ~InstrumentRegistry() { stop_all(); }
@@ -75,9 +91,42 @@ private:
   InstrumentRegistry(const InstrumentRegistry &) = delete;
   InstrumentRegistry &operator=(const InstrumentRegistry &) = delete;
 
+  // Serializes writers. Readers of instruments_ and command_tables_ never
+  // take it; it also guards metadata_.
   mutable std::mutex mutex_;
-  std::map<std::string, std::shared_ptr<InstrumentWorkerProxy>> instruments_;
+
+  // Instruments by name. The map is never modified once published:
+  // writers copy it under mutex_ and swap in the copy with
+  // std::atomic_store, readers take it with std::atomic_load.
+  using InstrumentMap =
+      std::map<std::string, std::shared_ptr<InstrumentWorkerProxy>>;
+  std::shared_ptr<const InstrumentMap> instruments_ =
+      std::make_shared<const InstrumentMap>();
+
+  // Names whose workers are starting, outside the lock
+  std::set<std::string> starting_;
+  // Bumped by stop_all(), so instruments that finish starting afterwards
+  // are stopped instead of published
+  uint64_t generation_{0};
+
+  // Swap in a new instrument map. Caller holds mutex_.
+  void publish_instruments(std::shared_ptr<const InstrumentMap> instruments);
   std::map<std::string, InstrumentMetadata> metadata_; // NEW: Store metadata
+
+  // Command tables by instrument, published the same way as instruments_
+  using CommandTableMap =
+      std::unordered_map<std::string, std::shared_ptr<const CommandTable>>;
+  std::shared_ptr<const CommandTableMap> command_tables_ =
+      std::make_shared<const CommandTableMap>();
+
+  // Publish `table` for `name`, or withdraw it if null. Caller holds mutex_.
+  void publish_command_table(const std::string &name,
+                             std::shared_ptr<const CommandTable> table);
+
+  // Command `verb` of `instrument_name`, logging why if there is none
+  const CommandSpec *find_command(const CommandTable *table,
+                                  const std::string &instrument_name,
+                                  const std::string &verb) const;
   SyncCoordinator sync_coordinator_;
 };
 
@@ -2,27 +2,43 @@
 #include "instrument-server/export.h"
 
 #include "instrument-server/SerializedCommand.hpp"
+#include "instrument-server/ipc/BinaryCodec.hpp"
 #include "instrument-server/ipc/ProcessManager.hpp"
 #include "instrument-server/ipc/SharedQueue.hpp"
 #include "instrument-server/server/SyncCoordinator.hpp"
 
 #include <atomic>
+#include <condition_variable>
 #include <future>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace instserver {
 
+/// Per-instrument IPC settings (the `ipc` section of the instrument config)
+struct WorkerIpcOptions {
+  ipc::QueueTransport transport{ipc::QueueTransport::MESSAGE_QUEUE};
+  ipc::PayloadCodec codec{ipc::PayloadCodec::BINARY};
+  /// Most request messages outstanding at once (credit window); capped at
+  /// the request queue's capacity when the worker starts
+  size_t window{64};
+};
+
 /// Proxy for communicating with a worker process via IPC
-/// This runs in the main server process
+/// This runs in the main server process. Responses are handled on the shared
+/// ipc::EventReactor thread where available, otherwise on a listener thread
+/// per proxy.
 class INSTRUMENT_SERVER_API InstrumentWorkerProxy {
 public:
   InstrumentWorkerProxy(const std::string &instrument_name,
                         const std::string &plugin_path,
                         const std::string &config_json,
                         const std::string &api_def_json,
-                        SyncCoordinator &sync_coordinator);
+                        SyncCoordinator &sync_coordinator,
+                        const WorkerIpcOptions &ipc_options = {});
 
   ~InstrumentWorkerProxy();
 
@@ -32,9 +48,23 @@ public:
   /// Stop worker process
   void stop();
 
-  /// Execute command (async, returns future)
+  /// Execute command (async, returns future). Waits up to cmd.timeout for a
+  /// free credit when the in-flight window is full; after that the future
+  /// holds an "IPC window full" error.
   std::future<CommandResponse> execute(SerializedCommand cmd);
 
+  /// Execute command without waiting for a credit; returns std::nullopt if
+  /// the in-flight window is full so the caller can back off
+  std::optional<std::future<CommandResponse>>
+  try_execute(SerializedCommand cmd);
+
+  /// Execute several commands in one IPC round trip (async). The worker runs
+  /// them back to back in order and replies with one RESPONSE_BATCH; futures
+  /// are returned in the same order. Commands should share one sync token.
+  /// The batch takes one credit.
+  std::vector<std::future<CommandResponse>>
+  execute_batch(std::vector<SerializedCommand> cmds);
+
   /// Execute command (sync with timeout)
   CommandResponse execute_sync(SerializedCommand cmd,
                                std::chrono::milliseconds timeout);
@@ -51,6 +81,13 @@ public:
     uint64_t commands_completed{0};
     uint64_t commands_failed{0};
     uint64_t commands_timeout{0};
+    uint64_t credit_waits{0};      // execute() calls that found the window full
+    uint64_t window_rejections{0}; // ... and gave up without sending
+    // Current flow-control state, filled in by get_stats()
+    uint64_t in_flight{0};      // Request messages awaiting a response
+    uint64_t peak_in_flight{0}; // Highest in_flight seen
+    uint64_t window{0};         // Credit limit
+    uint64_t queue_depth{0};    // Frames waiting in the request queue
   };
   Stats get_stats() const;
 
@@ -63,16 +100,49 @@ private:
   std::string config_json_;  // JSON as string
   std::string api_def_json_; // JSON as string
   SyncCoordinator &sync_coordinator_;
+  uint32_t sync_id_; // Interned name, used for SYNC_ACK bookkeeping
+  WorkerIpcOptions ipc_options_;
 
   std::unique_ptr<ipc::SharedQueue> ipc_queue_;
   ProcessId worker_pid_{0};
 
+  // Binary codec state; the encoder's intern table must advance in the same
+  // order commands reach the queue, so encode + send run under encode_mutex_
+  ipc::BinaryEncoder encoder_;
+  std::mutex encode_mutex_;
+  ipc::BinaryDecoder decoder_; // reactor / listener thread only
+
+  // A command waiting for its response. The credit is held by the message
+  // that carried it (the command itself, or the first of its batch) and
+  // returned once every command in that message is settled.
+  struct PendingResponse {
+    std::promise<CommandResponse> promise;
+    uint64_t credit_id;
+    // Past this the response is given up on and the credit reclaimed
+    std::chrono::steady_clock::time_point deadline;
+  };
+
   // Pending responses (message_id -> promise)
-  std::unordered_map<uint64_t, std::promise<CommandResponse>>
-      pending_responses_;
+  std::unordered_map<uint64_t, PendingResponse> pending_responses_;
+  // Credits by the message that took them -> its unsettled commands
+  std::unordered_map<uint64_t, size_t> credit_holders_;
+  // Outstanding batches (first message_id -> command count), so a batch the
+  // worker could not read still fails every command in it
+  std::unordered_map<uint64_t, size_t> pending_batches_;
   std::mutex pending_mutex_;
 
-  // Response listener thread
+  // Credit window: request messages sent but not yet answered. A credit is
+  // returned when the last command it covers is settled: answered, failed
+  // to send, abandoned by execute_sync() or overdue.
+  mutable std::mutex window_mutex_;
+  std::condition_variable window_cv_;
+  size_t in_flight_{0};
+  size_t peak_in_flight_{0};
+
+  // Response handling: reactor watch (doorbell + exit fd) or fallback thread
+  int doorbell_fd_{-1};
+  int exit_fd_{-1};
+  bool reactor_watch_{false};
   std::thread response_thread_;
   std::atomic<bool> running_{false};
 
@@ -83,15 +153,41 @@ private:
   // Message ID counter
   std::atomic<uint64_t> next_message_id_{1};
 
+  bool acquire_credit(std::chrono::milliseconds wait);
+  void release_credit();
+  void reset_credits();
+  std::future<CommandResponse> send_command(SerializedCommand cmd,
+                                           uint64_t *msg_id_out = nullptr);
+  std::future<CommandResponse> rejected_command(const SerializedCommand &cmd,
+                                                const std::string &error);
+
+  bool watch_with_reactor();
+  void drain_responses();
+  void on_worker_exit();
+  void stop_listening();
   void response_listener_loop();
   void handle_worker_death();
   void send_shutdown_message();
+  void send_buffer_release(const std::string &buffer_id);
   void stop_worker_process();
   void join_response_thread_with_timeout();
   void cleanup_pending_promises();
   void cleanup_ipc();
   void handle_ipc_message(const ipc::IPCMessage &msg);
   void handle_response_message(const ipc::IPCMessage &msg);
+  void handle_response_batch_message(const ipc::IPCMessage &msg);
+  CommandResponse decode_response_payload(const std::string &payload,
+                                          uint64_t msg_id);
+  void complete_response(uint64_t msg_id, CommandResponse resp);
+  // Fulfil and drop a pending response, returning its message's credit if
+  // it was the last one. Caller holds pending_mutex_; false if not pending.
+  bool settle_pending(uint64_t msg_id, CommandResponse resp);
+  CommandResponse error_response(uint64_t msg_id,
+                                 const std::string &error) const;
+  // Fail pending responses past their deadline; returns how many
+  size_t expire_overdue();
+  void fail_responses(uint64_t first_id, size_t count,
+                      const std::string &error);
   void handle_sync_ack_message(const ipc::IPCMessage &msg);
 };
 
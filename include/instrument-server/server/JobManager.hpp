@@ -1,29 +1,56 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
-#include <deque>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <set>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace instserver {
 namespace server {
 
+// Scheduling class of a queued job. While several classes have jobs waiting,
+// executors start them in roughly an 8:4:1 ratio, so interactive jobs get
+// ahead of long batch sweeps without starving them.
+enum class JobPriority { Interactive = 0, Normal = 1, Batch = 2 };
+
+// "interactive", "normal" or "batch"
+const char *priority_name(JobPriority priority);
+std::optional<JobPriority> priority_from_name(const std::string &name);
+
 struct JobInfo {
   std::string id;
   std::string type;      // e.g., "measure", "sleep"
   nlohmann::json params; // job-specific parameters
   std::string status;    // "queued","running","completed","failed","canceled"
   nlohmann::json result; // result JSON when completed
+  // Data buffers named in result, held for as long as the job record is
+  std::vector<std::shared_ptr<const void>> buffers;
   std::string error;
   std::chrono::system_clock::time_point created_at;
   std::chrono::system_clock::time_point started_at;
   std::chrono::system_clock::time_point finished_at;
+  // Instruments the job holds from start until its commands complete. An
+  // exclusive job may touch any instrument and runs with no other job.
+  std::set<std::string> instruments;
+  bool exclusive{true};
+  JobPriority priority{JobPriority::Normal};
+  // A job still queued at its deadline fails instead of starting
+  std::optional<std::chrono::system_clock::time_point> deadline;
+  // Filled in by list_jobs() for queued jobs: 1-based place in the order
+  // executors will take them, and when the job is expected to start based on
+  // past run times of each job type (instrument conflicts are not modelled)
+  size_t queue_position{0};
+  std::chrono::system_clock::time_point estimated_start;
 };
 
 class JobManager {
@@ -31,6 +58,13 @@ public:
   static JobManager &instance();
 
   // Submit a generic job type. Returns job id.
+  // params["instruments"] (array of instrument names) declares what the job
+  // touches. Without it, a measure job's instruments are inferred from the
+  // string literals passed to call()/bind() in its script, and any other job
+  // is exclusive. Jobs whose instruments are disjoint run concurrently.
+  // params["priority"] names the job's class (default "normal") and
+  // params["deadline_ms"] (ms since the Unix epoch) the latest time it may
+  // start; submit_job throws std::invalid_argument if either is malformed.
   std::string submit_job(const std::string &job_type,
                          const nlohmann::json &params);
 
@@ -51,6 +85,10 @@ public:
   // cancellation is cooperative)
   bool cancel_job(const std::string &job_id);
 
+  // Move a queued job to the back of another priority class. Returns false
+  // if the job is not queued.
+  bool reprioritize_job(const std::string &job_id, JobPriority priority);
+
   // Stop worker thread and cleanup. Safe to call multiple times.
   void stop();
 
@@ -65,17 +103,56 @@ private:
   void worker_loop();
   std::string make_job_id();
 
+  // Take the first queued job that can start, visiting the priority classes
+  // in order of their pass (see ClassQueue) and each class in FIFO order. A
+  // job can start if its instruments are not held and not wanted by a job
+  // visited before it, so jobs sharing an instrument start in that order.
+  // Claims its instruments and marks it running; queued jobs past their
+  // deadline are failed on the way. Returns an empty id if none can start.
+  // Caller holds mutex_.
+  std::string claim_next_job();
+
+  // Give back what claim_next_job() took for `job`, note its run time for
+  // start estimates and wake the executors. Caller holds mutex_.
+  void release_instruments(const JobInfo &job);
+
+  // Append to / unlink from the queue of the job's class. Caller holds mutex_.
+  void enqueue(const JobInfo &job);
+  void dequeue(const JobInfo &job);
+
+  // Fill in queue_position and estimated_start of the queued jobs in `jobs`.
+  // Caller holds mutex_.
+  void estimate_queue(std::vector<JobInfo> &jobs) const;
+
+  // Weighted-fair (stride) scheduling: each start from a class advances its
+  // pass by kStride / weight, and executors serve the class with the lowest
+  // pass first. A class that was empty rejoins at virtual_time_, the pass of
+  // the last start, so idle time earns it no credit.
+  struct ClassQueue {
+    std::list<std::string> jobs; // job ids, oldest first
+    uint64_t pass{0};
+  };
+  static constexpr size_t kPriorityCount = 3;
+  static constexpr uint64_t kStride = 840;
+
   std::mutex mutex_;
   std::condition_variable cv_;
-  std::deque<std::string> queue_; // job ids queued
+  std::array<ClassQueue, kPriorityCount> queues_;
+  // Queued job id -> its node in queues_, for O(1) cancel and reprioritize
+  std::unordered_map<std::string, std::list<std::string>::iterator> queued_;
+  uint64_t virtual_time_{0};
+  // Smoothed run time in ms per job type, for start estimates
+  std::unordered_map<std::string, double> avg_run_ms_;
   std::unordered_map<std::string, JobInfo> jobs_;
   std::atomic<uint64_t> next_id_{1};
   bool running_;
-  std::thread worker_thread_;
+  std::vector<std::thread> workers_;
 
-  // Active measure jobs (ids). Non-measure jobs wait until this set is empty.
-  std::set<std::string> active_measure_jobs_;
-  std::condition_variable measure_cv_;
+  // Instruments held by started jobs. A measure job holds its instruments
+  // until its monitor thread sees its commands complete.
+  std::set<std::string> held_instruments_;
+  size_t holding_jobs_{0};
+  bool exclusive_held_{false};
 };
 
 } // namespace server
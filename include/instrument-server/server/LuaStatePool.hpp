@@ -0,0 +1,101 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include "instrument-server/server/RuntimeContext.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <sol/sol.hpp>
+#include <string>
+#include <vector>
+
+namespace instserver {
+
+/// Pre-warmed Lua states for measurement scripts. Each state has the
+/// standard libraries opened and the runtime usertypes registered once, when
+/// it is built. A script runs in its own environment table whose lookups fall
+/// through to the state's globals, so globals the script sets (including
+/// `context`) go away with the environment when the lease ends, and the
+/// state goes back to the pool instead of being rebuilt.
+///
+/// Library tables (string, math, ...) and package.loaded are shared by all
+/// scripts that run on a state; a script that modifies them affects later
+/// scripts on the same state.
+class INSTRUMENT_SERVER_API LuaStatePool {
+public:
+  /// Exclusive use of one state until destroyed. Not thread-safe; use it
+  /// from one thread at a time.
+  class INSTRUMENT_SERVER_API Lease {
+  public:
+    Lease(Lease &&other) noexcept = default;
+    Lease &operator=(Lease &&) = delete;
+    ~Lease();
+
+    sol::state &state() { return *lua_; }
+
+    /// This script's globals
+    sol::environment &environment() { return env_; }
+
+    /// Create a context and set it as `context` in this lease's environment
+    std::shared_ptr<RuntimeContext>
+    bind_context(InstrumentRegistry &registry,
+                 SyncCoordinator &sync_coordinator, bool enqueue_mode = false);
+
+    /// Run the script at `path` in this lease's environment, compiling it
+    /// through ScriptCache. Throws sol::error if it cannot be loaded. The
+    /// result refers to the state's stack, so it must not outlive the lease.
+    sol::protected_function_result run_file(const std::string &path);
+
+    /// Run the script at `path`, which must return a function, and call
+    /// that function with a table holding `fields` (converted from JSON)
+    /// plus call, bind, parallel and log functions for the context from
+    /// bind_context(). Scripts use them as ctx.call(...), ctx.log(...).
+    /// Throws sol::error if the script returns something else.
+    sol::protected_function_result run_file(const std::string &path,
+                                            const nlohmann::json &fields);
+
+  private:
+    friend class LuaStatePool;
+    Lease(LuaStatePool &pool, std::unique_ptr<sol::state> lua);
+
+    LuaStatePool *pool_;
+    std::unique_ptr<sol::state> lua_;
+    sol::environment env_; // Declared after lua_ so it is released first
+    std::shared_ptr<RuntimeContext> context_;
+  };
+
+  /// Shared pool. Holds up to INSTRUMENT_SCRIPT_SERVER_LUA_POOL_SIZE idle
+  /// states (default 4), all built on first use.
+  static LuaStatePool &instance();
+
+  /// Pool that keeps at most `capacity` idle states, built up front
+  explicit LuaStatePool(size_t capacity);
+
+  LuaStatePool(const LuaStatePool &) = delete;
+  LuaStatePool &operator=(const LuaStatePool &) = delete;
+
+  /// Take an idle state, or build one if none is idle. Never blocks on
+  /// other leases.
+  Lease acquire();
+
+  size_t capacity() const { return capacity_; }
+
+  /// Number of states waiting in the pool
+  size_t idle() const;
+
+  /// Number of states built so far, pre-warmed ones included
+  size_t created() const;
+
+private:
+  std::unique_ptr<sol::state> make_state();
+  void release(std::unique_ptr<sol::state> lua);
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<sol::state>> idle_;
+  size_t created_{0};
+};
+
+} // namespace instserver
@@ -7,6 +7,7 @@
 
 #include <future>
 #include <memory>
+#include <optional>
 #include <set>
 #include <sol/sol.hpp>
 #include <unordered_map>
@@ -31,12 +32,28 @@ struct INSTRUMENT_SERVER_API CallResult {
   std::string buffer_id;
   uint64_t element_count{0};
   std::string data_type;
+  // Keeps the buffer mapped (or spilled) while this result is held
+  std::shared_ptr<const void> buffer_ref;
 
   // Execution status / error
   bool success{false};
   std::string error_message;
 };
 
+/// A parsed "InstrumentID[:Channel].Verb" call target. Each distinct string
+/// is parsed and resolved once per context, then reused by every call() with
+/// that string and by the functions bind() returns.
+struct INSTRUMENT_SERVER_API CallSite {
+  std::string spec; // Instrument part as written, e.g. "DAC1:3"
+  std::string instrument_id;
+  std::string verb;
+  std::optional<int64_t> channel;
+  bool expects_response{false};
+  // Re-resolved, along with expects_response, once the instrument it was
+  // resolved to has been removed
+  std::weak_ptr<InstrumentWorkerProxy> worker;
+};
+
 /// Generic runtime context for Lua scripts
 /// Provides basic instrument control primitives:
 /// - call(): Execute instrument commands (enqueue-first if enabled)
@@ -56,17 +73,44 @@ public:
   sol::object call(const std::string &func_name, sol::variadic_args args,
                    sol::this_state s);
 
+  /// Resolve a call target once and return a function that calls it, for
+  /// tight loops. Returns nil if the name is malformed. On LuaJIT the
+  /// function calls through the FFI when all arguments are numbers.
+  /// Usage: local set = context:bind("InstrumentID:Channel.CommandVerb")
+  ///        set(value)
+  sol::object bind(const std::string &func_name, sol::this_state s);
+
+  /// What isrv_call_d() receives as its handle
+  struct NativeCall {
+    RuntimeContext *context;
+    CallSite *site;
+  };
+
+  /// Call `site` with positional numeric arguments, without Lua. Behaves as
+  /// call() with the same arguments. Returns 1 with the value in `*result`
+  /// if the command returned a number, 0 if it succeeded (or was buffered
+  /// or enqueued) without one, -1 if it failed. Backs isrv_call_d().
+  int32_t call_native(CallSite &site, const double *args, size_t count,
+                      double *result);
+
   /// Execute block in parallel with synchronization
   /// Usage: context:parallel(function() ... end)
   /// Note: parallel blocks dispatch commands with a shared sync token. The
   /// block returns after commands are dispatched (parsing resumes). Actual
-  /// execution starts only when SYNC_CONTINUE is sent for that token.
+  /// execution starts only when SYNC_CONTINUE is sent for that token. Only
+  /// the instruments called inside the block take part in its barrier.
   void parallel(sol::function block);
 
   /// Log message from script
   /// Usage: context:log("message")
   void log(const std::string &msg);
 
+  /// Only allow calls to `instruments`. A call to any other instrument is
+  /// rejected like a malformed name. Set before the script runs.
+  void restrict_instruments(std::set<std::string> instruments) {
+    allowed_instruments_ = std::move(instruments);
+  }
+
   /// Get collected results (filled after process_tokens_and_wait)
   const std::vector<CallResult> &get_results() const {
     return collected_results_;
@@ -78,6 +122,8 @@ public:
   /// After enqueueing (enqueue_mode), release tokens in order and wait for
   /// associated command futures to complete. This sends SYNC_CONTINUE in token
   /// order and blocks until completion. Intended for monitor thread use.
+  /// A token whose responses miss its deadline is failed: the missing calls
+  /// get an error result naming the instrument and waiting moves on.
   void process_tokens_and_wait();
 
   /// Backwards-compatible alias used by JobManager monitor
@@ -93,7 +139,6 @@ protected:
   // Parallel execution state (used while parsing)
   bool in_parallel_block_{false};
   std::vector<SerializedCommand> parallel_buffer_;
-  std::atomic<uint64_t> next_sync_token_{1};
 
   // Collected results from all call() operations
   std::vector<CallResult> collected_results_;
@@ -114,19 +159,66 @@ protected:
   // token -> vector of indices in collected_results_ corresponding to those
   // futures
   std::unordered_map<uint64_t, std::vector<size_t>> token_result_indices_;
+  // token -> how long to wait for its responses once it is next in order
+  std::unordered_map<uint64_t, std::chrono::milliseconds> token_timeouts_;
+
+  // Instruments calls may go to, if restricted (see restrict_instruments)
+  std::optional<std::set<std::string>> allowed_instruments_;
+
+  // Call sites by the string they were parsed from. Nodes never move, so
+  // bound functions keep pointers into it.
+  std::unordered_map<std::string, CallSite> call_sites_;
+
+  // Parse func_name, or return its cached call site; nullptr if malformed
+  CallSite *resolve_call_site(const std::string &func_name);
+
+  // The call site's instrument, looked up again if it has gone away
+  std::shared_ptr<InstrumentWorkerProxy> site_worker(CallSite &site);
+
+  // Shared body of call() and bound functions
+  sol::object invoke(CallSite &site, sol::variadic_args args,
+                     sol::this_state s);
+
+  // Buffer, enqueue or send a call and record its result. Returns the
+  // response only when the call was executed synchronously.
+  std::optional<CommandResponse>
+  dispatch(CallSite &site, std::unordered_map<std::string, ParamValue> params);
+
+  // Handles given to FFI code by bind(), one per call site; nodes never
+  // move and live as long as the context
+  std::unordered_map<const CallSite *, NativeCall> native_calls_;
+
+  // Whether bind() may hand `site` to the FFI fast path, which can only
+  // return numbers
+  bool native_callable(const CallSite &site) const;
 
   // Helper to send command to instrument (synchronous path)
   CommandResponse
-  send_command(const std::string &instrument_id, const std::string &verb,
-               const std::unordered_map<std::string, ParamValue> &params,
-               bool expects_response);
+  send_command(const std::shared_ptr<InstrumentWorkerProxy> &worker,
+               const CallSite &site,
+               const std::unordered_map<std::string, ParamValue> &params);
 
   // Execute buffered parallel commands with sync (used only when not
   // enqueue_mode)
   void execute_parallel_buffer();
 };
 
-/// Bind runtime context to Lua and return the created context instance.
+/// FFI entry point for LuaJIT scripts: calls the bound call site `handle`
+/// with `count` numeric arguments. See RuntimeContext::call_native().
+extern "C" INSTRUMENT_SERVER_API int32_t isrv_call_d(void *handle,
+                                                     const double *args,
+                                                     int32_t count,
+                                                     double *result);
+
+/// Register the RuntimeContext and DataHandle usertypes (and, on LuaJIT,
+/// the FFI binder used by bind()) in `lua`. Done once per state; the
+/// context itself can then be set per script.
+INSTRUMENT_SERVER_API void register_runtime_types(sol::state &lua);
+
+/// Register the usertypes, then bind a new context to Lua as `context` and
+/// return it.
+/// On LuaJIT, bind() returns functions that call through isrv_call_d()
+/// instead of sol2 where the command's return type allows it.
 /// If enqueue_mode is true, the context will enqueue commands (non-blocking)
 /// and allow callers to release tokens & wait on them later via
 /// process_tokens_and_wait().
@@ -0,0 +1,58 @@
+#pragma once
+#include "instrument-server/export.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <sol/sol.hpp>
+#include <string>
+#include <unordered_map>
+
+namespace instserver {
+
+/// Compiled measurement scripts, shared by every Lua state in the process.
+/// A script is compiled once and kept as bytecode, keyed by its path. The
+/// entry is reused while the file's modification time and size are
+/// unchanged; otherwise the file is read again and recompiled only if its
+/// contents hash differently.
+class INSTRUMENT_SERVER_API ScriptCache {
+public:
+  static ScriptCache &instance();
+
+  ScriptCache() = default;
+  ScriptCache(const ScriptCache &) = delete;
+  ScriptCache &operator=(const ScriptCache &) = delete;
+
+  /// Load the script at `path` into `lua` as a function, as load_file()
+  /// would. Errors (missing file, syntax error) come back in the result and
+  /// are not cached.
+  sol::load_result load(sol::state &lua, const std::string &path);
+
+  /// Drop all compiled scripts. Counters are kept.
+  void clear();
+
+  /// {"hits", "misses", "entries", "hit_rate"}; hit_rate is 0 before the
+  /// first load
+  nlohmann::json stats_json() const;
+
+  uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+  struct Entry {
+    std::filesystem::file_time_type mtime;
+    uintmax_t size{0};
+    uint64_t hash{0};
+    std::shared_ptr<const std::string> bytecode;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+};
+
+} // namespace instserver
@@ -1,47 +1,155 @@
 #pragma once
 #include "instrument-server/export.h"
 
-#include <map>
+#include "instrument-server/ipc/SharedBarrier.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
-#include <set>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace instserver {
 
+/// Histogram buckets for barrier arrival latency. Bucket i counts arrivals
+/// below 2^i microseconds (and at or above 2^(i-1)); the last one also
+/// takes everything slower.
+constexpr size_t BARRIER_ARRIVAL_BUCKETS = 26;
+
+/// How long one instrument takes to reach barriers: the time from barrier
+/// registration to its SYNC_ACK, over every barrier it took part in
+struct INSTRUMENT_SERVER_API BarrierArrivalStats {
+  std::string instrument;
+  uint64_t arrivals{0};
+  uint64_t timeouts{0}; // Barriers that failed while it had not arrived
+  uint64_t total_us{0};
+  uint64_t max_us{0};
+  std::vector<uint64_t> buckets; // BARRIER_ARRIVAL_BUCKETS entries
+
+  /// Upper bound in microseconds of the bucket holding quantile `q`
+  /// (0 < q <= 1); 0 with no arrivals
+  uint64_t quantile_us(double q) const;
+};
+
 /// Coordinates synchronization barriers across multiple instruments
 /// for parallel execution blocks
 class INSTRUMENT_SERVER_API SyncCoordinator {
 public:
-  /// Register a new sync barrier with the instruments that must participate
-  void register_barrier(uint64_t sync_token,
-                        const std::vector<std::string> &instruments);
+  SyncCoordinator() = default;
+  ~SyncCoordinator();
+
+  /// Dense ID for an instrument name, assigned on first use (normally when
+  /// the instrument is registered). IDs are process-wide and never reused,
+  /// so every coordinator agrees on them.
+  static uint32_t intern_instrument(const std::string &instrument_name);
+
+  /// Name interned as `instrument_id`, or empty if unknown
+  static std::string instrument_name(uint32_t instrument_id);
+
+  /// Default time a barrier may stay open before it can be failed
+  static constexpr std::chrono::milliseconds DEFAULT_BARRIER_TIMEOUT{30000};
+
+  /// Token for a new barrier, unique across every user of this coordinator
+  uint64_t next_token() {
+    return next_token_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Register a new sync barrier with the instruments that must participate.
+  /// Its deadline is `timeout` after registration.
+  void register_barrier(
+      uint64_t sync_token, const std::vector<std::string> &instruments,
+      std::chrono::milliseconds timeout = DEFAULT_BARRIER_TIMEOUT);
+
+  /// Same, for instruments already interned with intern_instrument()
+  void register_barrier_ids(
+      uint64_t sync_token, const std::vector<uint32_t> &instrument_ids,
+      std::chrono::milliseconds timeout = DEFAULT_BARRIER_TIMEOUT);
+
+  /// Arm a shared-memory barrier for the registered `sync_token` that
+  /// `participants` workers will arrive at. Returns nullopt if shared
+  /// barriers are off, the token is unknown, or every slot is in use; the
+  /// token then uses SYNC_ACK/SYNC_CONTINUE.
+  std::optional<ipc::SharedBarrierTicket>
+  arm_shared_barrier(uint64_t sync_token, size_t participants);
+
+  /// Check if the token's barrier lives in shared memory
+  bool is_shared_barrier(uint64_t sync_token) const;
 
   /// Called when an instrument acknowledges completion of a sync command
   /// Returns true if all instruments have acknowledged (barrier complete)
   bool handle_ack(uint64_t sync_token, const std::string &instrument_name);
+  bool handle_ack(uint64_t sync_token, uint32_t instrument_id);
 
   /// Get all instruments waiting on this barrier
   std::vector<std::string> get_waiting_instruments(uint64_t sync_token) const;
 
+  /// Deadline of the token's barrier, or nullopt if it is not registered
+  std::optional<std::chrono::steady_clock::time_point>
+  barrier_deadline(uint64_t sync_token) const;
+
+  /// Give up on a barrier that missed its deadline: remove it, break its
+  /// shared slot, count a timeout against every instrument that had not
+  /// ACKed, and return their names. Workers on a shared barrier never ACK,
+  /// so there every participant is returned and no timeouts are counted.
+  std::vector<std::string> fail_barrier(uint64_t sync_token);
+
   /// Check if a barrier exists
   bool has_barrier(uint64_t sync_token) const;
 
-  /// Remove a completed barrier
+  /// Remove a completed barrier (and give back its shared slot, if any)
   void clear_barrier(uint64_t sync_token);
 
   /// Get count of active barriers
   size_t active_barrier_count() const;
 
+  /// Arrival latency of every instrument seen so far. Like instrument IDs
+  /// these are process-wide, shared by all coordinators.
+  static std::vector<BarrierArrivalStats> arrival_stats();
+
+  /// Forget all arrival latencies
+  static void reset_arrival_stats();
+
 private:
+  /// One bit per instrument ID. ACKs clear bits with atomic fetch_and, so
+  /// recording one takes no lock and completion is a counter reaching zero.
   struct SyncBarrier {
-    std::set<std::string> expected_instruments;
-    std::set<std::string> acked_instruments;
+    std::vector<uint64_t> expected;               // Fixed at registration
+    std::vector<std::atomic<uint64_t>> pending;   // Bits not yet ACKed
+    std::atomic<size_t> remaining{0};
+    size_t expected_count{0};
     std::chrono::steady_clock::time_point created_at;
+    std::chrono::steady_clock::time_point deadline;
+    std::optional<ipc::SharedBarrierTicket> shared; // Guarded by shard mutex
+
+    explicit SyncBarrier(std::vector<uint64_t> mask);
   };
 
-  mutable std::mutex mutex_;
-  std::map<uint64_t, SyncBarrier> barriers_;
+  /// Tokens are spread over shards so concurrent blocks rarely share a lock
+  static constexpr size_t SHARD_COUNT = 16;
+
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<SyncBarrier>> barriers;
+  };
+
+  std::array<Shard, SHARD_COUNT> shards_;
+  std::atomic<uint64_t> next_token_{1};
+
+  Shard &shard_for(uint64_t sync_token) {
+    return shards_[sync_token % SHARD_COUNT];
+  }
+  const Shard &shard_for(uint64_t sync_token) const {
+    return shards_[sync_token % SHARD_COUNT];
+  }
+
+  std::shared_ptr<SyncBarrier> find_barrier(uint64_t sync_token) const;
+  static std::vector<uint32_t> pending_ids(const SyncBarrier &barrier);
+  void disarm_shared(const std::optional<ipc::SharedBarrierTicket> &ticket);
 };
 
 } // namespace instserver
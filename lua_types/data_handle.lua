@@ -1,5 +1,17 @@
 ---@meta
 
+--- Read-only view of array data returned by a command. Large acquisitions are
+--- read in place from shared memory; nothing is copied into Lua unless
+--- to_table() is called. Supports `#handle` and 1-based `handle[i]`.
 ---@class DataHandle
+---@operator len: integer
+---@field [integer] number? Element at a 1-based index, nil past the end
 ---@field size fun(self: DataHandle): integer Get number of data points
----@field id fun(self: DataHandle): integer Get unique handle ID
+---@field id fun(self: DataHandle): string Get the shared memory buffer ID ("" for inline arrays)
+---@field type fun(self: DataHandle): string Get the stored element type, e.g. "float32"
+---@field slice fun(self: DataHandle, first: integer, last?: integer): DataHandle View of elements first..last (inclusive), sharing storage
+---@field sum fun(self: DataHandle): number Sum of all elements
+---@field mean fun(self: DataHandle): number Mean of all elements (NaN if empty)
+---@field min fun(self: DataHandle): number Smallest element (NaN if empty)
+---@field max fun(self: DataHandle): number Largest element (NaN if empty)
+---@field to_table fun(self: DataHandle): number[] Copy the elements into a Lua table
@@ -15,6 +15,10 @@ std::string serialize_command(const SerializedCommand &cmd) {
   if (cmd.sync_token) {
     j["sync_token"] = *cmd.sync_token;
   }
+  if (cmd.barrier_slot) {
+    j["barrier_slot"] = *cmd.barrier_slot;
+    j["barrier_epoch"] = cmd.barrier_epoch;
+  }
 
   // Serialize params
   nlohmann::json params_json = nlohmann::json::object();
@@ -50,6 +54,10 @@ SerializedCommand deserialize_command(const std::string &json) {
   if (j.contains("sync_token")) {
     cmd.sync_token = j["sync_token"];
   }
+  if (j.contains("barrier_slot")) {
+    cmd.barrier_slot = j["barrier_slot"].get<uint32_t>();
+    cmd.barrier_epoch = j.value("barrier_epoch", 0u);
+  }
 
   // Deserialize params
   if (j.contains("params") && j["params"].is_object()) {
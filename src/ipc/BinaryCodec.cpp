@@ -0,0 +1,399 @@
+#include "instrument-server/ipc/BinaryCodec.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+// Wire format (host byte order; both ends always run on the same machine):
+//
+//   command:  magic kind=1 flags str:id sym:instrument sym:verb
+//             varint:timeout_ms [u64:sync_token]
+//             [varint:barrier_slot varint:barrier_epoch] varint:nparams
+//             { sym:key value }*
+//   response: magic kind=2 flags str:command_id sym:instrument
+//             zigzag:error_code str:error_message str:text_response
+//             [value] [str:buffer_id varint:element_count sym:data_type]
+//
+//   batch:    varint:count { str:item }*     items are whole payloads above
+//                                            (or JSON text), in send order
+//
+//   str    = varint:length bytes
+//   sym    = varint:(id << 1 | 1) str     first use, defines id
+//          | varint:(id << 1)             later uses
+//   value  = u8:tag payload  (see ValueTag)
+
+namespace instserver {
+namespace ipc {
+
+namespace {
+
+enum : uint8_t { KIND_COMMAND = 1, KIND_RESPONSE = 2 };
+
+enum : uint8_t {
+  CMD_EXPECTS_RESPONSE = 1 << 0,
+  CMD_HAS_SYNC_TOKEN = 1 << 1,
+  CMD_HAS_SHARED_BARRIER = 1 << 2,
+};
+
+enum : uint8_t {
+  RESP_SUCCESS = 1 << 0,
+  RESP_HAS_RETURN = 1 << 1,
+  RESP_HAS_LARGE_DATA = 1 << 2,
+};
+
+enum ValueTag : uint8_t {
+  TAG_DOUBLE = 0,      // 8 raw bytes
+  TAG_INT64 = 1,       // zigzag varint
+  TAG_STRING = 2,      // str
+  TAG_BOOL_FALSE = 3,  // no payload
+  TAG_BOOL_TRUE = 4,   // no payload
+  TAG_DOUBLE_ARRAY = 5 // varint:count, count * 8 raw bytes
+};
+
+void put_u8(std::string &out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+void put_varint(std::string &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+void put_zigzag(std::string &out, int64_t v) {
+  put_varint(out, (static_cast<uint64_t>(v) << 1) ^
+                      static_cast<uint64_t>(v >> 63));
+}
+
+template <typename T> void put_raw(std::string &out, const T &v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+void put_string(std::string &out, const std::string &s) {
+  put_varint(out, s.size());
+  out.append(s);
+}
+
+void put_value(std::string &out, const ParamValue &value) {
+  if (auto d = std::get_if<double>(&value)) {
+    put_u8(out, TAG_DOUBLE);
+    put_raw(out, *d);
+  } else if (auto i = std::get_if<int64_t>(&value)) {
+    put_u8(out, TAG_INT64);
+    put_zigzag(out, *i);
+  } else if (auto s = std::get_if<std::string>(&value)) {
+    put_u8(out, TAG_STRING);
+    put_string(out, *s);
+  } else if (auto b = std::get_if<bool>(&value)) {
+    put_u8(out, *b ? TAG_BOOL_TRUE : TAG_BOOL_FALSE);
+  } else if (auto arr = std::get_if<std::vector<double>>(&value)) {
+    put_u8(out, TAG_DOUBLE_ARRAY);
+    put_varint(out, arr->size());
+    out.append(reinterpret_cast<const char *>(arr->data()),
+               arr->size() * sizeof(double));
+  }
+}
+
+[[noreturn]] void malformed(const char *what) {
+  throw std::runtime_error(std::string("binary codec: ") + what);
+}
+
+} // namespace
+
+std::optional<PayloadCodec> parse_payload_codec(const std::string &name) {
+  if (name == "json")
+    return PayloadCodec::JSON;
+  if (name == "binary")
+    return PayloadCodec::BINARY;
+  return std::nullopt;
+}
+
+const char *payload_codec_name(PayloadCodec codec) {
+  switch (codec) {
+  case PayloadCodec::JSON:
+    return "json";
+  case PayloadCodec::BINARY:
+    return "binary";
+  }
+  return "unknown";
+}
+
+bool is_binary_payload(const std::string &payload) {
+  return !payload.empty() &&
+         static_cast<uint8_t>(payload[0]) == BINARY_CODEC_MAGIC;
+}
+
+// Encoder
+
+void BinaryEncoder::put_symbol(std::string &out, const std::string &s) {
+  auto it = ids_.find(s);
+  if (it != ids_.end()) {
+    put_varint(out, static_cast<uint64_t>(it->second) << 1);
+    return;
+  }
+  auto staged = staged_.find(s);
+  if (staged != staged_.end()) {
+    put_varint(out, static_cast<uint64_t>(staged->second) << 1);
+    return;
+  }
+
+  uint32_t id = static_cast<uint32_t>(ids_.size() + staged_.size());
+  staged_.emplace(s, id);
+  put_varint(out, (static_cast<uint64_t>(id) << 1) | 1);
+  put_string(out, s);
+}
+
+std::string BinaryEncoder::encode_command(const SerializedCommand &cmd) {
+  std::string out;
+  out.reserve(64 + cmd.id.size() + cmd.params.size() * 12);
+
+  uint8_t flags = 0;
+  if (cmd.expects_response)
+    flags |= CMD_EXPECTS_RESPONSE;
+  if (cmd.sync_token)
+    flags |= CMD_HAS_SYNC_TOKEN;
+  if (cmd.barrier_slot)
+    flags |= CMD_HAS_SHARED_BARRIER;
+
+  put_u8(out, BINARY_CODEC_MAGIC);
+  put_u8(out, KIND_COMMAND);
+  put_u8(out, flags);
+  put_string(out, cmd.id);
+  put_symbol(out, cmd.instrument_name);
+  put_symbol(out, cmd.verb);
+  put_varint(out, static_cast<uint64_t>(cmd.timeout.count()));
+  if (cmd.sync_token)
+    put_raw(out, *cmd.sync_token);
+  if (cmd.barrier_slot) {
+    put_varint(out, *cmd.barrier_slot);
+    put_varint(out, cmd.barrier_epoch);
+  }
+
+  put_varint(out, cmd.params.size());
+  for (const auto &[key, value] : cmd.params) {
+    put_symbol(out, key);
+    put_value(out, value);
+  }
+  return out;
+}
+
+std::string BinaryEncoder::encode_response(const CommandResponse &resp) {
+  std::string out;
+  out.reserve(64 + resp.command_id.size() + resp.text_response.size() +
+              resp.error_message.size());
+
+  uint8_t flags = 0;
+  if (resp.success)
+    flags |= RESP_SUCCESS;
+  if (resp.return_value)
+    flags |= RESP_HAS_RETURN;
+  if (resp.has_large_data)
+    flags |= RESP_HAS_LARGE_DATA;
+
+  put_u8(out, BINARY_CODEC_MAGIC);
+  put_u8(out, KIND_RESPONSE);
+  put_u8(out, flags);
+  put_string(out, resp.command_id);
+  put_symbol(out, resp.instrument_name);
+  put_zigzag(out, resp.error_code);
+  put_string(out, resp.error_message);
+  put_string(out, resp.text_response);
+  if (resp.return_value)
+    put_value(out, *resp.return_value);
+  if (resp.has_large_data) {
+    put_string(out, resp.buffer_id);
+    put_varint(out, resp.element_count);
+    put_symbol(out, resp.data_type);
+  }
+  return out;
+}
+
+void BinaryEncoder::commit() {
+  for (auto &[s, id] : staged_)
+    ids_.emplace(s, id);
+  staged_.clear();
+}
+
+void BinaryEncoder::discard() { staged_.clear(); }
+
+// Decoder
+
+struct BinaryReader {
+  const char *p;
+  const char *end;
+  std::vector<std::string> &strings;
+
+  void need(size_t n) {
+    if (static_cast<size_t>(end - p) < n)
+      malformed("truncated payload");
+  }
+
+  uint8_t u8() {
+    need(1);
+    return static_cast<uint8_t>(*p++);
+  }
+
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = u8();
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if (!(b & 0x80))
+        return v;
+    }
+    malformed("varint too long");
+  }
+
+  int64_t zigzag() {
+    uint64_t v = varint();
+    return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+  }
+
+  template <typename T> T raw() {
+    need(sizeof(T));
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return v;
+  }
+
+  std::string string() {
+    uint64_t n = varint();
+    need(n);
+    std::string s(p, n);
+    p += n;
+    return s;
+  }
+
+  const std::string &symbol() {
+    uint64_t v = varint();
+    uint64_t id = v >> 1;
+    if (v & 1) {
+      if (id != strings.size())
+        malformed("out-of-order symbol definition");
+      strings.push_back(string());
+    } else if (id >= strings.size()) {
+      malformed("unknown symbol id");
+    }
+    return strings[id];
+  }
+
+  ParamValue value() {
+    switch (u8()) {
+    case TAG_DOUBLE:
+      return raw<double>();
+    case TAG_INT64:
+      return zigzag();
+    case TAG_STRING:
+      return string();
+    case TAG_BOOL_FALSE:
+      return false;
+    case TAG_BOOL_TRUE:
+      return true;
+    case TAG_DOUBLE_ARRAY: {
+      uint64_t n = varint();
+      if (n > static_cast<uint64_t>(end - p) / sizeof(double))
+        malformed("truncated array");
+      std::vector<double> arr(n);
+      std::memcpy(arr.data(), p, n * sizeof(double));
+      p += n * sizeof(double);
+      return arr;
+    }
+    default:
+      malformed("unknown value tag");
+    }
+  }
+
+  void header(uint8_t kind) {
+    if (u8() != BINARY_CODEC_MAGIC)
+      malformed("bad magic");
+    if (u8() != kind)
+      malformed("unexpected message kind");
+  }
+};
+
+SerializedCommand BinaryDecoder::decode_command(const std::string &payload) {
+  BinaryReader in{payload.data(), payload.data() + payload.size(), strings_};
+  in.header(KIND_COMMAND);
+
+  SerializedCommand cmd;
+  uint8_t flags = in.u8();
+  cmd.id = in.string();
+  cmd.instrument_name = in.symbol();
+  cmd.verb = in.symbol();
+  cmd.expects_response = flags & CMD_EXPECTS_RESPONSE;
+  cmd.timeout = std::chrono::milliseconds(in.varint());
+  cmd.created_at = std::chrono::steady_clock::now();
+  if (flags & CMD_HAS_SYNC_TOKEN)
+    cmd.sync_token = in.raw<uint64_t>();
+  if (flags & CMD_HAS_SHARED_BARRIER) {
+    cmd.barrier_slot = static_cast<uint32_t>(in.varint());
+    cmd.barrier_epoch = static_cast<uint32_t>(in.varint());
+  }
+
+  uint64_t nparams = in.varint();
+  cmd.params.reserve(nparams);
+  for (uint64_t i = 0; i < nparams; ++i) {
+    const std::string &key = in.symbol();
+    cmd.params.emplace(key, in.value());
+  }
+  return cmd;
+}
+
+CommandResponse BinaryDecoder::decode_response(const std::string &payload) {
+  BinaryReader in{payload.data(), payload.data() + payload.size(), strings_};
+  in.header(KIND_RESPONSE);
+
+  CommandResponse resp;
+  uint8_t flags = in.u8();
+  resp.command_id = in.string();
+  resp.instrument_name = in.symbol();
+  resp.success = flags & RESP_SUCCESS;
+  resp.error_code = static_cast<int>(in.zigzag());
+  resp.error_message = in.string();
+  resp.text_response = in.string();
+  if (flags & RESP_HAS_RETURN)
+    resp.return_value = in.value();
+  if (flags & RESP_HAS_LARGE_DATA) {
+    resp.has_large_data = true;
+    resp.buffer_id = in.string();
+    resp.element_count = in.varint();
+    resp.data_type = in.symbol();
+  }
+  return resp;
+}
+
+// Batches
+
+std::string pack_batch(const std::vector<std::string> &payloads) {
+  size_t total = 10;
+  for (const auto &item : payloads)
+    total += item.size() + 5;
+
+  std::string out;
+  out.reserve(total);
+  put_varint(out, payloads.size());
+  for (const auto &item : payloads)
+    put_string(out, item);
+  return out;
+}
+
+std::vector<std::string> unpack_batch(const std::string &payload) {
+  std::vector<std::string> unused;
+  BinaryReader in{payload.data(), payload.data() + payload.size(), unused};
+
+  uint64_t count = in.varint();
+  // Every item needs at least its length byte
+  if (count > payload.size())
+    malformed("batch count exceeds payload");
+
+  std::vector<std::string> items;
+  items.reserve(count);
+  for (uint64_t i = 0; i < count; ++i)
+    items.push_back(in.string());
+  if (in.p != in.end)
+    malformed("trailing bytes after batch");
+  return items;
+}
+
+} // namespace ipc
+} // namespace instserver
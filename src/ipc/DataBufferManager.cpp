@@ -1,13 +1,129 @@
 #include "instrument-server/ipc/DataBufferManager.hpp"
 #include "instrument-server/Logger.hpp"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
 namespace instserver {
 namespace ipc {
 
+namespace {
+
+constexpr uint32_t BUFFER_SEGMENT_MAGIC = 0x42465253; // "SRFB"
+constexpr uint32_t BUFFER_SEGMENT_VERSION = 1;
+
+/// Layout at the start of every buffer segment, so any process can
+/// reconstruct the metadata from the buffer ID alone
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t data_type;
+  uint32_t generation; // Reuse count; must match the buffer ID
+  uint64_t element_count;
+  uint64_t byte_size;
+  uint64_t timestamp_ms;
+  char instrument_name[64];
+  char command_id[128];
+};
+
+/// Samples start here; keeps them cache-line (and SIMD) aligned
+constexpr size_t SEGMENT_DATA_OFFSET = 256;
+
+/// Smallest pool size class; one page
+constexpr size_t MIN_SEGMENT_CAPACITY = 4096;
+
+constexpr size_t DEFAULT_POOL_LIMIT_MB = 256;
+
+/// Sanity limit on one buffer; element counts come straight from plugins.
+/// Also keeps size_class() from overflowing.
+constexpr size_t MAX_BUFFER_BYTES =
+    std::min<uint64_t>(16ull * 1024 * 1024 * 1024, SIZE_MAX / 2);
+
+constexpr auto DEFAULT_BACKPRESSURE_TIMEOUT = std::chrono::milliseconds(5000);
+
+/// Longest single wait while blocked on the budget, so a reclaim handler
+/// gets called regularly
+constexpr auto BUDGET_WAIT_SLICE = std::chrono::milliseconds(50);
+
+/// Marks a reused segment's generation in its buffer ID
+constexpr const char *GENERATION_SEPARATOR = ".g";
+static_assert(sizeof(SegmentHeader) <= SEGMENT_DATA_OFFSET,
+              "SegmentHeader too large");
+
+void copy_field(char *dst, size_t dst_size, const std::string &src) {
+  size_t n = std::min(src.size(), dst_size - 1);
+  std::memcpy(dst, src.data(), n);
+  dst[n] = '\0';
+}
+
+size_t size_class(size_t byte_size) {
+  size_t capacity = MIN_SEGMENT_CAPACITY;
+  while (capacity < byte_size) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+/// Split a buffer ID into its segment name and generation
+bool parse_buffer_id(const std::string &buffer_id, std::string &segment_name,
+                     uint32_t &generation) {
+  auto pos = buffer_id.rfind(GENERATION_SEPARATOR);
+  if (pos == std::string::npos) {
+    segment_name = buffer_id;
+    generation = 0;
+    return true;
+  }
+  try {
+    generation = static_cast<uint32_t>(std::stoul(buffer_id.substr(pos + 2)));
+  } catch (const std::exception &) {
+    return false;
+  }
+  segment_name = buffer_id.substr(0, pos);
+  return true;
+}
+
+/// Read a non-negative integer environment variable
+bool env_size(const char *name, size_t &out) {
+  const char *env = std::getenv(name);
+  if (!env) {
+    return false;
+  }
+  try {
+    out = static_cast<size_t>(std::stoull(env));
+    return true;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+/// Make a fully written segment attachable. The fence orders the sample
+/// writes before the magic becomes visible to other processes.
+void publish_header(void *data) {
+  auto *base = static_cast<char *>(data) - SEGMENT_DATA_OFFSET;
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(base + offsetof(SegmentHeader, magic), &BUFFER_SEGMENT_MAGIC,
+              sizeof(BUFFER_SEGMENT_MAGIC));
+}
+
+} // namespace
+
 // DataBuffer implementation
 
 DataBuffer::DataBuffer(const std::string &buffer_id, void *data,
@@ -17,6 +133,15 @@ DataBuffer::DataBuffer(const std::string &buffer_id, void *data,
       element_count_(element_count), data_type_(data_type), owns_memory_(true) {
 }
 
+DataBuffer::DataBuffer(const std::string &buffer_id, void *data,
+                       size_t byte_size, DataType data_type,
+                       size_t element_count, std::shared_ptr<void> backing,
+                       bool read_only)
+    : buffer_id_(buffer_id), data_(data), byte_size_(byte_size),
+      element_count_(element_count), data_type_(data_type),
+      owns_memory_(false), backing_(std::move(backing)),
+      read_only_(read_only) {}
+
 DataBuffer::~DataBuffer() {
   if (owns_memory_ && data_) {
     free(data_);
@@ -27,7 +152,8 @@ DataBuffer::~DataBuffer() {
 DataBuffer::DataBuffer(DataBuffer &&other) noexcept
     : buffer_id_(std::move(other.buffer_id_)), data_(other.data_),
       byte_size_(other.byte_size_), element_count_(other.element_count_),
-      data_type_(other.data_type_), owns_memory_(other.owns_memory_) {
+      data_type_(other.data_type_), owns_memory_(other.owns_memory_),
+      backing_(std::move(other.backing_)), read_only_(other.read_only_) {
   other.data_ = nullptr;
   other.owns_memory_ = false;
 }
@@ -44,6 +170,8 @@ DataBuffer &DataBuffer::operator=(DataBuffer &&other) noexcept {
     element_count_ = other.element_count_;
     data_type_ = other.data_type_;
     owns_memory_ = other.owns_memory_;
+    backing_ = std::move(other.backing_);
+    read_only_ = other.read_only_;
 
     other.data_ = nullptr;
     other.owns_memory_ = false;
@@ -203,6 +331,31 @@ bool DataBuffer::export_to_csv(const std::string &filepath) const {
 
 // DataBufferManager implementation
 
+DataBufferManager::DataBufferManager()
+    : backpressure_timeout_(DEFAULT_BACKPRESSURE_TIMEOUT),
+      pool_limit_bytes_(DEFAULT_POOL_LIMIT_MB * 1024 * 1024) {
+  size_t value = 0;
+  if (env_size("INSTRUMENT_SCRIPT_SERVER_BUFFER_POOL_MB", value)) {
+    pool_limit_bytes_ = value * 1024 * 1024;
+  }
+  if (env_size("INSTRUMENT_SCRIPT_SERVER_BUFFER_BUDGET_MB", value)) {
+    budget_bytes_ = value * 1024 * 1024;
+  }
+  if (env_size("INSTRUMENT_SCRIPT_SERVER_BUFFER_WAIT_MS", value)) {
+    backpressure_timeout_ = std::chrono::milliseconds(value);
+  }
+
+  if (const char *dir = std::getenv("INSTRUMENT_SCRIPT_SERVER_SPILL_DIR")) {
+    spill_dir_ = dir;
+  } else {
+    std::error_code ec;
+    auto tmp = std::filesystem::temp_directory_path(ec);
+    spill_dir_ = (tmp / ("instrument-server-spill-" +
+                         std::to_string(static_cast<long>(getpid()))))
+                     .string();
+  }
+}
+
 DataBufferManager &DataBufferManager::instance() {
   static DataBufferManager manager;
   return manager;
@@ -215,60 +368,168 @@ std::string DataBufferManager::generate_buffer_id() {
                 now.time_since_epoch())
                 .count();
 
+  // The ID doubles as the shared memory name, so it must be unique across
+  // every process that creates buffers
   std::ostringstream oss;
-  oss << "buffer_" << ms << "_" << id;
+  oss << "buffer_" << getpid() << "_" << ms << "_" << id;
   return oss.str();
 }
 
-std::string DataBufferManager::create_buffer(const std::string &instrument_name,
-                                             const std::string &command_id,
-                                             DataType data_type,
-                                             size_t element_count,
-                                             const void *data) {
-  size_t element_size = data_type_size(data_type);
+std::shared_ptr<DataBuffer>
+DataBufferManager::allocate_segment(DataBufferMetadata &metadata,
+                                    OwnedSegment &segment, bool zero_fill) {
+  using namespace boost::interprocess;
+
+  size_t element_size = data_type_size(metadata.data_type);
   if (element_size == 0) {
     LOG_ERROR("DATA_BUFFER", "CREATE", "Invalid data type");
-    return "";
+    return nullptr;
   }
 
-  size_t byte_size = element_count * element_size;
+  if (metadata.element_count > MAX_BUFFER_BYTES / element_size) {
+    LOG_ERROR("DATA_BUFFER", "CREATE",
+              "Buffer of {} elements exceeds the {} byte limit",
+              metadata.element_count, MAX_BUFFER_BYTES);
+    return nullptr;
+  }
 
-  // Allocate memory
-  void *buffer_data = malloc(byte_size);
-  if (!buffer_data) {
-    LOG_ERROR("DATA_BUFFER", "CREATE", "Failed to allocate {} bytes",
-              byte_size);
-    return "";
+  metadata.byte_size = metadata.element_count * element_size;
+  size_t capacity = size_class(metadata.byte_size);
+
+  if (!reserve_budget(metadata.byte_size)) {
+    return nullptr;
   }
 
-  // Copy data if provided
-  if (data) {
-    memcpy(buffer_data, data, byte_size);
+  bool reused = false;
+  {
+    std::lock_guard lock(pool_mutex_);
+    auto it = pool_.find(capacity);
+    if (it != pool_.end() && !it->second.empty()) {
+      segment = std::move(it->second.back());
+      it->second.pop_back();
+      pool_stats_.pooled_segments--;
+      pool_stats_.pooled_bytes -= capacity;
+      pool_stats_.hits++;
+      reused = true;
+    } else {
+      pool_stats_.misses++;
+    }
+  }
+
+  if (reused) {
+    segment.generation++;
+    metadata.buffer_id = segment.name + GENERATION_SEPARATOR +
+                         std::to_string(segment.generation);
   } else {
-    memset(buffer_data, 0, byte_size);
+    segment.name = generate_buffer_id();
+    segment.generation = 0;
+    segment.capacity = capacity;
+    try {
+      // Fresh shared memory pages are zero-filled by the OS, and only pages
+      // that get touched are backed, so rounding up to the class is cheap
+      shared_memory_object shm(create_only, segment.name.c_str(), read_write);
+      shm.truncate(static_cast<offset_t>(SEGMENT_DATA_OFFSET + capacity));
+      segment.region = std::make_shared<mapped_region>(shm, read_write);
+    } catch (const interprocess_exception &ex) {
+      LOG_ERROR("DATA_BUFFER", "CREATE", "Failed to allocate {} bytes: {}",
+                metadata.byte_size, ex.what());
+      shared_memory_object::remove(segment.name.c_str());
+      {
+        std::lock_guard lock(mutex_);
+        resident_bytes_ -= metadata.byte_size;
+      }
+      budget_cv_.notify_all();
+      return nullptr;
+    }
+    metadata.buffer_id = segment.name;
   }
 
-  std::string buffer_id = generate_buffer_id();
+  metadata.timestamp_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+
+  // Everything but the magic; attach_segment() rejects the segment until
+  // publish_header() writes it
+  auto *region = static_cast<mapped_region *>(segment.region.get());
+  auto *base = static_cast<char *>(region->get_address());
+  SegmentHeader header{};
+  header.version = BUFFER_SEGMENT_VERSION;
+  header.data_type = static_cast<uint32_t>(metadata.data_type);
+  header.generation = segment.generation;
+  header.element_count = metadata.element_count;
+  header.byte_size = metadata.byte_size;
+  header.timestamp_ms = metadata.timestamp_ms;
+  copy_field(header.instrument_name, sizeof(header.instrument_name),
+             metadata.instrument_name);
+  copy_field(header.command_id, sizeof(header.command_id),
+             metadata.command_id);
+  std::memcpy(base, &header, sizeof(header));
+
+  // A recycled segment holds the previous buffer's samples
+  if (reused && zero_fill) {
+    std::memset(base + SEGMENT_DATA_OFFSET, 0, metadata.byte_size);
+  }
+
+  return std::make_shared<DataBuffer>(
+      metadata.buffer_id, base + SEGMENT_DATA_OFFSET, metadata.byte_size,
+      metadata.data_type, metadata.element_count, segment.region, false);
+}
 
-  auto buffer = std::make_shared<DataBuffer>(buffer_id, buffer_data, byte_size,
-                                             data_type, element_count);
+void DataBufferManager::recycle_segment(OwnedSegment segment) {
+  // Unpublish first so the old buffer ID stops attaching
+  auto *region =
+      static_cast<boost::interprocess::mapped_region *>(segment.region.get());
+  std::memset(region->get_address(), 0, sizeof(BUFFER_SEGMENT_MAGIC));
 
+  {
+    std::lock_guard lock(pool_mutex_);
+    if (pool_stats_.pooled_bytes + segment.capacity <= pool_limit_bytes_) {
+      pool_stats_.pooled_segments++;
+      pool_stats_.pooled_bytes += segment.capacity;
+      pool_stats_.recycled++;
+      pool_[segment.capacity].push_back(std::move(segment));
+      return;
+    }
+    pool_stats_.evicted++;
+  }
+
+  // Existing mappings in other processes stay valid after unlink
+  boost::interprocess::shared_memory_object::remove(segment.name.c_str());
+}
+
+std::string DataBufferManager::create_buffer(const std::string &instrument_name,
+                                             const std::string &command_id,
+                                             DataType data_type,
+                                             size_t element_count,
+                                             const void *data) {
   DataBufferMetadata metadata;
-  metadata.buffer_id = buffer_id;
   metadata.instrument_name = instrument_name;
   metadata.command_id = command_id;
   metadata.data_type = data_type;
   metadata.element_count = element_count;
-  metadata.byte_size = byte_size;
-  metadata.timestamp_ms =
-      std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::system_clock::now().time_since_epoch())
-          .count();
+
+  OwnedSegment segment;
+  auto buffer = allocate_segment(metadata, segment, data == nullptr);
+  if (!buffer) {
+    return "";
+  }
+
+  if (data) {
+    memcpy(buffer->data(), data, metadata.byte_size);
+  }
+  publish_header(buffer->data());
+
+  std::string buffer_id = metadata.buffer_id;
+  size_t byte_size = metadata.byte_size;
 
   std::lock_guard lock(mutex_);
 
   // Use try_emplace to construct BufferEntry in-place
-  buffers_.try_emplace(buffer_id, buffer, std::move(metadata), 1);
+  auto it =
+      buffers_.try_emplace(buffer_id, buffer, std::move(metadata), 1).first;
+  it->second.segment = std::move(segment);
+  it->second.last_used = ++use_clock_;
 
   LOG_INFO("DATA_BUFFER", "CREATE",
            "Created buffer {} for {}. {} ({} elements, {} bytes)", buffer_id,
@@ -277,49 +538,342 @@ std::string DataBufferManager::create_buffer(const std::string &instrument_name,
   return buffer_id;
 }
 
+std::string DataBufferManager::acquire_buffer(
+    const std::string &instrument_name, const std::string &command_id,
+    DataType data_type, size_t element_count, void **data_out) {
+  if (!data_out) {
+    return "";
+  }
+
+  DataBufferMetadata metadata;
+  metadata.instrument_name = instrument_name;
+  metadata.command_id = command_id;
+  metadata.data_type = data_type;
+  metadata.element_count = element_count;
+
+  // The caller overwrites the contents, so a recycled segment is not cleared
+  OwnedSegment segment;
+  auto buffer = allocate_segment(metadata, segment, false);
+  if (!buffer) {
+    *data_out = nullptr;
+    return "";
+  }
+  *data_out = buffer->data();
+
+  std::string buffer_id = metadata.buffer_id;
+
+  std::lock_guard lock(mutex_);
+  auto it = buffers_
+                .try_emplace(buffer_id, buffer, std::move(metadata), 1, false,
+                             false)
+                .first;
+  it->second.segment = std::move(segment);
+  it->second.last_used = ++use_clock_;
+
+  LOG_DEBUG("DATA_BUFFER", "ACQUIRE",
+            "Acquired buffer {} for {}. {} ({} elements)", buffer_id,
+            instrument_name, command_id, element_count);
+
+  return buffer_id;
+}
+
+bool DataBufferManager::commit_buffer(const std::string &buffer_id) {
+  std::lock_guard lock(mutex_);
+  auto it = buffers_.find(buffer_id);
+  if (it == buffers_.end() || it->second.attached) {
+    LOG_WARN("DATA_BUFFER", "COMMIT", "Cannot commit unknown buffer {}",
+             buffer_id);
+    return false;
+  }
+  if (it->second.committed) {
+    return true;
+  }
+
+  publish_header(it->second.buffer->data());
+  it->second.committed = true;
+
+  LOG_INFO("DATA_BUFFER", "CREATE",
+           "Created buffer {} for {}. {} ({} elements, {} bytes)", buffer_id,
+           it->second.metadata.instrument_name, it->second.metadata.command_id,
+           it->second.metadata.element_count, it->second.metadata.byte_size);
+  return true;
+}
+
+bool DataBufferManager::abort_buffer(const std::string &buffer_id) {
+  RetiredEntry retired;
+  {
+    std::lock_guard lock(mutex_);
+    auto it = buffers_.find(buffer_id);
+    if (it == buffers_.end() || it->second.committed) {
+      return false;
+    }
+    retired = take_entry(it);
+  }
+
+  budget_cv_.notify_all();
+  retire_entry(std::move(retired));
+  LOG_DEBUG("DATA_BUFFER", "ABORT", "Discarded buffer {}", buffer_id);
+  return true;
+}
+
 std::string DataBufferManager::create_buffer_with_metadata(
     const DataBufferMetadata &metadata, const void *data) {
   return create_buffer(metadata.instrument_name, metadata.command_id,
                        metadata.data_type, metadata.element_count, data);
 }
 
+std::shared_ptr<DataBuffer>
+DataBufferManager::attach_segment(const std::string &buffer_id,
+                                  DataBufferMetadata &metadata) {
+  using namespace boost::interprocess;
+
+  std::string segment_name;
+  uint32_t generation = 0;
+  if (!parse_buffer_id(buffer_id, segment_name, generation)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<mapped_region> region;
+  try {
+    shared_memory_object shm(open_only, segment_name.c_str(), read_only);
+    region = std::make_shared<mapped_region>(shm, read_only);
+  } catch (const interprocess_exception &) {
+    return nullptr;
+  }
+
+  SegmentHeader header;
+  if (region->get_size() < SEGMENT_DATA_OFFSET) {
+    LOG_ERROR("DATA_BUFFER", "ATTACH", "Segment {} too small", buffer_id);
+    return nullptr;
+  }
+  std::memcpy(&header, region->get_address(), sizeof(header));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header.magic == 0) {
+    // Still being filled after acquire, or idle in the creator's pool
+    LOG_DEBUG("DATA_BUFFER", "ATTACH", "Buffer {} is not published",
+              buffer_id);
+    return nullptr;
+  }
+  if (header.magic != BUFFER_SEGMENT_MAGIC ||
+      header.version != BUFFER_SEGMENT_VERSION ||
+      region->get_size() < SEGMENT_DATA_OFFSET + header.byte_size) {
+    LOG_ERROR("DATA_BUFFER", "ATTACH", "Segment {} has invalid header",
+              buffer_id);
+    return nullptr;
+  }
+  if (header.generation != generation) {
+    // The creator recycled the segment for a newer buffer
+    LOG_WARN("DATA_BUFFER", "ATTACH", "Buffer {} no longer exists",
+             buffer_id);
+    return nullptr;
+  }
+
+  metadata.buffer_id = buffer_id;
+  metadata.instrument_name = header.instrument_name;
+  metadata.command_id = header.command_id;
+  metadata.data_type = static_cast<DataType>(header.data_type);
+  metadata.element_count = header.element_count;
+  metadata.byte_size = header.byte_size;
+  metadata.timestamp_ms = header.timestamp_ms;
+
+  void *data = static_cast<char *>(region->get_address()) + SEGMENT_DATA_OFFSET;
+  return std::make_shared<DataBuffer>(buffer_id, data, header.byte_size,
+                                      metadata.data_type, header.element_count,
+                                      std::move(region), true);
+}
+
 std::shared_ptr<DataBuffer>
 DataBufferManager::get_buffer(const std::string &buffer_id) {
-  std::lock_guard lock(mutex_);
-  auto it = buffers_.find(buffer_id);
-  if (it == buffers_.end()) {
+  {
+    std::lock_guard lock(mutex_);
+    auto it = buffers_.find(buffer_id);
+    if (it != buffers_.end()) {
+      BufferEntry &entry = it->second;
+      if (!entry.committed) {
+        return nullptr;
+      }
+      if (entry.spilled && !entry.buffer) {
+        entry.buffer = map_spill_file(entry.spill_path, entry.metadata);
+        if (!entry.buffer) {
+          return nullptr;
+        }
+        budget_stats_.restores++;
+      }
+      entry.ref_count++;
+      entry.last_used = ++use_clock_;
+      return entry.buffer;
+    }
+  }
+
+  // Not ours: map it from the creating process
+  DataBufferMetadata metadata;
+  auto buffer = attach_segment(buffer_id, metadata);
+  if (!buffer) {
     return nullptr;
   }
 
-  it->second.ref_count++;
-  return it->second.buffer;
+  std::shared_ptr<DataBuffer> result;
+  {
+    std::lock_guard lock(mutex_);
+    auto [it, inserted] =
+        buffers_.try_emplace(buffer_id, buffer, std::move(metadata), 1, true);
+    if (!inserted) {
+      it->second.ref_count++;
+    } else {
+      resident_bytes_ += it->second.metadata.byte_size;
+      LOG_DEBUG("DATA_BUFFER", "ATTACH", "Attached buffer {} ({} bytes)",
+                buffer_id, it->second.metadata.byte_size);
+    }
+    it->second.last_used = ++use_clock_;
+    result = it->second.buffer;
+  }
+
+  enforce_budget();
+  return result;
+}
+
+bool DataBufferManager::adopt_buffer(const std::string &buffer_id) {
+  {
+    std::lock_guard lock(mutex_);
+    auto it = buffers_.find(buffer_id);
+    if (it != buffers_.end()) {
+      it->second.ref_count++;
+      return true;
+    }
+  }
+
+  DataBufferMetadata metadata;
+  auto buffer = attach_segment(buffer_id, metadata);
+  if (!buffer) {
+    LOG_WARN("DATA_BUFFER", "ATTACH", "Cannot adopt unknown buffer {}",
+             buffer_id);
+    return false;
+  }
+
+  size_t headroom = 0;
+  {
+    std::lock_guard lock(mutex_);
+    auto [it, inserted] =
+        buffers_.try_emplace(buffer_id, buffer, std::move(metadata), 1, true);
+    if (!inserted) {
+      it->second.ref_count++;
+    } else {
+      it->second.adopted = true;
+      it->second.last_used = ++use_clock_;
+      resident_bytes_ += it->second.metadata.byte_size;
+      headroom = it->second.metadata.byte_size;
+    }
+  }
+
+  // The creator counts these pages against its own budget too; keep room
+  // for its next buffer of this size so a producer with the same budget
+  // is not left blocked waiting on us
+  enforce_budget(headroom);
+  return true;
+}
+
+void DataBufferManager::set_release_handler(const std::string &instrument_name,
+                                            ReleaseHandler handler) {
+  std::lock_guard lock(handlers_mutex_);
+  release_handlers_[instrument_name] = std::move(handler);
+}
+
+void DataBufferManager::clear_release_handler(
+    const std::string &instrument_name) {
+  std::lock_guard lock(handlers_mutex_);
+  release_handlers_.erase(instrument_name);
+}
+
+void DataBufferManager::set_reclaim_handler(ReclaimHandler handler) {
+  std::lock_guard lock(reclaim_mutex_);
+  reclaim_handler_ = std::move(handler);
+}
+
+DataBufferManager::RetiredEntry
+DataBufferManager::take_entry(BufferMap::iterator it) {
+  BufferEntry &entry = it->second;
+  RetiredEntry retired;
+  retired.buffer_id = it->first;
+  retired.instrument_name = entry.metadata.instrument_name;
+  retired.attached = entry.attached;
+  retired.spilled = entry.spilled;
+  retired.spill_path = std::move(entry.spill_path);
+  retired.segment = std::move(entry.segment);
+
+  if (entry.spilled) {
+    budget_stats_.spilled_bytes -= entry.metadata.byte_size;
+  } else {
+    resident_bytes_ -= entry.metadata.byte_size;
+  }
+  buffers_.erase(it);
+  return retired;
+}
+
+void DataBufferManager::retire_entry(RetiredEntry entry) {
+  if (entry.spilled) {
+    // The creator was told when the buffer was spilled
+    std::error_code ec;
+    std::filesystem::remove(entry.spill_path, ec);
+    return;
+  }
+
+  if (!entry.attached) {
+    recycle_segment(std::move(entry.segment));
+    return;
+  }
+
+  const std::string &buffer_id = entry.buffer_id;
+  std::lock_guard lock(handlers_mutex_);
+  auto it = release_handlers_.find(entry.instrument_name);
+  if (it != release_handlers_.end()) {
+    it->second(buffer_id);
+  } else {
+    // Nobody left to tell (creator gone); don't leak the name
+    std::string segment_name;
+    uint32_t generation;
+    if (parse_buffer_id(buffer_id, segment_name, generation)) {
+      boost::interprocess::shared_memory_object::remove(segment_name.c_str());
+    }
+  }
 }
 
 std::optional<DataBufferMetadata>
 DataBufferManager::get_metadata(const std::string &buffer_id) const {
   std::lock_guard lock(mutex_);
   auto it = buffers_.find(buffer_id);
-  if (it == buffers_.end()) {
+  if (it == buffers_.end() || !it->second.committed) {
     return std::nullopt;
   }
   return it->second.metadata;
 }
 
 void DataBufferManager::release_buffer(const std::string &buffer_id) {
-  std::lock_guard lock(mutex_);
-  auto it = buffers_.find(buffer_id);
-  if (it == buffers_.end()) {
-    return;
-  }
+  RetiredEntry retired;
+  {
+    std::lock_guard lock(mutex_);
+    auto it = buffers_.find(buffer_id);
+    if (it == buffers_.end()) {
+      return;
+    }
 
-  uint32_t ref_count = --it->second.ref_count;
-  LOG_DEBUG("DATA_BUFFER", "RELEASE", "Buffer {} ref count now {}", buffer_id,
-            ref_count);
+    uint32_t ref_count = --it->second.ref_count;
+    LOG_DEBUG("DATA_BUFFER", "RELEASE", "Buffer {} ref count now {}",
+              buffer_id, ref_count);
+
+    if (ref_count == 1 && it->second.adopted && it->second.spilled) {
+      // Back to idle: drop the file mapping until the next get_buffer()
+      it->second.buffer.reset();
+    }
+    if (ref_count != 0) {
+      return;
+    }
 
-  if (ref_count == 0) {
     LOG_INFO("DATA_BUFFER", "RELEASE", "Releasing buffer {}", buffer_id);
-    buffers_.erase(it);
+    retired = take_entry(it);
   }
+
+  budget_cv_.notify_all();
+  retire_entry(std::move(retired));
 }
 
 std::vector<std::string> DataBufferManager::list_buffers() const {
@@ -333,18 +887,275 @@ std::vector<std::string> DataBufferManager::list_buffers() const {
 }
 
 size_t DataBufferManager::total_memory_usage() const {
-  std::lock_guard lock(mutex_);
   size_t total = 0;
-  for (const auto &[_, entry] : buffers_) {
-    total += entry.metadata.byte_size;
+  {
+    std::lock_guard lock(mutex_);
+    total = resident_bytes_;
   }
-  return total;
+
+  std::lock_guard lock(pool_mutex_);
+  return total + pool_stats_.pooled_bytes;
 }
 
-void DataBufferManager::clear_all() {
+BufferPoolStats DataBufferManager::pool_stats() const {
+  std::lock_guard lock(pool_mutex_);
+  return pool_stats_;
+}
+
+void DataBufferManager::set_pool_limit(size_t bytes) {
+  std::vector<std::string> evicted;
+  {
+    std::lock_guard lock(pool_mutex_);
+    pool_limit_bytes_ = bytes;
+    for (auto &[capacity, segments] : pool_) {
+      while (pool_stats_.pooled_bytes > pool_limit_bytes_ &&
+             !segments.empty()) {
+        evicted.push_back(std::move(segments.back().name));
+        segments.pop_back();
+        pool_stats_.pooled_segments--;
+        pool_stats_.pooled_bytes -= capacity;
+        pool_stats_.evicted++;
+      }
+    }
+  }
+
+  for (const auto &name : evicted) {
+    boost::interprocess::shared_memory_object::remove(name.c_str());
+  }
+}
+
+void DataBufferManager::set_memory_budget(size_t bytes) {
+  {
+    std::lock_guard lock(mutex_);
+    budget_bytes_ = bytes;
+  }
+  budget_cv_.notify_all();
+  enforce_budget();
+}
+
+void DataBufferManager::set_spill_directory(const std::string &directory) {
+  std::lock_guard lock(mutex_);
+  spill_dir_ = directory;
+}
+
+void DataBufferManager::set_backpressure_timeout(
+    std::chrono::milliseconds timeout) {
   std::lock_guard lock(mutex_);
-  LOG_INFO("DATA_BUFFER", "CLEAR", "Clearing {} buffers", buffers_.size());
-  buffers_.clear();
+  backpressure_timeout_ = timeout;
+}
+
+BufferBudgetStats DataBufferManager::budget_stats() const {
+  std::lock_guard lock(mutex_);
+  BufferBudgetStats stats = budget_stats_;
+  stats.budget_bytes = budget_bytes_;
+  stats.resident_bytes = resident_bytes_;
+  return stats;
+}
+
+bool DataBufferManager::reserve_budget(size_t bytes) {
+  std::unique_lock lock(mutex_);
+  auto fits = [&]() {
+    return budget_bytes_ == 0 || resident_bytes_ + bytes <= budget_bytes_;
+  };
+
+  if (budget_bytes_ != 0 && bytes > budget_bytes_) {
+    budget_stats_.rejections++;
+    LOG_ERROR("DATA_BUFFER", "BUDGET",
+              "Buffer of {} bytes exceeds the {} byte memory budget", bytes,
+              budget_bytes_);
+    return false;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + backpressure_timeout_;
+  bool waited = false;
+  while (!fits()) {
+    // Make room from idle adopted buffers first
+    lock.unlock();
+    enforce_budget(bytes);
+    lock.lock();
+    if (fits()) {
+      break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      budget_stats_.rejections++;
+      LOG_WARN("DATA_BUFFER", "BUDGET",
+               "Rejecting {} byte buffer: {} of {} bytes in use", bytes,
+               resident_bytes_, budget_bytes_);
+      return false;
+    }
+    if (!waited) {
+      budget_stats_.waits++;
+      waited = true;
+    }
+
+    auto slice = std::min(
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now),
+        BUDGET_WAIT_SLICE);
+    ReclaimHandler reclaim;
+    {
+      std::lock_guard reclaim_lock(reclaim_mutex_);
+      reclaim = reclaim_handler_;
+    }
+    if (reclaim) {
+      lock.unlock();
+      reclaim(slice);
+      lock.lock();
+    } else {
+      budget_cv_.wait_for(lock, slice);
+    }
+  }
+
+  resident_bytes_ += bytes;
+  return true;
+}
+
+void DataBufferManager::enforce_budget(size_t incoming) {
+  std::vector<std::pair<std::string, std::shared_ptr<DataBuffer>>> victims;
+  {
+    std::lock_guard lock(mutex_);
+    if (budget_bytes_ == 0 || resident_bytes_ + incoming <= budget_bytes_) {
+      return;
+    }
+    size_t excess = resident_bytes_ + incoming - budget_bytes_;
+
+    // Only buffers the manager alone holds can move without anyone noticing
+    std::vector<BufferMap::iterator> idle;
+    for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+      const BufferEntry &entry = it->second;
+      if (entry.adopted && !entry.spilled && !entry.spilling &&
+          entry.ref_count == 1 && entry.metadata.byte_size > 0) {
+        idle.push_back(it);
+      }
+    }
+    std::sort(idle.begin(), idle.end(), [](const auto &a, const auto &b) {
+      return a->second.last_used < b->second.last_used;
+    });
+
+    size_t freed = 0;
+    for (auto it : idle) {
+      if (freed >= excess) {
+        break;
+      }
+      it->second.spilling = true;
+      freed += it->second.metadata.byte_size;
+      victims.emplace_back(it->first, it->second.buffer);
+    }
+  }
+
+  for (auto &[buffer_id, buffer] : victims) {
+    spill_buffer(buffer_id, std::move(buffer));
+  }
+}
+
+void DataBufferManager::spill_buffer(const std::string &buffer_id,
+                                     std::shared_ptr<DataBuffer> buffer) {
+  namespace fs = std::filesystem;
+
+  fs::path path;
+  {
+    std::lock_guard lock(mutex_);
+    path = fs::path(spill_dir_) / (buffer_id + ".bin");
+  }
+
+  // Write outside the lock; large buffers take a while
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  bool written = buffer->export_to_file(path.string());
+
+  RetiredEntry released;
+  {
+    std::lock_guard lock(mutex_);
+    auto it = buffers_.find(buffer_id);
+    bool still_idle = it != buffers_.end() && it->second.ref_count == 1;
+    if (it != buffers_.end()) {
+      it->second.spilling = false;
+    }
+    if (!written || !still_idle) {
+      if (!written) {
+        LOG_ERROR("DATA_BUFFER", "SPILL", "Failed to write {}",
+                  path.string());
+      }
+      fs::remove(path, ec);
+      return;
+    }
+
+    BufferEntry &entry = it->second;
+    entry.buffer.reset();
+    entry.spilled = true;
+    entry.spill_path = path.string();
+    resident_bytes_ -= entry.metadata.byte_size;
+    budget_stats_.spilled_bytes += entry.metadata.byte_size;
+    budget_stats_.spills++;
+
+    // Hand the shared memory back to its creator as if released
+    released.buffer_id = buffer_id;
+    released.instrument_name = entry.metadata.instrument_name;
+    released.attached = true;
+
+    LOG_INFO("DATA_BUFFER", "SPILL", "Spilled buffer {} ({} bytes) to {}",
+             buffer_id, entry.metadata.byte_size, entry.spill_path);
+  }
+
+  buffer.reset();
+  budget_cv_.notify_all();
+  retire_entry(std::move(released));
+}
+
+std::shared_ptr<DataBuffer>
+DataBufferManager::map_spill_file(const std::string &path,
+                                  const DataBufferMetadata &metadata) {
+  using namespace boost::interprocess;
+
+  std::shared_ptr<mapped_region> region;
+  try {
+    file_mapping file(path.c_str(), read_only);
+    region = std::make_shared<mapped_region>(file, read_only);
+  } catch (const interprocess_exception &ex) {
+    LOG_ERROR("DATA_BUFFER", "SPILL", "Failed to map {}: {}", path,
+              ex.what());
+    return nullptr;
+  }
+
+  return std::make_shared<DataBuffer>(
+      metadata.buffer_id, region->get_address(), metadata.byte_size,
+      metadata.data_type, metadata.element_count, std::move(region), true);
+}
+
+void DataBufferManager::clear_all() {
+  std::vector<RetiredEntry> retired;
+  {
+    std::lock_guard lock(mutex_);
+    LOG_INFO("DATA_BUFFER", "CLEAR", "Clearing {} buffers", buffers_.size());
+    retired.reserve(buffers_.size());
+    while (!buffers_.empty()) {
+      retired.push_back(take_entry(buffers_.begin()));
+    }
+  }
+  budget_cv_.notify_all();
+
+  for (auto &entry : retired) {
+    retire_entry(std::move(entry));
+  }
+
+  // Drop everything just recycled as well as older idle segments
+  std::vector<std::string> pooled;
+  {
+    std::lock_guard lock(pool_mutex_);
+    for (auto &[_, segments] : pool_) {
+      for (auto &segment : segments) {
+        pooled.push_back(std::move(segment.name));
+      }
+    }
+    pool_.clear();
+    pool_stats_.pooled_segments = 0;
+    pool_stats_.pooled_bytes = 0;
+  }
+
+  for (const auto &name : pooled) {
+    boost::interprocess::shared_memory_object::remove(name.c_str());
+  }
 }
 
 } // namespace ipc
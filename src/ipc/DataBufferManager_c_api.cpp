@@ -2,6 +2,19 @@
 #include "instrument-server/ipc/DataBufferManager.hpp"
 #include <cstring>
 
+namespace {
+
+void copy_buffer_id(char *buffer_id_out, const std::string &buffer_id) {
+#ifdef _WIN32
+  strncpy_s(buffer_id_out, 128, buffer_id.c_str(), 127);
+#else
+  strncpy(buffer_id_out, buffer_id.c_str(), 127);
+  buffer_id_out[127] = '\0';
+#endif
+}
+
+} // namespace
+
 extern "C" {
 
 int data_buffer_create(const char *instrument_name, const char *command_id,
@@ -22,19 +35,64 @@ int data_buffer_create(const char *instrument_name, const char *command_id,
       return -1;
     }
 
-#ifdef _WIN32
-    strncpy_s(buffer_id_out, 128, buffer_id.c_str(), 127);
-#else
-    strncpy(buffer_id_out, buffer_id.c_str(), 127);
-    buffer_id_out[127] = '\0';
-#endif
+    copy_buffer_id(buffer_id_out, buffer_id);
+    return 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+int data_buffer_acquire(const char *instrument_name, const char *command_id,
+                        uint8_t data_type, size_t element_count,
+                        void **data_out, char *buffer_id_out) {
+  if (!instrument_name || !command_id || !data_out || !buffer_id_out) {
+    return -1;
+  }
 
+  try {
+    auto &manager = instserver::ipc::DataBufferManager::instance();
+
+    auto dtype = static_cast<instserver::ipc::DataType>(data_type);
+    std::string buffer_id = manager.acquire_buffer(
+        instrument_name, command_id, dtype, element_count, data_out);
+
+    if (buffer_id.empty()) {
+      return -1;
+    }
+
+    copy_buffer_id(buffer_id_out, buffer_id);
     return 0;
   } catch (...) {
     return -1;
   }
 }
 
+int data_buffer_commit(const char *buffer_id) {
+  if (!buffer_id) {
+    return -1;
+  }
+
+  try {
+    auto &manager = instserver::ipc::DataBufferManager::instance();
+    return manager.commit_buffer(buffer_id) ? 0 : -1;
+  } catch (...) {
+    return -1;
+  }
+}
+
+int data_buffer_abort(const char *buffer_id) {
+  if (!buffer_id) {
+    return -1;
+  }
+
+  try {
+    auto &manager = instserver::ipc::DataBufferManager::instance();
+    return manager.abort_buffer(buffer_id) ? 0 : -1;
+  } catch (...) {
+    return -1;
+  }
+}
+
 size_t data_buffer_total_memory(void) {
   try {
     auto &manager = instserver::ipc::DataBufferManager::instance();
@@ -0,0 +1,189 @@
+#include "instrument-server/ipc/EventReactor.hpp"
+#include "instrument-server/Logger.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace instserver {
+namespace ipc {
+
+EventReactor &EventReactor::instance() {
+  // Never destroyed: proxies owned by other singletons unregister during
+  // static destruction, and the thread sleeps in epoll_wait until exit
+  static EventReactor *reactor = new EventReactor();
+  return *reactor;
+}
+
+#if defined(__linux__)
+
+bool EventReactor::supported() { return true; }
+
+int EventReactor::make_doorbell() {
+  int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd < 0) {
+    LOG_ERROR("IPC", "REACTOR", "eventfd failed: {}", std::strerror(errno));
+  }
+  return fd;
+}
+
+void EventReactor::ring_doorbell(int fd) {
+  uint64_t one = 1;
+  ssize_t ignored = write(fd, &one, sizeof(one));
+  (void)ignored;
+}
+
+bool EventReactor::start_locked() {
+  if (epoll_fd_ >= 0)
+    return true;
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    LOG_ERROR("IPC", "REACTOR", "epoll_create1 failed: {}",
+              std::strerror(errno));
+    return false;
+  }
+  thread_ = std::thread([this]() { run(); });
+  thread_.detach();
+  LOG_INFO("IPC", "REACTOR", "Event reactor started");
+  return true;
+}
+
+bool EventReactor::add(const void *owner, int doorbell_fd, int exit_fd,
+                       Handlers handlers) {
+  std::lock_guard lock(mutex_);
+  if (!start_locked() || watches_.count(owner))
+    return false;
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = doorbell_fd;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, doorbell_fd, &ev) != 0) {
+    LOG_ERROR("IPC", "REACTOR", "Cannot watch doorbell: {}",
+              std::strerror(errno));
+    return false;
+  }
+  fd_owners_[doorbell_fd] = owner;
+
+  if (exit_fd >= 0) {
+    ev.data.fd = exit_fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, exit_fd, &ev) == 0) {
+      fd_owners_[exit_fd] = owner;
+    } else {
+      LOG_WARN("IPC", "REACTOR", "Cannot watch process exit: {}",
+               std::strerror(errno));
+      exit_fd = -1;
+    }
+  }
+
+  watches_[owner] = Watch{doorbell_fd, exit_fd, std::move(handlers)};
+  return true;
+}
+
+void EventReactor::remove(const void *owner) {
+  std::unique_lock lock(mutex_);
+  auto it = watches_.find(owner);
+  if (it == watches_.end())
+    return;
+
+  for (int fd : {it->second.doorbell_fd, it->second.exit_fd}) {
+    if (fd >= 0 && fd_owners_.erase(fd))
+      epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+  }
+
+  idle_cv_.wait(lock, [&]() { return dispatching_ != owner; });
+  watches_.erase(owner);
+}
+
+void EventReactor::run() {
+  constexpr int MAX_EVENTS = 16;
+  epoll_event events[MAX_EVENTS];
+
+  while (true) {
+    int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG_ERROR("IPC", "REACTOR", "epoll_wait failed: {}",
+                std::strerror(errno));
+      return;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      const Handlers *handlers = nullptr;
+      bool exited = false;
+      {
+        std::lock_guard lock(mutex_);
+        auto owner_it = fd_owners_.find(fd);
+        if (owner_it == fd_owners_.end())
+          continue; // Removed after epoll_wait returned
+        const void *owner = owner_it->second;
+        Watch &watch = watches_[owner];
+        exited = fd == watch.exit_fd;
+        if (exited) {
+          // Stays readable forever; report the exit once
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+          fd_owners_.erase(owner_it);
+          watch.exit_fd = -1;
+        } else {
+          // Clear before draining; a frame sent after the drain rings again
+          uint64_t count;
+          ssize_t ignored = read(fd, &count, sizeof(count));
+          (void)ignored;
+        }
+        dispatching_ = owner;
+        handlers = &watch.handlers;
+      }
+
+      try {
+        // Pick up everything the worker sent before it died
+        if (handlers->on_readable)
+          handlers->on_readable();
+        if (exited && handlers->on_exit)
+          handlers->on_exit();
+      } catch (const std::exception &ex) {
+        LOG_ERROR("IPC", "REACTOR", "Handler failed: {}", ex.what());
+      }
+
+      {
+        std::lock_guard lock(mutex_);
+        dispatching_ = nullptr;
+      }
+      idle_cv_.notify_all();
+    }
+  }
+}
+
+#else
+
+bool EventReactor::supported() { return false; }
+
+int EventReactor::make_doorbell() { return -1; }
+
+void EventReactor::ring_doorbell(int fd) { (void)fd; }
+
+bool EventReactor::start_locked() { return false; }
+
+bool EventReactor::add(const void *owner, int doorbell_fd, int exit_fd,
+                       Handlers handlers) {
+  (void)owner;
+  (void)doorbell_fd;
+  (void)exit_fd;
+  (void)handlers;
+  return false;
+}
+
+void EventReactor::remove(const void *owner) { (void)owner; }
+
+void EventReactor::run() {}
+
+#endif
+
+} // namespace ipc
+} // namespace instserver
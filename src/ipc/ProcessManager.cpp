@@ -1,31 +1,46 @@
 #include "instrument-server/ipc/ProcessManager.hpp"
 #include "instrument-server/Logger.hpp"
 
+#include <cerrno>
 #include <sstream>
 
 #ifdef _WIN32
 #include <processthreadsapi.h>
 #else
+#include <fcntl.h>
+#include <poll.h>
 #include <spawn.h>
 #include <sys/wait.h>
 #include <unistd.h>
 extern char **environ;
 #endif
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 namespace instserver {
 namespace ipc {
 
 ProcessManager::~ProcessManager() { cleanup_all(); }
 
-ProcessId ProcessManager::spawn_worker(const std::string &instrument_name,
-                                       const std::string &plugin_path,
-                                       const std::string &worker_executable) {
+ProcessId
+ProcessManager::spawn_worker(const std::string &instrument_name,
+                             const std::string &plugin_path,
+                             const std::string &worker_executable,
+                             int doorbell_fd,
+                             const std::vector<std::string> &extra_args) {
   LOG_INFO("PROCESS", "SPAWN",
            "Spawning worker for instrument:  {} with plugin: {}",
            instrument_name, plugin_path);
 
   std::vector<std::string> args = {worker_executable, instrument_name,
                                    plugin_path};
+#ifndef _WIN32
+  if (doorbell_fd >= 0)
+    args.push_back("--doorbell-fd=" + std::to_string(WORKER_DOORBELL_FD));
+#endif
+  args.insert(args.end(), extra_args.begin(), extra_args.end());
 
 #ifdef _WIN32
   // Windows:  spawn_process_impl needs to return both PID and HANDLE
@@ -50,7 +65,7 @@ ProcessId ProcessManager::spawn_worker(const std::string &instrument_name,
   }
 #else
   // POSIX: spawn_process_impl just returns PID
-  ProcessId pid = spawn_process_impl(args);
+  ProcessId pid = spawn_process_impl(args, doorbell_fd);
 
   if (pid == 0) {
     LOG_ERROR("PROCESS", "SPAWN", "Failed to spawn worker for:  {}",
@@ -108,6 +123,20 @@ bool ProcessManager::kill_process(ProcessId pid, bool force) {
 
 bool ProcessManager::wait_for_exit(ProcessId pid,
                                    std::chrono::milliseconds timeout) {
+  // Sleep until the exit itself instead of polling
+  int exit_fd = open_exit_fd(pid);
+  if (exit_fd >= 0) {
+#ifndef _WIN32
+    pollfd pfd{exit_fd, POLLIN, 0};
+    int ready;
+    do {
+      ready = poll(&pfd, 1, static_cast<int>(timeout.count()));
+    } while (ready < 0 && errno == EINTR);
+    close(exit_fd);
+#endif
+    return !is_alive(pid);
+  }
+
   auto deadline = std::chrono::steady_clock::now() + timeout;
 
   while (std::chrono::steady_clock::now() < deadline) {
@@ -120,6 +149,20 @@ bool ProcessManager::wait_for_exit(ProcessId pid,
   return false;
 }
 
+int ProcessManager::open_exit_fd(ProcessId pid) const {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  {
+    std::lock_guard lock(mutex_);
+    if (!processes_.count(pid))
+      return -1;
+  }
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+  (void)pid;
+  return -1;
+#endif
+}
+
 const ProcessManager::ProcessInfo *
 ProcessManager::get_process_info(ProcessId pid) const {
   std::lock_guard lock(mutex_);
@@ -248,7 +291,9 @@ void ProcessManager::heartbeat_monitor_loop() {
 #ifdef _WIN32
 
 ProcessId
-ProcessManager::spawn_process_impl(const std::vector<std::string> &args) {
+ProcessManager::spawn_process_impl(const std::vector<std::string> &args,
+                                   int doorbell_fd) {
+  (void)doorbell_fd;
   std::ostringstream cmdline;
   for (size_t i = 0; i < args.size(); ++i) {
     if (i > 0)
@@ -303,16 +348,32 @@ bool ProcessManager::is_alive_impl(ProcessHandle handle) const {
 #else // POSIX
 
 ProcessId
-ProcessManager::spawn_process_impl(const std::vector<std::string> &args) {
+ProcessManager::spawn_process_impl(const std::vector<std::string> &args,
+                                   int doorbell_fd) {
   std::vector<char *> argv;
   for (const auto &arg : args) {
     argv.push_back(const_cast<char *>(arg.c_str()));
   }
   argv.push_back(nullptr);
 
+  // Hand the doorbell to the child at a fixed number; everything else the
+  // server opened stays close-on-exec. dup2 onto itself would keep the
+  // close-on-exec flag, so move it out of the way first.
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  int source = doorbell_fd;
+  if (doorbell_fd == WORKER_DOORBELL_FD)
+    source = fcntl(doorbell_fd, F_DUPFD_CLOEXEC, WORKER_DOORBELL_FD + 1);
+  if (source >= 0)
+    posix_spawn_file_actions_adddup2(&actions, source, WORKER_DOORBELL_FD);
+
   pid_t pid;
   int status =
-      posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+      posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+
+  posix_spawn_file_actions_destroy(&actions);
+  if (source != doorbell_fd && source >= 0)
+    close(source);
 
   if (status != 0) {
     LOG_ERROR("PROCESS", "SPAWN", "posix_spawn failed: {} with arg {}",
@@ -0,0 +1,299 @@
+#include "instrument-server/ipc/SharedBarrier.hpp"
+#include "instrument-server/Logger.hpp"
+#include "instrument-server/ipc/Futex.hpp"
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace instserver {
+namespace ipc {
+
+namespace {
+
+constexpr uint32_t BARRIER_SEGMENT_MAGIC = 0x42524153; // "SARB"
+constexpr size_t BARRIER_CACHE_LINE = 64;
+
+// How long an arrival spins before parking on the futex. Most barriers in a
+// gate sweep open within this, and a spinning worker sees it within a
+// scheduler quantum instead of a futex wakeup.
+constexpr auto SPIN_TIME = std::chrono::microseconds(200);
+
+// Epochs are 31 bits so the open word can carry a broken flag beside one
+constexpr uint32_t EPOCH_MASK = 0x7FFFFFFF;
+
+uint32_t next_epoch(uint32_t epoch) {
+  epoch = (epoch + 1) & EPOCH_MASK;
+  return epoch == 0 ? 1 : epoch;
+}
+
+/// True if the open word records `epoch` or a later one
+bool epoch_reached(uint32_t open_word, uint32_t epoch) {
+  uint32_t distance = ((open_word >> 1) - epoch) & EPOCH_MASK;
+  return distance < (EPOCH_MASK >> 1);
+}
+
+uint64_t pack_arrivals(uint32_t epoch, uint32_t expected, uint32_t arrived) {
+  return (static_cast<uint64_t>(epoch) << 32) |
+         (static_cast<uint64_t>(expected) << 16) | arrived;
+}
+
+bool env_enabled(const char *name) {
+  const char *value = std::getenv(name);
+  if (!value)
+    return false;
+  return std::strcmp(value, "1") == 0 || std::strcmp(value, "true") == 0 ||
+         std::strcmp(value, "on") == 0;
+}
+
+} // namespace
+
+struct SharedBarrierTable::Segment {
+  struct Slot {
+    // epoch << 32 | expected << 16 | arrived; one CAS per arrival
+    alignas(BARRIER_CACHE_LINE) std::atomic<uint64_t> arrivals;
+    // epoch << 1 | broken, set once per epoch; the futex word waiters park on
+    alignas(BARRIER_CACHE_LINE) std::atomic<uint32_t> opened;
+  };
+
+  uint32_t magic;
+  uint32_t slot_count;
+  Slot slots[SHARED_BARRIER_SLOTS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared barriers require lock-free 64-bit atomics");
+
+/// Publish the end of `epoch` unless the slot already recorded it (or a
+/// later one), then wake everyone parked on the slot
+static void open_slot(std::atomic<uint32_t> &opened, uint32_t epoch,
+                      bool broken) {
+  uint32_t desired = (epoch << 1) | (broken ? 1u : 0u);
+  uint32_t current = opened.load(std::memory_order_acquire);
+  do {
+    if (epoch_reached(current, epoch))
+      return;
+  } while (!opened.compare_exchange_weak(current, desired,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire));
+  futex_wake_all(opened);
+}
+
+SharedBarrierTable::SharedBarrierTable(std::string name,
+                                       std::shared_ptr<void> region,
+                                       Segment *segment, bool owner)
+    : name_(std::move(name)), region_(std::move(region)), segment_(segment),
+      owner_(owner) {
+  if (owner_) {
+    free_slots_.reserve(SHARED_BARRIER_SLOTS);
+    for (uint32_t i = SHARED_BARRIER_SLOTS; i > 0; --i)
+      free_slots_.push_back(i - 1);
+    epochs_.assign(SHARED_BARRIER_SLOTS, 0);
+    armed_.assign(SHARED_BARRIER_SLOTS, false);
+  }
+}
+
+SharedBarrierTable::~SharedBarrierTable() {
+  region_.reset();
+  if (owner_)
+    boost::interprocess::shared_memory_object::remove(name_.c_str());
+}
+
+SharedBarrierTable *SharedBarrierTable::server() {
+  static std::unique_ptr<SharedBarrierTable> table;
+  static std::once_flag once;
+
+  std::call_once(once, [] {
+    if (!env_enabled("INSTRUMENT_SCRIPT_SERVER_SHARED_BARRIERS"))
+      return;
+    table = create("instrument_sync_" +
+                   std::to_string(static_cast<long>(getpid())));
+    if (table) {
+      LOG_INFO("SYNC", "SHARED", "Shared barriers enabled ({} slots in {})",
+               SHARED_BARRIER_SLOTS, table->name());
+    }
+  });
+
+  return table.get();
+}
+
+std::unique_ptr<SharedBarrierTable>
+SharedBarrierTable::create(const std::string &name) {
+  using namespace boost::interprocess;
+  shared_memory_object::remove(name.c_str());
+  try {
+    shared_memory_object shm(create_only, name.c_str(), read_write);
+    shm.truncate(static_cast<offset_t>(sizeof(Segment)));
+    auto region = std::make_shared<mapped_region>(shm, read_write);
+
+    auto *segment = new (region->get_address()) Segment;
+    for (auto &slot : segment->slots) {
+      slot.arrivals.store(0, std::memory_order_relaxed);
+      slot.opened.store(0, std::memory_order_relaxed);
+    }
+    segment->slot_count = SHARED_BARRIER_SLOTS;
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->magic = BARRIER_SEGMENT_MAGIC;
+
+    return std::unique_ptr<SharedBarrierTable>(
+        new SharedBarrierTable(name, std::move(region), segment, true));
+  } catch (const interprocess_exception &ex) {
+    LOG_ERROR("SYNC", "SHARED", "Failed to create barrier segment {}: {}",
+              name, ex.what());
+    shared_memory_object::remove(name.c_str());
+    return nullptr;
+  }
+}
+
+std::unique_ptr<SharedBarrierTable>
+SharedBarrierTable::open(const std::string &name) {
+  using namespace boost::interprocess;
+  try {
+    shared_memory_object shm(open_only, name.c_str(), read_write);
+    auto region = std::make_shared<mapped_region>(shm, read_write);
+    if (region->get_size() < sizeof(Segment)) {
+      LOG_ERROR("SYNC", "SHARED", "Barrier segment {} is too small", name);
+      return nullptr;
+    }
+
+    auto *segment = static_cast<Segment *>(region->get_address());
+    if (segment->magic != BARRIER_SEGMENT_MAGIC ||
+        segment->slot_count != SHARED_BARRIER_SLOTS) {
+      LOG_ERROR("SYNC", "SHARED", "Barrier segment {} has an unknown layout",
+                name);
+      return nullptr;
+    }
+
+    return std::unique_ptr<SharedBarrierTable>(
+        new SharedBarrierTable(name, std::move(region), segment, false));
+  } catch (const interprocess_exception &ex) {
+    LOG_ERROR("SYNC", "SHARED", "Failed to open barrier segment {}: {}", name,
+              ex.what());
+    return nullptr;
+  }
+}
+
+std::optional<SharedBarrierTicket>
+SharedBarrierTable::arm(uint32_t participants) {
+  if (!owner_ || participants == 0 ||
+      participants > SHARED_BARRIER_MAX_PARTICIPANTS)
+    return std::nullopt;
+
+  std::lock_guard lock(mutex_);
+  if (free_slots_.empty())
+    return std::nullopt;
+
+  SharedBarrierTicket ticket;
+  ticket.slot = free_slots_.back();
+  free_slots_.pop_back();
+  armed_[ticket.slot] = true;
+  ticket.epoch = epochs_[ticket.slot] = next_epoch(epochs_[ticket.slot]);
+
+  // Arrivals for the previous epoch fail their CAS from here on
+  segment_->slots[ticket.slot].arrivals.store(
+      pack_arrivals(ticket.epoch, participants, 0), std::memory_order_release);
+  return ticket;
+}
+
+void SharedBarrierTable::disarm(SharedBarrierTicket ticket) {
+  if (!owner_ || ticket.slot >= SHARED_BARRIER_SLOTS)
+    return;
+
+  std::lock_guard lock(mutex_);
+  if (!armed_[ticket.slot] || epochs_[ticket.slot] != ticket.epoch)
+    return;
+
+  auto &slot = segment_->slots[ticket.slot];
+  if (!epoch_reached(slot.opened.load(std::memory_order_acquire),
+                     ticket.epoch)) {
+    LOG_WARN("SYNC", "SHARED",
+             "Breaking barrier slot {} epoch {} before all workers arrived",
+             ticket.slot, ticket.epoch);
+    open_slot(slot.opened, ticket.epoch, true);
+  }
+  armed_[ticket.slot] = false;
+  free_slots_.push_back(ticket.slot);
+}
+
+size_t SharedBarrierTable::armed_count() const {
+  std::lock_guard lock(mutex_);
+  return owner_ ? SHARED_BARRIER_SLOTS - free_slots_.size() : 0;
+}
+
+SharedBarrierTable::WaitResult SharedBarrierTable::arrive_and_wait(
+    SharedBarrierTicket ticket, std::chrono::milliseconds timeout,
+    const std::function<void()> &on_idle,
+    std::chrono::milliseconds idle_interval) {
+  if (ticket.slot >= SHARED_BARRIER_SLOTS)
+    return WaitResult::STALE;
+  auto &slot = segment_->slots[ticket.slot];
+
+  uint64_t current = slot.arrivals.load(std::memory_order_acquire);
+  uint32_t arrived = 0;
+  uint32_t expected = 0;
+  do {
+    if (static_cast<uint32_t>(current >> 32) != ticket.epoch)
+      return WaitResult::STALE;
+    expected = static_cast<uint32_t>(current >> 16) & 0xFFFF;
+    arrived = (static_cast<uint32_t>(current) & 0xFFFF) + 1;
+    if (arrived > expected)
+      return WaitResult::STALE;
+  } while (!slot.arrivals.compare_exchange_weak(current, current + 1,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire));
+
+  // The last arrival opens the slot, unless someone already broke it
+  if (arrived == expected)
+    open_slot(slot.opened, ticket.epoch, false);
+
+  auto outcome = [&](uint32_t word) {
+    // Only this epoch's own word says it opened cleanly; a later one means
+    // the server gave up on it and moved on
+    return (word >> 1) == ticket.epoch && !(word & 1) ? WaitResult::RELEASED
+                                                      : WaitResult::BROKEN;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  auto now = start;
+  while (now - start < SPIN_TIME) {
+    uint32_t word = slot.opened.load(std::memory_order_acquire);
+    if (epoch_reached(word, ticket.epoch))
+      return outcome(word);
+    std::this_thread::yield();
+    now = std::chrono::steady_clock::now();
+  }
+
+  auto deadline = start + timeout;
+  auto next_idle = now + idle_interval;
+  while (true) {
+    uint32_t word = slot.opened.load(std::memory_order_acquire);
+    if (epoch_reached(word, ticket.epoch))
+      return outcome(word);
+
+    now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      open_slot(slot.opened, ticket.epoch, true);
+      return WaitResult::TIMED_OUT;
+    }
+    if (now >= next_idle) {
+      if (on_idle)
+        on_idle();
+      next_idle = now + idle_interval;
+    }
+
+    futex_wait(slot.opened, word, std::min(deadline, next_idle) - now);
+  }
+}
+
+} // namespace ipc
+} // namespace instserver
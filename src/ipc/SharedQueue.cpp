@@ -1,7 +1,10 @@
 #include "instrument-server/ipc/SharedQueue.hpp"
 #include "instrument-server/Logger.hpp"
+#include "instrument-server/ipc/EventReactor.hpp"
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/interprocess/creation_tags.hpp>
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 
@@ -13,25 +16,65 @@ static std::string make_queue_name(const std::string &instrument_name,
   return "instrument_" + instrument_name + "_" + suffix;
 }
 
+// Name of the object holding the ring pair inside the ring segment
+static const char *RING_OBJECT_NAME = "spsc_rings";
+
+// Segment size for the ring pair plus managed_shared_memory bookkeeping
+static constexpr size_t RING_SEGMENT_SIZE = sizeof(SpscRingPair) + 64 * 1024;
+
+std::optional<QueueTransport> parse_queue_transport(const std::string &name) {
+  if (name == "message_queue")
+    return QueueTransport::MESSAGE_QUEUE;
+  if (name == "spsc_ring")
+    return QueueTransport::SPSC_RING;
+  return std::nullopt;
+}
+
+const char *queue_transport_name(QueueTransport t) {
+  switch (t) {
+  case QueueTransport::MESSAGE_QUEUE:
+    return "message_queue";
+  case QueueTransport::SPSC_RING:
+    return "spsc_ring";
+  }
+  return "unknown";
+}
+
 std::unique_ptr<SharedQueue>
-SharedQueue::create_server_queue(const std::string &instrument_name) {
+SharedQueue::create_server_queue(const std::string &instrument_name,
+                                 QueueTransport transport) {
   using namespace boost::interprocess;
 
   std::string req_name = make_queue_name(instrument_name, "req");
   std::string resp_name = make_queue_name(instrument_name, "resp");
+  std::string ring_name = make_queue_name(instrument_name, "ring");
 
-  // Remove existing queues if any
+  // Remove existing queues of either transport so the worker's probe
+  // cannot pick up a stale one
   message_queue::remove(req_name.c_str());
   message_queue::remove(resp_name.c_str());
+  shared_memory_object::remove(ring_name.c_str());
 
   try {
+    if (transport == QueueTransport::SPSC_RING) {
+      auto segment = std::make_unique<managed_shared_memory>(
+          create_only, ring_name.c_str(), RING_SEGMENT_SIZE);
+      auto *rings = segment->construct<SpscRingPair>(RING_OBJECT_NAME)();
+
+      LOG_INFO("IPC", "QUEUE_CREATE", "Created SPSC rings for instrument: {}",
+               instrument_name);
+
+      return std::make_unique<SharedQueue>(std::move(segment), rings,
+                                           ring_name, true);
+    }
+
     auto req_queue =
         std::make_unique<message_queue>(create_only, req_name.c_str(),
-                                        100, // max messages
-                                        sizeof(IPCMessage));
+                                        100, // max frames
+                                        IPC_MAX_FRAME);
 
     auto resp_queue = std::make_unique<message_queue>(
-        create_only, resp_name.c_str(), 100, sizeof(IPCMessage));
+        create_only, resp_name.c_str(), 100, IPC_MAX_FRAME);
 
     LOG_INFO("IPC", "QUEUE_CREATE", "Created queues for instrument: {}",
              instrument_name);
@@ -51,6 +94,22 @@ SharedQueue::create_worker_queue(const std::string &instrument_name) {
 
   std::string req_name = make_queue_name(instrument_name, "req");
   std::string resp_name = make_queue_name(instrument_name, "resp");
+  std::string ring_name = make_queue_name(instrument_name, "ring");
+
+  // Ring segment present means the server selected the SPSC transport
+  try {
+    auto segment =
+        std::make_unique<managed_shared_memory>(open_only, ring_name.c_str());
+    auto *rings = segment->find<SpscRingPair>(RING_OBJECT_NAME).first;
+    if (rings) {
+      LOG_INFO("IPC", "QUEUE_OPEN", "Opened SPSC rings for instrument: {}",
+               instrument_name);
+      return std::make_unique<SharedQueue>(std::move(segment), rings,
+                                           ring_name, false);
+    }
+  } catch (const interprocess_exception &) {
+    // No ring segment; fall through to message queues
+  }
 
   try {
     auto req_queue =
@@ -76,33 +135,129 @@ instserver::ipc::SharedQueue::SharedQueue(
     std::unique_ptr<boost::interprocess::message_queue> req_queue,
     std::unique_ptr<boost::interprocess::message_queue> resp_queue,
     const std::string &req_name, const std::string &resp_name, bool is_server)
-    : request_queue_(std::move(req_queue)),
+    : transport_(QueueTransport::MESSAGE_QUEUE),
+      request_queue_(std::move(req_queue)),
       response_queue_(std::move(resp_queue)), request_queue_name_(req_name),
       response_queue_name_(resp_name), is_server_(is_server) {}
 
+instserver::ipc::SharedQueue::SharedQueue(
+    std::unique_ptr<boost::interprocess::managed_shared_memory> segment,
+    SpscRingPair *rings, const std::string &segment_name, bool is_server)
+    : transport_(QueueTransport::SPSC_RING), ring_segment_(std::move(segment)),
+      rings_(rings), request_queue_name_(segment_name),
+      response_queue_name_(segment_name), is_server_(is_server) {}
+
 instserver::ipc::SharedQueue::~SharedQueue() {
   // Queues are automatically closed when unique_ptr is destroyed
 }
 
-bool instserver::ipc::SharedQueue::send(const IPCMessage &msg,
-                                        std::chrono::milliseconds timeout) {
+size_t SharedQueue::send_depth() const {
   if (!is_valid())
-    return false;
+    return 0;
+  if (transport_ == QueueTransport::SPSC_RING)
+    return (is_server_ ? rings_->request : rings_->response).size();
+  return send_queue()->get_num_msg();
+}
 
-  try {
+size_t SharedQueue::send_capacity() const {
+  if (!is_valid())
+    return 0;
+  if (transport_ == QueueTransport::SPSC_RING)
+    return SPSC_RING_SLOTS;
+  return send_queue()->get_max_msg();
+}
+
+bool SharedQueue::send_frame(const char *frame, size_t size,
+                             std::chrono::milliseconds timeout) {
+  bool sent;
+  if (transport_ == QueueTransport::SPSC_RING) {
+    auto &ring = is_server_ ? rings_->request : rings_->response;
+    sent = ring.push(frame, size, timeout);
+  } else {
     auto abs_time = boost::posix_time::microsec_clock::universal_time() +
                     boost::posix_time::milliseconds(timeout.count());
 
     // Server sends on request queue, worker sends on response queue
-    auto *queue = is_server_ ? request_queue_.get() : response_queue_.get();
-    bool sent = queue->timed_send(&msg, sizeof(msg), 0, abs_time);
+    sent = send_queue()->timed_send(frame, size, 0, abs_time);
+  }
 
-    if (!sent) {
-      LOG_WARN("IPC", "SEND_TIMEOUT", "Send timeout on queue: {}",
-               request_queue_name_);
-    }
+  // Per frame, so a receiver draining a large message never waits on
+  // frames it was not told about
+  if (sent && doorbell_fd_ >= 0)
+    EventReactor::ring_doorbell(doorbell_fd_);
+  return sent;
+}
 
-    return sent;
+bool SharedQueue::receive_frame(char *frame, size_t &size,
+                                std::chrono::milliseconds timeout) {
+  if (transport_ == QueueTransport::SPSC_RING) {
+    auto &ring = is_server_ ? rings_->response : rings_->request;
+    if (timeout.count() == 0)
+      return ring.try_pop(frame, IPC_MAX_FRAME, size); // Skip the spin
+    return ring.pop(frame, IPC_MAX_FRAME, size, timeout);
+  }
+
+  unsigned int priority;
+  auto abs_time = boost::posix_time::microsec_clock::universal_time() +
+                  boost::posix_time::milliseconds(timeout.count());
+
+  // Server receives on response queue, worker receives on request queue
+  auto *queue = is_server_ ? response_queue_.get() : request_queue_.get();
+  return queue->timed_receive(frame, IPC_MAX_FRAME, size, priority, abs_time);
+}
+
+bool SharedQueue::send(const IPCMessage &msg,
+                       std::chrono::milliseconds timeout) {
+  if (!is_valid())
+    return false;
+
+  if (msg.payload.size() > IPC_MAX_MESSAGE_SIZE) {
+    LOG_ERROR("IPC", "SEND_SIZE", "Payload too large: {} bytes (max {})",
+              msg.payload.size(), IPC_MAX_MESSAGE_SIZE);
+    return false;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  IPCFrameHeader header;
+  header.type = static_cast<uint32_t>(msg.type);
+  header.id = msg.id;
+  header.sync_token = msg.sync_token;
+  header.total_size = static_cast<uint32_t>(msg.payload.size());
+
+  char frame[IPC_MAX_FRAME];
+  size_t offset = 0;
+
+  // Frames of one message must not interleave with another sender's, and
+  // each SPSC ring allows a single producer
+  std::lock_guard<std::mutex> lock(send_mutex_);
+
+  try {
+    do {
+      size_t body = std::min(msg.payload.size() - offset, IPC_MAX_FRAME_BODY);
+      header.body_size = static_cast<uint32_t>(body);
+      header.flags = 0;
+      if (offset > 0)
+        header.flags |= IPC_FRAME_CONTINUATION;
+      if (offset + body < msg.payload.size())
+        header.flags |= IPC_FRAME_MORE;
+
+      std::memcpy(frame, &header, sizeof(header));
+      std::memcpy(frame + sizeof(header), msg.payload.data() + offset, body);
+
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (!send_frame(frame, sizeof(header) + body,
+                      std::max(remaining, std::chrono::milliseconds(0)))) {
+        LOG_WARN("IPC", "SEND_TIMEOUT", "Send timeout on queue: {}",
+                 request_queue_name_);
+        return false;
+      }
+
+      offset += body;
+    } while (offset < msg.payload.size());
+
+    return true;
   } catch (const boost::interprocess::interprocess_exception &ex) {
     LOG_ERROR("IPC", "SEND_ERROR", "Send failed: {}", ex.what());
     return false;
@@ -114,32 +269,72 @@ SharedQueue::receive(std::chrono::milliseconds timeout) {
   if (!is_valid())
     return std::nullopt;
 
-  try {
-    IPCMessage msg;
-    size_t received_size;
-    unsigned int priority;
-
-    auto abs_time = boost::posix_time::microsec_clock::universal_time() +
-                    boost::posix_time::milliseconds(timeout.count());
-
-    // Server receives on response queue, worker receives on request queue
-    auto *queue = is_server_ ? response_queue_.get() : request_queue_.get();
-    bool received = queue->timed_receive(&msg, sizeof(msg), received_size,
-                                         priority, abs_time);
-
-    if (!received) {
-      LOG_TRACE("IPC", "RECV_TIMEOUT", "Receive timeout on queue: {}",
-                response_queue_name_);
-      return std::nullopt;
-    }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  char frame[IPC_MAX_FRAME];
 
-    if (received_size != sizeof(IPCMessage)) {
-      LOG_ERROR("IPC", "RECV_SIZE", "Received message size mismatch: {} vs {}",
-                received_size, sizeof(IPCMessage));
-      return std::nullopt;
+  try {
+    while (true) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      size_t received_size = 0;
+      if (!receive_frame(frame, received_size,
+                         std::max(remaining, std::chrono::milliseconds(0)))) {
+        // A partially reassembled message is kept for the next call
+        LOG_TRACE("IPC", "RECV_TIMEOUT", "Receive timeout on queue: {}",
+                  response_queue_name_);
+        return std::nullopt;
+      }
+
+      IPCFrameHeader header;
+      if (received_size < sizeof(header)) {
+        LOG_ERROR("IPC", "RECV_SIZE", "Received truncated frame: {} bytes",
+                  received_size);
+        continue;
+      }
+      std::memcpy(&header, frame, sizeof(header));
+      if (sizeof(header) + header.body_size != received_size ||
+          header.total_size > IPC_MAX_MESSAGE_SIZE) {
+        LOG_ERROR("IPC", "RECV_SIZE", "Frame size mismatch: {} vs {}",
+                  received_size, sizeof(header) + header.body_size);
+        continue;
+      }
+
+      const char *body = frame + sizeof(header);
+
+      if (!(header.flags & IPC_FRAME_CONTINUATION)) {
+        if (partial_active_) {
+          LOG_WARN("IPC", "RECV_FRAME",
+                   "Dropping incomplete message id={} ({} of {} bytes)",
+                   partial_.id, partial_.payload.size(), partial_total_size_);
+        }
+        partial_.type = static_cast<IPCMessage::Type>(header.type);
+        partial_.id = header.id;
+        partial_.sync_token = header.sync_token;
+        partial_.payload.clear();
+        partial_.payload.reserve(header.total_size);
+        partial_total_size_ = header.total_size;
+        partial_active_ = true;
+      } else if (!partial_active_ || header.id != partial_.id) {
+        LOG_WARN("IPC", "RECV_FRAME",
+                 "Dropping continuation frame for unknown message id={}",
+                 header.id);
+        continue;
+      }
+
+      partial_.payload.append(body, header.body_size);
+
+      if (header.flags & IPC_FRAME_MORE)
+        continue;
+
+      partial_active_ = false;
+      if (partial_.payload.size() != partial_total_size_) {
+        LOG_ERROR("IPC", "RECV_SIZE",
+                  "Reassembled size mismatch for id={}: {} vs {}", partial_.id,
+                  partial_.payload.size(), partial_total_size_);
+        continue;
+      }
+      return std::move(partial_);
     }
-
-    return msg;
   } catch (const boost::interprocess::interprocess_exception &ex) {
     LOG_ERROR("IPC", "RECV_ERROR", "Receive failed:  {}", ex.what());
     return std::nullopt;
@@ -154,6 +349,7 @@ void SharedQueue::cleanup(const std::string &instrument_name) {
 
   message_queue::remove(req_name.c_str());
   message_queue::remove(resp_name.c_str());
+  shared_memory_object::remove(make_queue_name(instrument_name, "ring").c_str());
 
   LOG_INFO("IPC", "QUEUE_CLEANUP", "Cleaned up queues for:   {}",
            instrument_name);
@@ -0,0 +1,116 @@
+#include "instrument-server/ipc/SpscRing.hpp"
+
+#include "instrument-server/ipc/Futex.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace instserver {
+namespace ipc {
+
+namespace {
+
+// Number of failed try_* attempts before parking. A short spin catches the
+// common request/response case where the peer answers within microseconds.
+constexpr int SPIN_ITERATIONS = 200;
+
+/// Shared wait loop for push/pop: spin, then park on `seq` until `attempt`
+/// succeeds or the deadline passes.
+template <typename Attempt>
+bool wait_until(Attempt &&attempt, std::atomic<uint32_t> &seq,
+                std::atomic<uint32_t> &waiting,
+                std::chrono::milliseconds timeout) {
+  for (int i = 0; i < SPIN_ITERATIONS; ++i) {
+    if (attempt())
+      return true;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true) {
+    // Read the sequence before re-checking so a push/pop racing with us
+    // changes it and the futex wait returns immediately.
+    uint32_t observed = seq.load(std::memory_order_seq_cst);
+    waiting.store(1, std::memory_order_seq_cst);
+    if (attempt()) {
+      waiting.store(0, std::memory_order_relaxed);
+      return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      waiting.store(0, std::memory_order_relaxed);
+      return false;
+    }
+
+    futex_wait(seq, observed, deadline - now);
+    waiting.store(0, std::memory_order_relaxed);
+
+    if (attempt())
+      return true;
+  }
+}
+
+} // namespace
+
+SpscRing::SpscRing()
+    : head_(0), tail_(0), data_seq_(0), consumer_waiting_(0), space_seq_(0),
+      producer_waiting_(0) {}
+
+bool SpscRing::try_push(const void *data, size_t size) {
+  if (size > SPSC_SLOT_CAPACITY)
+    return false;
+
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t tail = tail_.load(std::memory_order_acquire);
+  if (head - tail >= SPSC_RING_SLOTS)
+    return false;
+
+  Slot &slot = slots_[head & (SPSC_RING_SLOTS - 1)];
+  slot.size = static_cast<uint32_t>(size);
+  std::memcpy(slot.data, data, size);
+  head_.store(head + 1, std::memory_order_release);
+
+  data_seq_.fetch_add(1, std::memory_order_seq_cst);
+  if (consumer_waiting_.load(std::memory_order_seq_cst))
+    futex_wake_all(data_seq_);
+  return true;
+}
+
+bool SpscRing::push(const void *data, size_t size,
+                    std::chrono::milliseconds timeout) {
+  if (size > SPSC_SLOT_CAPACITY)
+    return false;
+  return wait_until([&] { return try_push(data, size); }, space_seq_,
+                    producer_waiting_, timeout);
+}
+
+bool SpscRing::try_pop(void *out, size_t capacity, size_t &size) {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  uint32_t head = head_.load(std::memory_order_acquire);
+  if (tail == head)
+    return false;
+
+  const Slot &slot = slots_[tail & (SPSC_RING_SLOTS - 1)];
+  size = slot.size;
+  std::memcpy(out, slot.data, std::min<size_t>(size, capacity));
+  tail_.store(tail + 1, std::memory_order_release);
+
+  space_seq_.fetch_add(1, std::memory_order_seq_cst);
+  if (producer_waiting_.load(std::memory_order_seq_cst))
+    futex_wake_all(space_seq_);
+  return true;
+}
+
+bool SpscRing::pop(void *out, size_t capacity, size_t &size,
+                   std::chrono::milliseconds timeout) {
+  return wait_until([&] { return try_pop(out, capacity, size); }, data_seq_,
+                    consumer_waiting_, timeout);
+}
+
+uint32_t SpscRing::size() const {
+  return head_.load(std::memory_order_acquire) -
+         tail_.load(std::memory_order_acquire);
+}
+
+} // namespace ipc
+} // namespace instserver
@@ -3,12 +3,17 @@
 #include "instrument-server/SerializedCommand.hpp"
 #include "instrument-server/plugin/PluginLoader.hpp"
 #include "instrument-server/plugin/PluginRegistry.hpp"
+#include "instrument-server/server/ContextTypes.hpp"
 #include "instrument-server/server/InstrumentRegistry.hpp"
 #include "instrument-server/server/JobManager.hpp"
+#include "instrument-server/server/LuaStatePool.hpp"
 #include "instrument-server/server/RuntimeContext.hpp"
+#include "instrument-server/server/ScriptCache.hpp"
 #include "instrument-server/server/ServerDaemon.hpp"
 #include "instrument-server/server/SyncCoordinator.hpp"
+#include <algorithm>
 #include <sol/sol.hpp>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -198,7 +203,13 @@ int handle_status(const json &params, json &out) {
   out["stats"] = {{"commands_sent", stats.commands_sent},
                   {"commands_completed", stats.commands_completed},
                   {"commands_failed", stats.commands_failed},
-                  {"commands_timeout", stats.commands_timeout}};
+                  {"commands_timeout", stats.commands_timeout},
+                  {"in_flight", stats.in_flight},
+                  {"peak_in_flight", stats.peak_in_flight},
+                  {"window", stats.window},
+                  {"queue_depth", stats.queue_depth},
+                  {"credit_waits", stats.credit_waits},
+                  {"window_rejections", stats.window_rejections}};
   return 0;
 }
 
@@ -213,6 +224,81 @@ int handle_list(const json &params, json &out) {
   return 0;
 }
 
+int handle_sync_stats(const json &params, json &out) {
+  out = json::object();
+  std::string name = params.value("name", "");
+  bool reset = params.value("reset", false);
+
+  auto stats = SyncCoordinator::arrival_stats();
+  if (reset)
+    SyncCoordinator::reset_arrival_stats();
+
+  // Slowest first: the instrument every parallel block waits for
+  std::sort(stats.begin(), stats.end(), [](const auto &a, const auto &b) {
+    return a.quantile_us(0.99) > b.quantile_us(0.99);
+  });
+
+  out["ok"] = true;
+  out["instruments"] = json::array();
+  for (const auto &s : stats) {
+    if (!name.empty() && s.instrument != name)
+      continue;
+    json hist = json::array();
+    for (size_t i = 0; i < s.buckets.size(); ++i) {
+      if (s.buckets[i] == 0)
+        continue;
+      // The last bucket has no upper bound
+      json bucket = {{"count", s.buckets[i]}};
+      if (i + 1 < s.buckets.size())
+        bucket["lt_us"] = uint64_t{1} << i;
+      hist.push_back(bucket);
+    }
+    out["instruments"].push_back(
+        {{"name", s.instrument},
+         {"arrivals", s.arrivals},
+         {"timeouts", s.timeouts},
+         {"mean_us", s.arrivals ? s.total_us / s.arrivals : 0},
+         {"max_us", s.max_us},
+         {"p50_us", s.quantile_us(0.5)},
+         {"p90_us", s.quantile_us(0.9)},
+         {"p99_us", s.quantile_us(0.99)},
+         {"histogram", hist}});
+  }
+  return 0;
+}
+
+// Check the optional "context_type"/"context" payload of measure and
+// submit_measure. On failure fills `out` and returns false.
+static bool check_context_payload(const json &params, json &out) {
+  if (!params.contains("context_type") && !params.contains("context"))
+    return true;
+  if (!params.contains("context_type") || !params["context_type"].is_string()) {
+    out["ok"] = false;
+    out["error"] = "context requires a context_type (one of: " +
+                   [] {
+                     std::string names;
+                     for (const auto &key : ContextTypes::builtin().keys())
+                       names += (names.empty() ? "" : ", ") + key;
+                     return names;
+                   }() +
+                   ")";
+    return false;
+  }
+
+  auto errors = ContextTypes::builtin().validate(
+      params["context_type"].get<std::string>(),
+      params.value("context", json::object()));
+  if (errors.empty())
+    return true;
+
+  out["ok"] = false;
+  out["error"] = "invalid context";
+  out["errors"] = json::array();
+  for (const auto &e : errors)
+    out["errors"].push_back({{"path", e.path}, {"message", e.message}});
+  return false;
+}
+
 int handle_measure(const json &params, json &out) {
   out = json::object();
   std::string script_path = params.value("script_path", "");
@@ -224,6 +310,8 @@ int handle_measure(const json &params, json &out) {
     out["error"] = "missing script_path";
     return 1;
   }
+  if (!check_context_payload(params, out))
+    return 1;
 
   InstrumentLogger::instance().init("instrument_server.log",
                                     spdlog::level::from_str(log_level));
@@ -239,24 +327,19 @@ int handle_measure(const json &params, json &out) {
 
     LOG_INFO("SERVER", "MEASURE", "Script: {}", script_path);
 
-    // Setup Lua
-    sol::state lua;
-    lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::table,
-                       sol::lib::string, sol::lib::io, sol::lib::os);
-
-    SyncCoordinator sync_coordinator;
-    bind_runtime_context(lua, registry, sync_coordinator);
-
-    // Create default context
-    RuntimeContext ctx(registry, sync_coordinator);
-    lua["context"] = &ctx;
+    // Borrow a pre-warmed Lua state and bind a fresh context to it
+    auto lease = LuaStatePool::instance().acquire();
+    auto ctx = lease.bind_context(registry, registry.sync_coordinator());
 
     if (!json_output) {
       // If RPC caller requested non-json, we still return structured JSON
       LOG_INFO("SERVER", "MEASURE", "Running measurement (text mode)");
     }
 
-    auto result = lua.safe_script_file(script_path);
+    auto result = params.contains("context_type")
+                      ? lease.run_file(script_path,
+                                       params.value("context", json::object()))
+                      : lease.run_file(script_path);
 
     if (!result.valid()) {
       sol::error err = result;
@@ -266,9 +349,10 @@ int handle_measure(const json &params, json &out) {
     }
 
     // Get collected results
-    const auto &results = ctx.get_results();
+    const auto &results = ctx->get_results();
     out["ok"] = true;
     out["script"] = std::filesystem::path(script_path).filename().string();
+    out["script_cache"] = ScriptCache::instance().stats_json();
     out["results"] = json::array();
 
     for (size_t i = 0; i < results.size(); ++i) {
@@ -525,8 +609,20 @@ int handle_submit_job(const json &params, json &out) {
     out["error"] = "missing job_type";
     return 1;
   }
+  // Scheduling fields may be given beside job_type or inside params
+  for (const char *key : {"priority", "deadline_ms"}) {
+    if (params.contains(key))
+      job_params[key] = params[key];
+  }
   auto &mgr = JobManager::instance();
-  std::string jid = mgr.submit_job(job_type, job_params);
+  std::string jid;
+  try {
+    jid = mgr.submit_job(job_type, job_params);
+  } catch (const std::invalid_argument &e) {
+    out["ok"] = false;
+    out["error"] = e.what();
+    return 1;
+  }
   out["ok"] = true;
   out["job_id"] = jid;
   return 0;
@@ -540,10 +636,23 @@ int handle_submit_measure(const json &params, json &out) {
     out["error"] = "missing script_path";
     return 1;
   }
+  // Checked now, so a bad payload is reported here rather than as a failed
+  // job
+  if (!check_context_payload(params, out))
+    return 1;
   json p = params;
-  auto jid = JobManager::instance().submit_measure(script_path, p);
+  std::string jid;
+  try {
+    jid = JobManager::instance().submit_measure(script_path, p);
+  } catch (const std::invalid_argument &e) {
+    out["ok"] = false;
+    out["error"] = e.what();
+    return 1;
+  }
   out["ok"] = true;
   out["job_id"] = jid;
+  // Counters as of submission; the job compiles its script when it runs
+  out["script_cache"] = ScriptCache::instance().stats_json();
   return 0;
 }
 
@@ -564,6 +673,8 @@ int handle_job_status(const json &params, json &out) {
   out["ok"] = true;
   out["job_id"] = info.id;
   out["status"] = info.status;
+  out["instruments"] = info.instruments;
+  out["exclusive"] = info.exclusive;
   out["created_at"] = std::chrono::duration_cast<std::chrono::milliseconds>(
                           info.created_at.time_since_epoch())
                           .count();
@@ -628,9 +739,22 @@ int handle_job_list(const json &params, json &out) {
     ji["job_id"] = j.id;
     ji["type"] = j.type;
     ji["status"] = j.status;
+    ji["priority"] = priority_name(j.priority);
     ji["created_at"] = std::chrono::duration_cast<std::chrono::milliseconds>(
                            j.created_at.time_since_epoch())
                            .count();
+    if (j.deadline) {
+      ji["deadline_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              j.deadline->time_since_epoch())
+                              .count();
+    }
+    if (j.status == "queued") {
+      ji["queue_position"] = j.queue_position;
+      ji["estimated_start_ms"] =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              j.estimated_start.time_since_epoch())
+              .count();
+    }
     out["jobs"].push_back(ji);
   }
   return 0;
@@ -650,5 +774,26 @@ int handle_job_cancel(const json &params, json &out) {
     out["error"] = "failed to cancel job (maybe already finished)";
   return ok ? 0 : 1;
 }
+
+int handle_job_reprioritize(const json &params, json &out) {
+  out = json::object();
+  std::string jid = params.value("job_id", "");
+  if (jid.empty()) {
+    out["ok"] = false;
+    out["error"] = "missing job_id";
+    return 1;
+  }
+  auto priority = priority_from_name(params.value("priority", ""));
+  if (!priority) {
+    out["ok"] = false;
+    out["error"] = "priority must be one of interactive, normal, batch";
+    return 1;
+  }
+  bool ok = JobManager::instance().reprioritize_job(jid, *priority);
+  out["ok"] = ok;
+  if (!ok)
+    out["error"] = "job is not queued";
+  return ok ? 0 : 1;
+}
 } // namespace server
 } // namespace instserver
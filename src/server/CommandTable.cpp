@@ -0,0 +1,94 @@
+#include "instrument-server/server/CommandTable.hpp"
+#include "instrument-server/Logger.hpp"
+
+namespace instserver {
+
+// Type of an io entry or channel group io_type called `name`
+static std::optional<std::string> find_io_type(const nlohmann::json &api_def,
+                                               const std::string &name) {
+  if (api_def.contains("io") && api_def["io"].is_array()) {
+    for (const auto &io : api_def["io"]) {
+      if (io.contains("name") && io["name"].get<std::string>() == name) {
+        if (io.contains("type")) {
+          return io["type"].get<std::string>();
+        }
+      }
+    }
+  }
+
+  if (api_def.contains("channel_groups") &&
+      api_def["channel_groups"].is_array()) {
+    for (const auto &group : api_def["channel_groups"]) {
+      if (group.contains("io_types") && group["io_types"].is_array()) {
+        for (const auto &io_type : group["io_types"]) {
+          if (io_type.contains("suffix") &&
+              io_type["suffix"].get<std::string>() == name) {
+            if (io_type.contains("type")) {
+              return io_type["type"].get<std::string>();
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::shared_ptr<const CommandTable>
+CommandTable::build(const std::string &instrument_name,
+                    const nlohmann::json &api_def) {
+  auto table = std::make_shared<CommandTable>();
+
+  if (!api_def.contains("commands") || !api_def["commands"].is_object()) {
+    LOG_WARN("REGISTRY", "API_LOOKUP",
+             "No commands section in API definition for:  {}", instrument_name);
+    return table;
+  }
+
+  for (const auto &[verb, def] : api_def["commands"].items()) {
+    CommandSpec spec;
+    spec.verb = verb;
+    if (def.contains("template") && def["template"].is_string())
+      spec.template_str = def["template"].get<std::string>();
+    if (def.contains("channel_group") && def["channel_group"].is_string())
+      spec.channel_group = def["channel_group"].get<std::string>();
+
+    if (def.contains("parameters") && def["parameters"].is_array()) {
+      for (const auto &param : def["parameters"]) {
+        CommandParamSpec param_spec;
+        if (param.contains("name") && param["name"].is_string()) {
+          param_spec.name = param["name"].get<std::string>();
+        } else if (param.contains("io") && param["io"].is_string()) {
+          param_spec.name = param["io"].get<std::string>();
+        }
+        if (param.contains("type") && param["type"].is_string()) {
+          param_spec.type = param["type"].get<std::string>();
+        } else if (!param_spec.name.empty()) {
+          param_spec.type =
+              find_io_type(api_def, param_spec.name).value_or("");
+        }
+        spec.params.push_back(std::move(param_spec));
+      }
+    }
+
+    if (def.contains("outputs") && def["outputs"].is_array() &&
+        !def["outputs"].empty()) {
+      spec.expects_response = true;
+      spec.output = def["outputs"][0].get<std::string>();
+      spec.return_type = find_io_type(api_def, *spec.output);
+      if (!spec.return_type) {
+        LOG_WARN(
+            "REGISTRY", "API_LOOKUP",
+            "Output '{}' not found in io or channel_groups for instrument '{}'",
+            *spec.output, instrument_name);
+      }
+    }
+
+    table->commands_.emplace(verb, std::move(spec));
+  }
+
+  return table;
+}
+
+} // namespace instserver
@@ -0,0 +1,285 @@
+#include "instrument-server/server/ContextTypes.hpp"
+#include "instrument-server/Logger.hpp"
+
+#include <regex>
+#include <set>
+
+namespace instserver {
+
+// Kept in step with lua_types/runtime_context_*.lua
+static const char *BUILTIN_CONTEXT_TYPES = R"json({
+  "contexts": {
+    "dc_getset": {
+      "name": "RuntimeContext_DCGetSet",
+      "description": "Set DC voltages on some instruments and read others",
+      "fields": [
+        {"name": "getters", "type": "InstrumentTarget[]", "description": "Instruments to read from"},
+        {"name": "setters", "type": "InstrumentTarget[]", "description": "Instruments to write to"},
+        {"name": "setVoltages", "type": "table<string, number>", "description": "Voltage per serialized instrument target"},
+        {"name": "sampleRate", "type": "number", "description": "Sampling rate in Hz"},
+        {"name": "numPoints", "type": "integer", "description": "Number of data points to acquire"}
+      ]
+    },
+    "waveform_1d": {
+      "name": "RuntimeContext_1DWaveform",
+      "description": "Sweep buffered setters in steps and acquire a waveform per step",
+      "fields": [
+        {"name": "setters", "type": "InstrumentTarget[]", "description": "Instruments set once"},
+        {"name": "bufferedGetters", "type": "InstrumentTarget[]", "description": "Instruments acquired at each step"},
+        {"name": "bufferedSetters", "type": "InstrumentTarget[]", "description": "Instruments set at each step"},
+        {"name": "setVoltageDomains", "type": "table<string, Domain>", "description": "Sweep domain per serialized instrument target"},
+        {"name": "sampleRate", "type": "number", "description": "Sampling rate in Hz"},
+        {"name": "numPoints", "type": "integer", "description": "Points acquired per step"},
+        {"name": "numSteps", "type": "integer", "description": "Steps in the sweep"}
+      ]
+    },
+    "waveform_2d": {
+      "name": "RuntimeContext_2DWaveform",
+      "description": "Sweep two sets of buffered setters and acquire a waveform per step",
+      "fields": [
+        {"name": "setters", "type": "InstrumentTarget[]", "description": "Instruments set once"},
+        {"name": "bufferedGetters", "type": "InstrumentTarget[]", "description": "Instruments acquired at each step"},
+        {"name": "bufferedXSetters", "type": "InstrumentTarget[]", "description": "Instruments set at each x step"},
+        {"name": "bufferedYSetters", "type": "InstrumentTarget[]", "description": "Instruments set at each y step"},
+        {"name": "setXVoltageDomains", "type": "table<string, Domain>", "description": "X sweep domain per serialized instrument target"},
+        {"name": "setYVoltageDomains", "type": "table<string, Domain>", "description": "Y sweep domain per serialized instrument target"},
+        {"name": "sampleRate", "type": "number", "description": "Sampling rate in Hz"},
+        {"name": "numPoints", "type": "integer", "description": "Points acquired per step"},
+        {"name": "numXSteps", "type": "integer", "description": "Steps along x"},
+        {"name": "numYSteps", "type": "integer", "description": "Steps along y"}
+      ]
+    }
+  }
+})json";
+
+// Set on the context table by the server, so payloads cannot use them
+static const std::set<std::string> RESERVED_FIELDS = {"call", "bind",
+                                                      "parallel", "log"};
+
+static void add_error(std::vector<ContextTypeError> &errors,
+                      const std::string &path, const std::string &msg) {
+  errors.push_back({path, msg});
+}
+
+static std::string trim(const std::string &s) {
+  auto first = s.find_first_not_of(' ');
+  if (first == std::string::npos)
+    return "";
+  return s.substr(first, s.find_last_not_of(' ') - first + 1);
+}
+
+static bool ends_with(const std::string &s, const std::string &suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Element type of "T[]" or value type of "table<string, T>", or empty
+static std::string array_element(const std::string &type) {
+  return ends_with(type, "[]") ? trim(type.substr(0, type.size() - 2)) : "";
+}
+
+static std::string map_value(const std::string &type) {
+  static const std::string prefix = "table<string,";
+  if (type.compare(0, prefix.size(), prefix) != 0 || !ends_with(type, ">"))
+    return "";
+  return trim(type.substr(prefix.size(), type.size() - prefix.size() - 1));
+}
+
+static bool known_type(const std::string &raw) {
+  static const std::set<std::string> scalars = {
+      "number", "integer", "string", "boolean", "InstrumentTarget", "Domain"};
+  std::string type = trim(raw);
+  if (auto element = array_element(type); !element.empty())
+    return known_type(element);
+  if (auto value = map_value(type); !value.empty())
+    return known_type(value);
+  return scalars.count(type) > 0;
+}
+
+static void check_value(const std::string &raw, const nlohmann::json &value,
+                        const std::string &path, std::vector<ContextTypeError> &errors) {
+  std::string type = trim(raw);
+
+  if (auto element = array_element(type); !element.empty()) {
+    if (!value.is_array()) {
+      add_error(errors, path, "expected an array of " + element);
+      return;
+    }
+    for (size_t i = 0; i < value.size(); ++i)
+      check_value(element, value[i], path + "/" + std::to_string(i), errors);
+    return;
+  }
+
+  if (auto value_type = map_value(type); !value_type.empty()) {
+    if (!value.is_object()) {
+      add_error(errors, path, "expected an object of " + value_type);
+      return;
+    }
+    for (const auto &[key, item] : value.items())
+      check_value(value_type, item, path + "/" + key, errors);
+    return;
+  }
+
+  if (type == "number") {
+    if (!value.is_number())
+      add_error(errors, path, "expected a number");
+  } else if (type == "integer") {
+    if (!value.is_number_integer())
+      add_error(errors, path, "expected an integer");
+  } else if (type == "string") {
+    if (!value.is_string())
+      add_error(errors, path, "expected a string");
+  } else if (type == "boolean") {
+    if (!value.is_boolean())
+      add_error(errors, path, "expected a boolean");
+  } else if (type == "InstrumentTarget") {
+    if (!value.is_object() || !value.contains("id") ||
+        !value["id"].is_string()) {
+      add_error(errors, path, "expected {\"id\": string, \"channel\"?: integer}");
+      return;
+    }
+    for (const auto &[key, item] : value.items()) {
+      if (key == "channel") {
+        if (!item.is_number_integer())
+          add_error(errors, path + "/channel", "expected an integer");
+      } else if (key != "id") {
+        add_error(errors, path + "/" + key, "unknown InstrumentTarget field");
+      }
+    }
+  } else if (type == "Domain") {
+    if (!value.is_object() || !value.contains("min") ||
+        !value.contains("max") || !value["min"].is_number() ||
+        !value["max"].is_number()) {
+      add_error(errors, path, "expected {\"min\": number, \"max\": number}");
+    }
+  }
+}
+
+const ContextTypes &ContextTypes::builtin() {
+  static const ContextTypes types = [] {
+    std::vector<ContextTypeError> errors;
+    auto loaded =
+        from_json(nlohmann::json::parse(BUILTIN_CONTEXT_TYPES), errors);
+    for (const auto &e : errors) {
+      LOG_ERROR("CONTEXT_TYPES", "BUILTIN", "{}: {}", e.path, e.message);
+    }
+    return loaded;
+  }();
+  return types;
+}
+
+ContextTypes ContextTypes::from_json(const nlohmann::json &doc,
+                                     std::vector<ContextTypeError> &errors) {
+  static const std::regex key_pattern("^[a-z][a-z0-9_]*$");
+  static const std::regex field_pattern("^[a-z][a-zA-Z0-9]*$");
+
+  ContextTypes out;
+  if (!doc.is_object() || !doc.contains("contexts") ||
+      !doc["contexts"].is_object()) {
+    add_error(errors, "/contexts", "missing contexts object");
+    return out;
+  }
+
+  for (const auto &[key, def] : doc["contexts"].items()) {
+    const std::string path = "/contexts/" + key;
+    const size_t errors_before = errors.size();
+
+    if (!std::regex_match(key, key_pattern))
+      add_error(errors, path, "context key must match ^[a-z][a-z0-9_]*$");
+    if (!def.is_object() || !def.contains("name") ||
+        !def["name"].is_string() || !def.contains("description") ||
+        !def["description"].is_string() || !def.contains("fields") ||
+        !def["fields"].is_array()) {
+      add_error(errors, path,
+                "context needs string name and description and a fields "
+                "array");
+      continue;
+    }
+
+    ContextTypeDef type;
+    type.name = def["name"].get<std::string>();
+    type.description = def["description"].get<std::string>();
+
+    std::set<std::string> seen;
+    for (size_t i = 0; i < def["fields"].size(); ++i) {
+      const auto &f = def["fields"][i];
+      const std::string field_path = path + "/fields/" + std::to_string(i);
+      if (!f.is_object() || !f.contains("name") || !f["name"].is_string() ||
+          !f.contains("type") || !f["type"].is_string()) {
+        add_error(errors, field_path, "field needs string name and type");
+        continue;
+      }
+
+      ContextFieldDef field;
+      field.name = f["name"].get<std::string>();
+      field.type = f["type"].get<std::string>();
+      field.optional = f.value("optional", false);
+      if (f.contains("description") && f["description"].is_string())
+        field.description = f["description"].get<std::string>();
+
+      if (!std::regex_match(field.name, field_pattern))
+        add_error(errors, field_path,
+                  "field name must match ^[a-z][a-zA-Z0-9]*$");
+      if (RESERVED_FIELDS.count(field.name))
+        add_error(errors, field_path,
+                  "field '" + field.name + "' would hide a context method");
+      if (!seen.insert(field.name).second)
+        add_error(errors, field_path, "duplicate field '" + field.name + "'");
+      if (!known_type(field.type))
+        add_error(errors, field_path, "unsupported type '" + field.type + "'");
+      type.fields.push_back(std::move(field));
+    }
+
+    if (errors.size() == errors_before)
+      out.types_.emplace(key, std::move(type));
+  }
+  return out;
+}
+
+const ContextTypeDef *ContextTypes::find(const std::string &key) const {
+  auto it = types_.find(key);
+  return it == types_.end() ? nullptr : &it->second;
+}
+
+std::vector<std::string> ContextTypes::keys() const {
+  std::vector<std::string> out;
+  for (const auto &[key, type] : types_)
+    out.push_back(key);
+  return out;
+}
+
+std::vector<ContextTypeError>
+ContextTypes::validate(const std::string &key,
+                       const nlohmann::json &payload) const {
+  std::vector<ContextTypeError> errors;
+  const auto *type = find(key);
+  if (!type) {
+    add_error(errors, "", "unknown context type '" + key + "'");
+    return errors;
+  }
+  if (!payload.is_object()) {
+    add_error(errors, "", "context must be an object");
+    return errors;
+  }
+
+  std::set<std::string> known;
+  for (const auto &field : type->fields) {
+    known.insert(field.name);
+    const std::string path = "/" + field.name;
+    if (!payload.contains(field.name) || payload[field.name].is_null()) {
+      if (!field.optional)
+        add_error(errors, path, "missing required field");
+      continue;
+    }
+    check_value(field.type, payload[field.name], path, errors);
+  }
+
+  for (const auto &[name, value] : payload.items()) {
+    if (!known.count(name))
+      add_error(errors, "/" + name,
+                "not a field of " + type->name);
+  }
+  return errors;
+}
+
+} // namespace instserver
@@ -0,0 +1,118 @@
+#include "instrument-server/server/DataHandle.hpp"
+#include "instrument-server/Logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace instserver {
+
+using ipc::DataType;
+
+// Call fn with the data as a typed pointer
+template <typename Fn>
+static auto visit_typed(DataType type, const void *data, Fn &&fn) {
+  switch (type) {
+  case DataType::FLOAT32:
+    return fn(static_cast<const float *>(data));
+  case DataType::INT32:
+    return fn(static_cast<const int32_t *>(data));
+  case DataType::INT64:
+    return fn(static_cast<const int64_t *>(data));
+  case DataType::UINT32:
+    return fn(static_cast<const uint32_t *>(data));
+  case DataType::UINT64:
+    return fn(static_cast<const uint64_t *>(data));
+  case DataType::UINT8:
+    return fn(static_cast<const uint8_t *>(data));
+  case DataType::FLOAT64:
+  default:
+    return fn(static_cast<const double *>(data));
+  }
+}
+
+std::optional<DataHandle> DataHandle::from_buffer(const std::string &buffer_id) {
+  auto &manager = ipc::DataBufferManager::instance();
+  auto buffer = manager.get_buffer(buffer_id);
+  if (!buffer) {
+    LOG_WARN("DATA_HANDLE", "MAP", "Buffer not available: {}", buffer_id);
+    return std::nullopt;
+  }
+
+  DataHandle handle;
+  handle.buffer_id_ = buffer_id;
+  handle.data_ = buffer->data();
+  handle.type_ = buffer->data_type();
+  handle.count_ = buffer->element_count();
+  // Hand the manager's reference back once the last view is gone
+  handle.backing_ = std::shared_ptr<const void>(
+      buffer->data(), [buffer, buffer_id](const void *) mutable {
+        buffer.reset();
+        ipc::DataBufferManager::instance().release_buffer(buffer_id);
+      });
+  return handle;
+}
+
+DataHandle::DataHandle(std::vector<double> values) {
+  auto storage = std::make_shared<const std::vector<double>>(std::move(values));
+  data_ = storage->data();
+  count_ = storage->size();
+  type_ = DataType::FLOAT64;
+  backing_ = std::move(storage);
+}
+
+std::optional<double> DataHandle::at(size_t index) const {
+  if (index >= count_)
+    return std::nullopt;
+  return visit_typed(type_, data_, [index](const auto *values) {
+    return static_cast<double>(values[index]);
+  });
+}
+
+DataHandle DataHandle::slice(size_t first, size_t count) const {
+  DataHandle view = *this;
+  first = std::min(first, count_);
+  view.count_ = std::min(count, count_ - first);
+  view.data_ = static_cast<const uint8_t *>(data_) +
+               first * ipc::data_type_size(type_);
+  return view;
+}
+
+double DataHandle::sum() const {
+  return visit_typed(type_, data_, [this](const auto *values) {
+    double total = 0.0;
+    for (size_t i = 0; i < count_; ++i)
+      total += static_cast<double>(values[i]);
+    return total;
+  });
+}
+
+double DataHandle::mean() const {
+  if (count_ == 0)
+    return std::numeric_limits<double>::quiet_NaN();
+  return sum() / static_cast<double>(count_);
+}
+
+double DataHandle::min() const {
+  if (count_ == 0)
+    return std::numeric_limits<double>::quiet_NaN();
+  return visit_typed(type_, data_, [this](const auto *values) {
+    return static_cast<double>(*std::min_element(values, values + count_));
+  });
+}
+
+double DataHandle::max() const {
+  if (count_ == 0)
+    return std::numeric_limits<double>::quiet_NaN();
+  return visit_typed(type_, data_, [this](const auto *values) {
+    return static_cast<double>(*std::max_element(values, values + count_));
+  });
+}
+
+std::vector<double> DataHandle::to_vector() const {
+  return visit_typed(type_, data_, [this](const auto *values) {
+    return std::vector<double>(values, values + count_);
+  });
+}
+
+} // namespace instserver
@@ -380,6 +380,8 @@ void HttpRpcServer::run_loop(uint16_t port) {
         rc = server::handle_list(params, resp);
       } else if (command == "status") {
         rc = server::handle_status(params, resp);
+      } else if (command == "sync_stats") {
+        rc = server::handle_sync_stats(params, resp);
       } else if (command == "start") {
         rc = server::handle_start(params, resp);
       } else if (command == "stop") {
@@ -406,6 +408,8 @@ void HttpRpcServer::run_loop(uint16_t port) {
         rc = server::handle_job_list(params, resp);
       } else if (command == "job_cancel") {
         rc = server::handle_job_cancel(params, resp);
+      } else if (command == "job_reprioritize") {
+        rc = server::handle_job_reprioritize(params, resp);
       } else {
         resp["ok"] = false;
         resp["error"] = "unknown command";
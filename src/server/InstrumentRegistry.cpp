@@ -76,29 +76,14 @@ bool InstrumentRegistry::create_instrument(const std::string &config_path) {
   }
 }
 
-bool InstrumentRegistry::create_instrument_from_json(
-    const std::string &name, const std::string &config_json,
-    const std::string &api_def_json) {
-  std::lock_guard lock(mutex_);
-
-  if (instruments_.count(name)) {
-    LOG_WARN("REGISTRY", "CREATE", "Instrument already exists: {}", name);
-    return false;
-  }
-
-  // Parse JSON strings
-  nlohmann::json config = nlohmann::json::parse(config_json);
-  nlohmann::json api_def = nlohmann::json::parse(api_def_json);
-
-  // Store metadata for later lookup
-  InstrumentMetadata metadata;
-  metadata.name = name;
-  metadata.config = config;
-  metadata.api_def = api_def;
-  metadata_[name] = metadata;
-
+// Start the worker for a new instrument; nullptr if it could not be started
+static std::shared_ptr<InstrumentWorkerProxy>
+start_worker(const std::string &name, const nlohmann::json &config,
+             const nlohmann::json &api_def, const std::string &config_json,
+             const std::string &api_def_json,
+             SyncCoordinator &sync_coordinator) {
   // Get protocol type
-  std::string protocol_type = api_def["protocol"]["type"];
+  std::string protocol_type = api_def.at("protocol").at("type");
 
   // Look up in plugin registry
   auto &plugin_registry = plugin::PluginRegistry::instance();
@@ -107,35 +92,134 @@ bool InstrumentRegistry::create_instrument_from_json(
   if (plugin_path.empty()) {
     LOG_ERROR("REGISTRY", "CREATE", "No plugin found for protocol: {}",
               protocol_type);
-    metadata_.erase(name);
-    return false;
+    return nullptr;
   }
 
   LOG_INFO("REGISTRY", "CREATE",
            "Creating instrument '{}' with protocol '{}' using plugin:  {}",
            name, protocol_type, plugin_path);
 
+  // Optional IPC tuning
+  WorkerIpcOptions ipc_options;
+  if (config.contains("ipc")) {
+    const auto &ipc_config = config["ipc"];
+    if (ipc_config.contains("transport")) {
+      std::string transport_name = ipc_config["transport"];
+      auto parsed = ipc::parse_queue_transport(transport_name);
+      if (!parsed) {
+        LOG_ERROR("REGISTRY", "CREATE", "Unknown IPC transport '{}' for: {}",
+                  transport_name, name);
+        return nullptr;
+      }
+      ipc_options.transport = *parsed;
+    }
+    if (ipc_config.contains("codec")) {
+      std::string codec_name = ipc_config["codec"];
+      auto parsed = ipc::parse_payload_codec(codec_name);
+      if (!parsed) {
+        LOG_ERROR("REGISTRY", "CREATE", "Unknown IPC codec '{}' for: {}",
+                  codec_name, name);
+        return nullptr;
+      }
+      ipc_options.codec = *parsed;
+    }
+    if (ipc_config.contains("window")) {
+      const auto &window = ipc_config["window"];
+      if (!window.is_number_integer() || window.get<int64_t>() < 1) {
+        LOG_ERROR("REGISTRY", "CREATE", "Invalid IPC window '{}' for: {}",
+                  window.dump(), name);
+        return nullptr;
+      }
+      ipc_options.window = window.get<size_t>();
+    }
+  }
+
   // Create worker proxy with JSON strings
   auto proxy = std::make_shared<InstrumentWorkerProxy>(
-      name, plugin_path, config_json, api_def_json, sync_coordinator_);
+      name, plugin_path, config_json, api_def_json, sync_coordinator,
+      ipc_options);
 
   if (!proxy->start()) {
     LOG_ERROR("REGISTRY", "CREATE", "Failed to start worker for:  {}", name);
-    metadata_.erase(name);
+    return nullptr;
+  }
+
+  return proxy;
+}
+
+bool InstrumentRegistry::create_instrument_from_json(
+    const std::string &name, const std::string &config_json,
+    const std::string &api_def_json) {
+  // Parse JSON strings
+  nlohmann::json config = nlohmann::json::parse(config_json);
+  nlohmann::json api_def = nlohmann::json::parse(api_def_json);
+
+  // Reserve the name. The worker starts without the lock held, so scripts
+  // keep running against the other instruments meanwhile.
+  uint64_t generation;
+  {
+    std::lock_guard lock(mutex_);
+    if (std::atomic_load(&instruments_)->count(name) || starting_.count(name)) {
+      LOG_WARN("REGISTRY", "CREATE", "Instrument already exists: {}", name);
+      return false;
+    }
+    starting_.insert(name);
+    generation = generation_;
+  }
+
+  std::shared_ptr<InstrumentWorkerProxy> proxy;
+  std::shared_ptr<const CommandTable> commands;
+  try {
+    proxy = start_worker(name, config, api_def, config_json, api_def_json,
+                         sync_coordinator_);
+    if (proxy)
+      commands = CommandTable::build(name, api_def);
+  } catch (...) {
+    std::lock_guard lock(mutex_);
+    starting_.erase(name);
+    throw;
+  }
+
+  std::unique_lock lock(mutex_);
+  starting_.erase(name);
+  if (!proxy) {
     return false;
   }
+  if (generation != generation_) {
+    lock.unlock();
+    LOG_WARN("REGISTRY", "CREATE",
+             "Instruments were stopped while '{}' was starting", name);
+    proxy->stop();
+    return false;
+  }
+
+  // Store metadata for later lookup
+  InstrumentMetadata metadata;
+  metadata.name = name;
+  metadata.config = std::move(config);
+  metadata.api_def = std::move(api_def);
+  metadata_[name] = std::move(metadata);
 
-  instruments_[name] = proxy;
+  auto instruments =
+      std::make_shared<InstrumentMap>(*std::atomic_load(&instruments_));
+  (*instruments)[name] = proxy;
+  publish_instruments(std::move(instruments));
+  publish_command_table(name, std::move(commands));
 
   LOG_INFO("REGISTRY", "CREATE", "Instrument '{}' created successfully", name);
   return true;
 }
 
+void InstrumentRegistry::publish_instruments(
+    std::shared_ptr<const InstrumentMap> instruments) {
+  std::atomic_store(&instruments_, std::move(instruments));
+}
+
 std::shared_ptr<InstrumentWorkerProxy>
 InstrumentRegistry::get_instrument(const std::string &name) {
-  std::lock_guard lock(mutex_);
-  auto it = instruments_.find(name);
-  if (it == instruments_.end()) {
+  auto instruments = std::atomic_load(&instruments_);
+  auto it = instruments->find(name);
+  if (it == instruments->end()) {
     return nullptr;
   }
   return it->second;
@@ -151,137 +235,110 @@ InstrumentRegistry::get_instrument_metadata(const std::string &name) const {
   return it->second;
 }
 
-const nlohmann::json *
-find_command_def(const std::map<std::string, InstrumentMetadata> &metadata,
-                 const std::string &instrument_name, const std::string &verb) {
-  auto meta_it = metadata.find(instrument_name);
-  if (meta_it == metadata.end()) {
-    LOG_WARN("REGISTRY", "API_LOOKUP", "No metadata found for instrument: {}",
-             instrument_name);
+void InstrumentRegistry::publish_command_table(
+    const std::string &name, std::shared_ptr<const CommandTable> table) {
+  auto tables = std::make_shared<CommandTableMap>(*std::atomic_load(
+      &command_tables_));
+  if (table) {
+    (*tables)[name] = std::move(table);
+  } else {
+    tables->erase(name);
+  }
+  std::atomic_store(&command_tables_,
+                    std::shared_ptr<const CommandTableMap>(std::move(tables)));
+}
+
+std::shared_ptr<const CommandTable>
+InstrumentRegistry::command_table(const std::string &name) const {
+  auto tables = std::atomic_load(&command_tables_);
+  auto it = tables->find(name);
+  if (it == tables->end()) {
     return nullptr;
   }
-  const auto &api_def = meta_it->second.api_def;
-  if (!api_def.contains("commands") || !api_def["commands"].is_object()) {
-    LOG_WARN("REGISTRY", "API_LOOKUP",
-             "No commands section in API definition for:  {}", instrument_name);
+  return it->second;
+}
+
+const CommandSpec *
+InstrumentRegistry::find_command(const CommandTable *table,
+                                 const std::string &instrument_name,
+                                 const std::string &verb) const {
+  if (!table) {
+    LOG_WARN("REGISTRY", "API_LOOKUP", "No metadata found for instrument: {}",
+             instrument_name);
     return nullptr;
   }
-  const auto &commands = api_def["commands"];
-  if (!commands.contains(verb)) {
+  const CommandSpec *spec = table->find(verb);
+  if (!spec) {
     LOG_WARN("REGISTRY", "API_LOOKUP",
              "Command '{}' not found in API definition for instrument '{}'",
              verb, instrument_name);
-    return nullptr;
   }
-  return &commands[verb];
+  return spec;
 }
 
 bool InstrumentRegistry::command_expects_response(
     const std::string &instrument_name, const std::string &verb) const {
-  std::lock_guard lock(mutex_);
-
-  const nlohmann::json *cmd_def =
-      find_command_def(metadata_, instrument_name, verb);
-  if (!cmd_def) {
-    return false;
-  }
-
-  if (cmd_def->contains("outputs") && (*cmd_def)["outputs"].is_array()) {
-    const auto &outputs = (*cmd_def)["outputs"];
-    return !outputs.empty();
-  }
-  return false;
+  auto table = command_table(instrument_name);
+  const CommandSpec *spec = find_command(table.get(), instrument_name, verb);
+  return spec && spec->expects_response;
 }
 
 std::optional<std::string>
 InstrumentRegistry::get_response_type(const std::string &instrument_name,
                                       const std::string &verb) const {
-  std::lock_guard lock(mutex_);
-
-  auto meta_it = metadata_.find(instrument_name);
-  if (meta_it == metadata_.end()) {
-    return std::nullopt;
-  }
-  const auto &api_def = meta_it->second.api_def;
-
-  const nlohmann::json *cmd_def =
-      find_command_def(metadata_, instrument_name, verb);
-  if (!cmd_def) {
+  auto table = command_table(instrument_name);
+  const CommandSpec *spec = find_command(table.get(), instrument_name, verb);
+  if (!spec) {
     return std::nullopt;
   }
-
-  if (!cmd_def->contains("outputs") || !(*cmd_def)["outputs"].is_array()) {
-    return std::nullopt;
-  }
-  const auto &outputs = (*cmd_def)["outputs"];
-  if (outputs.empty()) {
-    return std::nullopt;
-  }
-  std::string output_name = outputs[0].get<std::string>();
-
-  // Search in io section
-  if (api_def.contains("io") && api_def["io"].is_array()) {
-    for (const auto &io : api_def["io"]) {
-      if (io.contains("name") && io["name"].get<std::string>() == output_name) {
-        if (io.contains("type")) {
-          return io["type"].get<std::string>();
-        }
-      }
-    }
-  }
-
-  // Search in channel_groups' io_types
-  if (api_def.contains("channel_groups") &&
-      api_def["channel_groups"].is_array()) {
-    for (const auto &group : api_def["channel_groups"]) {
-      if (group.contains("io_types") && group["io_types"].is_array()) {
-        for (const auto &io_type : group["io_types"]) {
-          if (io_type.contains("suffix") &&
-              io_type["suffix"].get<std::string>() == output_name) {
-            if (io_type.contains("type")) {
-              return io_type["type"].get<std::string>();
-            }
-          }
-        }
-      }
-    }
-  }
-
-  LOG_WARN("REGISTRY", "API_LOOKUP",
-           "Output '{}' not found in io or channel_groups for instrument '{}'",
-           output_name, instrument_name);
-  return std::nullopt;
+  return spec->return_type;
 }
 
 bool InstrumentRegistry::has_instrument(const std::string &name) const {
-  std::lock_guard lock(mutex_);
-  return instruments_.count(name) > 0;
+  return std::atomic_load(&instruments_)->count(name) > 0;
 }
 
 void InstrumentRegistry::remove_instrument(const std::string &name) {
-  std::lock_guard lock(mutex_);
-  auto it = instruments_.find(name);
-  if (it != instruments_.end()) {
-    it->second->stop();
-    instruments_.erase(it);
+  std::shared_ptr<InstrumentWorkerProxy> proxy;
+  {
+    std::lock_guard lock(mutex_);
+    auto current = std::atomic_load(&instruments_);
+    auto it = current->find(name);
+    if (it == current->end()) {
+      return;
+    }
+    proxy = it->second;
+    auto instruments = std::make_shared<InstrumentMap>(*current);
+    instruments->erase(name);
+    publish_instruments(std::move(instruments));
     metadata_.erase(name);
-    LOG_INFO("REGISTRY", "REMOVE", "Removed instrument: {}", name);
+    publish_command_table(name, nullptr);
   }
+
+  // Callers that looked the proxy up already get errors from here on
+  proxy->stop();
+  LOG_INFO("REGISTRY", "REMOVE", "Removed instrument: {}", name);
 }
 
 void InstrumentRegistry::stop_all() {
-  std::lock_guard lock(mutex_);
-  LOG_INFO("REGISTRY", "STOP_ALL", "Stopping {} instruments",
-           instruments_.size());
-
-  std::vector<std::shared_ptr<InstrumentWorkerProxy>> proxies;
-  for (auto &[name, proxy] : instruments_) {
-    if (proxy) {
-      proxies.push_back(proxy);
-    }
+  std::shared_ptr<const InstrumentMap> instruments;
+  {
+    std::lock_guard lock(mutex_);
+    instruments = std::atomic_load(&instruments_);
+    publish_instruments(std::make_shared<const InstrumentMap>());
+    metadata_.clear();
+    std::atomic_store(&command_tables_,
+                      std::make_shared<const CommandTableMap>());
+    // Instruments still starting are stopped when they finish
+    ++generation_;
   }
 
-  for (auto &proxy : proxies) {
+  LOG_INFO("REGISTRY", "STOP_ALL", "Stopping {} instruments",
+           instruments->size());
+
+  for (const auto &[name, proxy] : *instruments) {
+    if (!proxy)
+      continue;
     try {
       proxy->stop();
     } catch (const std::exception &e) {
@@ -289,17 +346,14 @@ void InstrumentRegistry::stop_all() {
                 e.what());
     }
   }
-
-  instruments_.clear();
-  metadata_.clear();
 }
 
 void InstrumentRegistry::start_all() {
-  std::lock_guard lock(mutex_);
+  auto instruments = std::atomic_load(&instruments_);
   LOG_INFO("REGISTRY", "START_ALL", "Starting {} instruments",
-           instruments_.size());
+           instruments->size());
 
-  for (auto &[name, proxy] : instruments_) {
+  for (const auto &[name, proxy] : *instruments) {
     if (proxy && !proxy->is_alive()) {
       try {
         proxy->start();
@@ -312,10 +366,10 @@ void InstrumentRegistry::start_all() {
 }
 
 std::vector<std::string> InstrumentRegistry::list_instruments() const {
-  std::lock_guard lock(mutex_);
+  auto instruments = std::atomic_load(&instruments_);
   std::vector<std::string> names;
-  names.reserve(instruments_.size());
-  for (const auto &[name, _] : instruments_) {
+  names.reserve(instruments->size());
+  for (const auto &[name, _] : *instruments) {
     names.push_back(name);
   }
   return names;
@@ -1,8 +1,17 @@
 #include "instrument-server/server/InstrumentWorkerProxy.hpp"
 #include "instrument-server/Logger.hpp"
+#include "instrument-server/ipc/DataBufferManager.hpp"
+#include "instrument-server/ipc/EventReactor.hpp"
 #include "instrument-server/ipc/ProcessManager.hpp"
+#include "instrument-server/ipc/SharedBarrier.hpp"
 #include "instrument-server/ipc/SharedQueue.hpp"
 
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 namespace instserver {
 
 // Global process manager instance
@@ -11,14 +20,21 @@ static ipc::ProcessManager &get_process_manager() {
   return manager;
 }
 
+// How long past its command timeout a response is still waited for before
+// it is failed and its credit reclaimed
+static constexpr std::chrono::seconds RESPONSE_GRACE{5};
+
 InstrumentWorkerProxy::InstrumentWorkerProxy(const std::string &instrument_name,
                                              const std::string &plugin_path,
                                              const std::string &config_json,
                                              const std::string &api_def_json,
-                                             SyncCoordinator &sync_coordinator)
+                                             SyncCoordinator &sync_coordinator,
+                                             const WorkerIpcOptions &ipc_options)
     : instrument_name_(instrument_name), plugin_path_(plugin_path),
       config_json_(config_json), api_def_json_(api_def_json),
-      sync_coordinator_(sync_coordinator) {}
+      sync_coordinator_(sync_coordinator),
+      sync_id_(SyncCoordinator::intern_instrument(instrument_name)),
+      ipc_options_(ipc_options) {}
 
 InstrumentWorkerProxy::~InstrumentWorkerProxy() { stop(); }
 
@@ -27,28 +43,64 @@ bool InstrumentWorkerProxy::start() {
 
   // Create IPC queues
   try {
-    ipc_queue_ = ipc::SharedQueue::create_server_queue(instrument_name_);
+    ipc_queue_ = ipc::SharedQueue::create_server_queue(instrument_name_,
+                                                       ipc_options_.transport);
   } catch (const std::exception &ex) {
     LOG_ERROR(instrument_name_, "PROXY", "Failed to create IPC queues: {}",
               ex.what());
     return false;
   }
 
+  // More credits than queue slots would just move the send timeout back
+  size_t capacity = ipc_queue_->send_capacity();
+  if (ipc_options_.window == 0 || ipc_options_.window > capacity) {
+    LOG_WARN(instrument_name_, "PROXY",
+             "IPC window {} outside 1..{}, clamping", ipc_options_.window,
+             capacity);
+    ipc_options_.window = std::clamp<size_t>(ipc_options_.window, 1, capacity);
+  }
+
+  // The worker rings this after every frame it sends
+  if (ipc::EventReactor::supported())
+    doorbell_fd_ = ipc::EventReactor::make_doorbell();
+
+  // Workers map the shared barrier segment when the server runs one
+  std::vector<std::string> worker_args;
+  if (auto *barriers = ipc::SharedBarrierTable::server())
+    worker_args.push_back("--sync-segment=" + barriers->name());
+
+  // A new worker starts with empty intern tables; so must we
+  {
+    std::lock_guard lock(encode_mutex_);
+    encoder_.reset();
+    decoder_.reset();
+  }
+
   // Spawn worker process
-  worker_pid_ =
-      get_process_manager().spawn_worker(instrument_name_, plugin_path_);
+  worker_pid_ = get_process_manager().spawn_worker(
+      instrument_name_, plugin_path_, "instrument-worker", doorbell_fd_,
+      worker_args);
 
   if (worker_pid_ == 0) {
     LOG_ERROR(instrument_name_, "PROXY", "Failed to spawn worker process");
+    stop_listening();
     return false;
   }
 
   LOG_INFO(instrument_name_, "PROXY", "Worker process spawned:  PID={}",
            worker_pid_);
 
-  // Start response listener thread
+  // Data buffers this worker creates are mapped here; tell the worker when
+  // the server no longer references one so it can free the segment
+  ipc::DataBufferManager::instance().set_release_handler(
+      instrument_name_,
+      [this](const std::string &buffer_id) { send_buffer_release(buffer_id); });
+
+  // Handle responses on the shared reactor, or fall back to polling
   running_ = true;
-  response_thread_ = std::thread([this]() { response_listener_loop(); });
+  if (!watch_with_reactor()) {
+    response_thread_ = std::thread([this]() { response_listener_loop(); });
+  }
 
   // Wait a bit for worker to initialize
   std::this_thread::sleep_for(std::chrono::milliseconds(500));
@@ -68,10 +120,12 @@ void InstrumentWorkerProxy::stop() {
     return;
   LOG_INFO(instrument_name_, "PROXY", "Stopping worker proxy");
 
+  ipc::DataBufferManager::instance().clear_release_handler(instrument_name_);
   send_shutdown_message();
   stop_worker_process();
-  join_response_thread_with_timeout();
+  stop_listening();
   cleanup_pending_promises();
+  reset_credits();
   cleanup_ipc();
 
   LOG_INFO(instrument_name_, "PROXY", "Worker proxy stopped");
@@ -83,7 +137,6 @@ void InstrumentWorkerProxy::send_shutdown_message() {
     shutdown_msg.type = ipc::IPCMessage::Type::SHUTDOWN;
     shutdown_msg.id = 0;
     shutdown_msg.sync_token = 0;
-    shutdown_msg.payload_size = 0;
     ipc_queue_->send(shutdown_msg, std::chrono::milliseconds(100));
   }
 }
@@ -98,6 +151,61 @@ void InstrumentWorkerProxy::stop_worker_process() {
   }
 }
 
+bool InstrumentWorkerProxy::watch_with_reactor() {
+  if (doorbell_fd_ < 0)
+    return false;
+
+  // Without an exit descriptor death is still caught by heartbeats
+  exit_fd_ = get_process_manager().open_exit_fd(worker_pid_);
+  reactor_watch_ = ipc::EventReactor::instance().add(
+      this, doorbell_fd_, exit_fd_,
+      {[this]() { drain_responses(); }, [this]() { on_worker_exit(); }});
+  if (!reactor_watch_) {
+    LOG_WARN(instrument_name_, "PROXY",
+             "Event reactor unavailable, using a listener thread");
+  }
+  return reactor_watch_;
+}
+
+void InstrumentWorkerProxy::drain_responses() {
+  // Bounded so one busy worker cannot starve the others; ringing our own
+  // doorbell brings the reactor back for the rest
+  constexpr int MAX_MESSAGES_PER_WAKEUP = 64;
+  for (int i = 0; i < MAX_MESSAGES_PER_WAKEUP; ++i) {
+    if (!running_.load(std::memory_order_acquire))
+      return;
+    auto msg_opt = ipc_queue_->receive(std::chrono::milliseconds(0));
+    if (!msg_opt)
+      return;
+    handle_ipc_message(*msg_opt);
+  }
+  ipc::EventReactor::ring_doorbell(doorbell_fd_);
+}
+
+void InstrumentWorkerProxy::on_worker_exit() {
+  // An exit during stop() is the one we asked for
+  if (running_.load(std::memory_order_acquire))
+    handle_worker_death();
+}
+
+void InstrumentWorkerProxy::stop_listening() {
+  if (reactor_watch_) {
+    ipc::EventReactor::instance().remove(this);
+    reactor_watch_ = false;
+  } else {
+    join_response_thread_with_timeout();
+  }
+
+#ifndef _WIN32
+  for (int *fd : {&doorbell_fd_, &exit_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+#endif
+}
+
 void InstrumentWorkerProxy::join_response_thread_with_timeout() {
   if (response_thread_.joinable()) {
     // Give thread 500ms to exit gracefully
@@ -131,17 +239,15 @@ void InstrumentWorkerProxy::join_response_thread_with_timeout() {
 
 void InstrumentWorkerProxy::cleanup_pending_promises() {
   std::lock_guard<std::mutex> lock(pending_mutex_);
-  for (auto &[msg_id, promise] : pending_responses_) {
-    CommandResponse error_resp;
-    error_resp.instrument_name = instrument_name_;
-    error_resp.success = false;
-    error_resp.error_message = "Worker stopped";
+  for (auto &[msg_id, pending] : pending_responses_) {
     try {
-      promise.set_value(std::move(error_resp));
+      pending.promise.set_value(error_response(msg_id, "Worker stopped"));
     } catch (...) {
     }
   }
   pending_responses_.clear();
+  pending_batches_.clear();
+  credit_holders_.clear();
 }
 
 void InstrumentWorkerProxy::cleanup_ipc() {
@@ -151,47 +257,136 @@ void InstrumentWorkerProxy::cleanup_ipc() {
 
 std::future<CommandResponse>
 InstrumentWorkerProxy::execute(SerializedCommand cmd) {
+  if (!acquire_credit(cmd.timeout))
+    return rejected_command(cmd, "IPC window full");
+  return send_command(std::move(cmd));
+}
+
+std::optional<std::future<CommandResponse>>
+InstrumentWorkerProxy::try_execute(SerializedCommand cmd) {
+  if (!acquire_credit(std::chrono::milliseconds(0)))
+    return std::nullopt;
+  return send_command(std::move(cmd));
+}
+
+std::future<CommandResponse>
+InstrumentWorkerProxy::rejected_command(const SerializedCommand &cmd,
+                                        const std::string &error) {
+  size_t in_flight;
+  {
+    std::lock_guard lock(window_mutex_);
+    in_flight = in_flight_;
+  }
+  LOG_WARN(instrument_name_, "PROXY", "Rejecting {}: {} ({} in flight)",
+           cmd.verb, error, in_flight);
+
+  CommandResponse error_resp;
+  error_resp.command_id = cmd.id;
+  error_resp.instrument_name = instrument_name_;
+  error_resp.success = false;
+  error_resp.error_message = error;
+
+  std::promise<CommandResponse> promise;
+  promise.set_value(std::move(error_resp));
+  return promise.get_future();
+}
+
+bool InstrumentWorkerProxy::acquire_credit(std::chrono::milliseconds wait) {
+  bool full;
+  {
+    std::lock_guard lock(window_mutex_);
+    full = in_flight_ >= ipc_options_.window;
+  }
+  // Credits held by responses that never arrived come back once overdue
+  if (full)
+    expire_overdue();
+
+  std::unique_lock lock(window_mutex_);
+  if (in_flight_ >= ipc_options_.window) {
+    bool waited = wait.count() > 0;
+    bool granted = waited && window_cv_.wait_for(lock, wait, [this]() {
+      return in_flight_ < ipc_options_.window;
+    });
+
+    std::lock_guard stats_lock(stats_mutex_);
+    if (waited)
+      stats_.credit_waits++;
+    if (!granted) {
+      stats_.window_rejections++;
+      return false;
+    }
+  }
+  in_flight_++;
+  peak_in_flight_ = std::max(peak_in_flight_, in_flight_);
+  return true;
+}
+
+void InstrumentWorkerProxy::release_credit() {
+  {
+    std::lock_guard lock(window_mutex_);
+    if (in_flight_ > 0)
+      in_flight_--;
+  }
+  window_cv_.notify_one();
+}
+
+void InstrumentWorkerProxy::reset_credits() {
+  {
+    std::lock_guard lock(window_mutex_);
+    in_flight_ = 0;
+  }
+  window_cv_.notify_all();
+}
+
+std::future<CommandResponse>
+InstrumentWorkerProxy::send_command(SerializedCommand cmd,
+                                    uint64_t *msg_id_out) {
   std::promise<CommandResponse> promise;
   auto future = promise.get_future();
 
   uint64_t msg_id = next_message_id_++;
   cmd.id = fmt::format("{}-{}", instrument_name_, msg_id);
+  if (msg_id_out)
+    *msg_id_out = msg_id;
 
   LOG_DEBUG(instrument_name_, cmd.id, "Enqueueing command:  {} (sync={})",
             cmd.verb, cmd.sync_token.value_or(0));
 
-  // Store promise for response
+  // Store promise for response; it holds the credit taken by the caller
   {
     std::lock_guard lock(pending_mutex_);
-    pending_responses_[msg_id] = std::move(promise);
+    pending_responses_[msg_id] = {
+        std::move(promise), msg_id,
+        std::chrono::steady_clock::now() + cmd.timeout + RESPONSE_GRACE};
+    credit_holders_[msg_id] = 1;
   }
 
   // Serialize and send command
-  std::string payload = ipc::serialize_command(cmd);
-
   ipc::IPCMessage msg;
   msg.type = ipc::IPCMessage::Type::COMMAND;
   msg.id = msg_id;
   msg.sync_token = cmd.sync_token.value_or(0);
-  msg.payload_size = std::min(payload.size(), sizeof(msg.payload));
-  std::memcpy(msg.payload, payload.data(), msg.payload_size);
 
-  if (!ipc_queue_->send(msg, cmd.timeout)) {
+  bool sent;
+  if (ipc_options_.codec == ipc::PayloadCodec::BINARY) {
+    std::lock_guard lock(encode_mutex_);
+    msg.payload = encoder_.encode_command(cmd);
+    sent = ipc_queue_->send(msg, cmd.timeout);
+    if (sent)
+      encoder_.commit();
+    else
+      encoder_.discard();
+  } else {
+    msg.payload = ipc::serialize_command(cmd);
+    sent = ipc_queue_->send(msg, cmd.timeout);
+  }
+
+  if (!sent) {
     LOG_ERROR(instrument_name_, cmd.id, "Failed to send command");
 
     // Fulfill promise with error
-    CommandResponse error_resp;
-    error_resp.command_id = cmd.id;
-    error_resp.instrument_name = instrument_name_;
-    error_resp.success = false;
-    error_resp.error_message = "IPC send timeout";
-
     std::lock_guard lock(pending_mutex_);
-    auto it = pending_responses_.find(msg_id);
-    if (it != pending_responses_.end()) {
-      it->second.set_value(error_resp);
-      pending_responses_.erase(it);
-    }
+    settle_pending(msg_id, error_response(msg_id, "IPC send timeout"));
   } else {
     std::lock_guard lock(stats_mutex_);
     stats_.commands_sent++;
@@ -200,20 +395,115 @@ InstrumentWorkerProxy::execute(SerializedCommand cmd) {
   return future;
 }
 
+std::vector<std::future<CommandResponse>>
+InstrumentWorkerProxy::execute_batch(std::vector<SerializedCommand> cmds) {
+  std::vector<std::future<CommandResponse>> futures;
+  if (cmds.size() == 1)
+    futures.push_back(execute(std::move(cmds.front())));
+  if (cmds.size() <= 1)
+    return futures;
+
+  const size_t count = cmds.size();
+  std::chrono::milliseconds timeout{0};
+  for (const auto &cmd : cmds)
+    timeout = std::max(timeout, cmd.timeout);
+
+  futures.reserve(count);
+  if (!acquire_credit(timeout)) {
+    for (const auto &cmd : cmds)
+      futures.push_back(rejected_command(cmd, "IPC window full"));
+    return futures;
+  }
+
+  // Consecutive IDs let the response batch be matched by position
+  uint64_t first_id = next_message_id_.fetch_add(count);
+  auto deadline = std::chrono::steady_clock::now() + timeout + RESPONSE_GRACE;
+  {
+    std::lock_guard lock(pending_mutex_);
+    for (size_t i = 0; i < count; ++i) {
+      cmds[i].id = fmt::format("{}-{}", instrument_name_, first_id + i);
+      std::promise<CommandResponse> promise;
+      futures.push_back(promise.get_future());
+      pending_responses_[first_id + i] = {std::move(promise), first_id,
+                                          deadline};
+    }
+    pending_batches_[first_id] = count;
+    credit_holders_[first_id] = count;
+  }
+
+  LOG_DEBUG(instrument_name_, cmds.front().id,
+            "Enqueueing batch of {} commands (sync={})", count,
+            cmds.front().sync_token.value_or(0));
+
+  ipc::IPCMessage msg;
+  msg.type = ipc::IPCMessage::Type::COMMAND_BATCH;
+  msg.id = first_id;
+  msg.sync_token = cmds.front().sync_token.value_or(0);
+
+  std::vector<std::string> items;
+  items.reserve(count);
+  bool sent;
+  if (ipc_options_.codec == ipc::PayloadCodec::BINARY) {
+    // Symbols interned by one item are referenced by later ones; the whole
+    // batch commits or discards together
+    std::lock_guard lock(encode_mutex_);
+    for (const auto &cmd : cmds)
+      items.push_back(encoder_.encode_command(cmd));
+    msg.payload = ipc::pack_batch(items);
+    sent = ipc_queue_->send(msg, timeout);
+    if (sent)
+      encoder_.commit();
+    else
+      encoder_.discard();
+  } else {
+    for (const auto &cmd : cmds)
+      items.push_back(ipc::serialize_command(cmd));
+    msg.payload = ipc::pack_batch(items);
+    sent = ipc_queue_->send(msg, timeout);
+  }
+
+  if (!sent) {
+    LOG_ERROR(instrument_name_, cmds.front().id,
+              "Failed to send batch of {} commands", count);
+
+    std::lock_guard lock(pending_mutex_);
+    for (size_t i = 0; i < count; ++i)
+      settle_pending(first_id + i,
+                     error_response(first_id + i, "IPC send timeout"));
+  } else {
+    std::lock_guard lock(stats_mutex_);
+    stats_.commands_sent += count;
+  }
+
+  return futures;
+}
+
 CommandResponse
 InstrumentWorkerProxy::execute_sync(SerializedCommand cmd,
                                     std::chrono::milliseconds timeout) {
-  auto future = execute(std::move(cmd));
+  std::string command_id = cmd.id;
+  if (!acquire_credit(cmd.timeout))
+    return rejected_command(cmd, "IPC window full").get();
+  uint64_t msg_id = 0;
+  auto future = send_command(std::move(cmd), &msg_id);
 
   if (future.wait_for(timeout) == std::future_status::ready) {
     return future.get();
   } else {
     CommandResponse timeout_resp;
-    timeout_resp.command_id = cmd.id;
+    timeout_resp.command_id = command_id;
     timeout_resp.instrument_name = instrument_name_;
     timeout_resp.success = false;
     timeout_resp.error_message = "Command timeout";
 
+    // Nobody reads the response now, so it stops holding a credit; if it
+    // landed in the meantime the future is already ready
+    {
+      std::lock_guard lock(pending_mutex_);
+      if (!settle_pending(msg_id, timeout_resp))
+        return future.get();
+    }
+
     std::lock_guard lock(stats_mutex_);
     stats_.commands_timeout++;
 
@@ -228,8 +518,20 @@ bool InstrumentWorkerProxy::is_alive() const {
 }
 
 InstrumentWorkerProxy::Stats InstrumentWorkerProxy::get_stats() const {
-  std::lock_guard lock(stats_mutex_);
-  return stats_;
+  Stats stats;
+  {
+    std::lock_guard lock(stats_mutex_);
+    stats = stats_;
+  }
+  {
+    std::lock_guard lock(window_mutex_);
+    stats.in_flight = in_flight_;
+    stats.peak_in_flight = peak_in_flight_;
+  }
+  stats.window = ipc_options_.window;
+  if (ipc_queue_)
+    stats.queue_depth = ipc_queue_->send_depth();
+  return stats;
 }
 
 void InstrumentWorkerProxy::response_listener_loop() {
@@ -256,6 +558,9 @@ void InstrumentWorkerProxy::handle_ipc_message(const ipc::IPCMessage &msg) {
   case ipc::IPCMessage::Type::RESPONSE:
     handle_response_message(msg);
     break;
+  case ipc::IPCMessage::Type::RESPONSE_BATCH:
+    handle_response_batch_message(msg);
+    break;
   case ipc::IPCMessage::Type::SYNC_ACK:
     handle_sync_ack_message(msg);
     break;
@@ -267,22 +572,105 @@ void InstrumentWorkerProxy::handle_ipc_message(const ipc::IPCMessage &msg) {
 
 void InstrumentWorkerProxy::handle_response_message(
     const ipc::IPCMessage &msg) {
-  std::string payload(msg.payload, msg.payload_size);
-  CommandResponse resp = ipc::deserialize_response(payload);
+  complete_response(msg.id, decode_response_payload(msg.payload, msg.id));
+}
+
+void InstrumentWorkerProxy::handle_response_batch_message(
+    const ipc::IPCMessage &msg) {
+  // Credits come back as the commands settle, so a batch answered after
+  // its commands were given up on returns nothing twice
+  size_t count = 0;
+  {
+    std::lock_guard lock(pending_mutex_);
+    auto it = pending_batches_.find(msg.id);
+    if (it != pending_batches_.end()) {
+      count = it->second;
+      pending_batches_.erase(it);
+    }
+  }
+
+  std::vector<std::string> items;
+  try {
+    items = ipc::unpack_batch(msg.payload);
+  } catch (const std::exception &ex) {
+    LOG_ERROR(instrument_name_, "PROXY",
+              "Failed to unpack response batch id={}: {}", msg.id, ex.what());
+    fail_responses(msg.id, count, "Malformed response batch");
+    return;
+  }
+
+  // An empty batch is the worker saying it could not read the commands
+  if (items.empty()) {
+    LOG_ERROR(instrument_name_, "PROXY",
+              "Worker could not read command batch id={}", msg.id);
+    fail_responses(msg.id, count, "Malformed command batch");
+    return;
+  }
+
+  // execute_batch() numbered the commands consecutively from msg.id
+  for (size_t i = 0; i < items.size(); ++i) {
+    complete_response(msg.id + i, decode_response_payload(items[i], msg.id + i));
+  }
+  if (items.size() < count) {
+    fail_responses(msg.id + items.size(), count - items.size(),
+                   "Missing from response batch");
+  }
+}
+
+void InstrumentWorkerProxy::fail_responses(uint64_t first_id, size_t count,
+                                           const std::string &error) {
+  for (size_t i = 0; i < count; ++i)
+    complete_response(first_id + i, error_response(first_id + i, error));
+}
+
+CommandResponse
+InstrumentWorkerProxy::error_response(uint64_t msg_id,
+                                      const std::string &error) const {
+  CommandResponse resp;
+  resp.command_id = fmt::format("{}-{}", instrument_name_, msg_id);
+  resp.instrument_name = instrument_name_;
+  resp.success = false;
+  resp.error_message = error;
+  return resp;
+}
+
+CommandResponse
+InstrumentWorkerProxy::decode_response_payload(const std::string &payload,
+                                               uint64_t msg_id) {
+  CommandResponse resp;
+  try {
+    resp = ipc::is_binary_payload(payload) ? decoder_.decode_response(payload)
+                                           : ipc::deserialize_response(payload);
+  } catch (const std::exception &ex) {
+    LOG_ERROR(instrument_name_, "PROXY", "Failed to decode response id={}: {}",
+              msg_id, ex.what());
+    resp.instrument_name = instrument_name_;
+    resp.success = false;
+    resp.error_message = std::string("Malformed response: ") + ex.what();
+  }
   LOG_DEBUG(instrument_name_, resp.command_id, "Received response: success={}",
             resp.success);
 
-  std::lock_guard<std::mutex> lock(pending_mutex_);
-  auto it = pending_responses_.find(msg.id);
-  if (it != pending_responses_.end()) {
-    try {
-      it->second.set_value(std::move(resp));
-    } catch (const std::future_error &) {
-    }
-    pending_responses_.erase(it);
+  // Map large data now so the server holds its own reference to the pages,
+  // released with the last copy of the response
+  if (resp.has_large_data && !resp.buffer_id.empty() &&
+      ipc::DataBufferManager::instance().adopt_buffer(resp.buffer_id)) {
+    resp.buffer_ref = std::shared_ptr<const std::string>(
+        new std::string(resp.buffer_id), [](const std::string *buffer_id) {
+          ipc::DataBufferManager::instance().release_buffer(*buffer_id);
+          delete buffer_id;
+        });
+  }
+  return resp;
+}
 
+void InstrumentWorkerProxy::complete_response(uint64_t msg_id,
+                                              CommandResponse resp) {
+  bool success = resp.success;
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  if (settle_pending(msg_id, std::move(resp))) {
     std::lock_guard<std::mutex> stats_lock(stats_mutex_);
-    if (resp.success) {
+    if (success) {
       stats_.commands_completed++;
     } else {
       stats_.commands_failed++;
@@ -290,6 +678,48 @@ void InstrumentWorkerProxy::handle_response_message(
   }
 }
 
+bool InstrumentWorkerProxy::settle_pending(uint64_t msg_id,
+                                           CommandResponse resp) {
+  auto it = pending_responses_.find(msg_id);
+  if (it == pending_responses_.end())
+    return false;
+  try {
+    it->second.promise.set_value(std::move(resp));
+  } catch (const std::future_error &) {
+  }
+  uint64_t credit_id = it->second.credit_id;
+  pending_responses_.erase(it);
+
+  auto holder = credit_holders_.find(credit_id);
+  if (holder != credit_holders_.end() && --holder->second == 0) {
+    credit_holders_.erase(holder);
+    pending_batches_.erase(credit_id);
+    release_credit();
+  }
+  return true;
+}
+
+size_t InstrumentWorkerProxy::expire_overdue() {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  std::vector<uint64_t> overdue;
+  for (const auto &[msg_id, pending] : pending_responses_) {
+    if (pending.deadline <= now)
+      overdue.push_back(msg_id);
+  }
+  if (overdue.empty())
+    return 0;
+
+  LOG_WARN(instrument_name_, "PROXY",
+           "{} responses overdue, reclaiming their credits", overdue.size());
+  for (uint64_t msg_id : overdue)
+    settle_pending(msg_id, error_response(msg_id, "Response timeout"));
+
+  std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+  stats_.commands_timeout += overdue.size();
+  return overdue.size();
+}
+
 void InstrumentWorkerProxy::handle_sync_ack_message(
     const ipc::IPCMessage &msg) {
   uint64_t sync_token = msg.sync_token;
@@ -299,7 +729,7 @@ void InstrumentWorkerProxy::handle_sync_ack_message(
 
   // Notify sync coordinator
   bool barrier_complete =
-      sync_coordinator_.handle_ack(sync_token, instrument_name_);
+      sync_coordinator_.handle_ack(sync_token, sync_id_);
 
   if (barrier_complete) {
     LOG_INFO(instrument_name_, "PROXY",
@@ -322,7 +752,6 @@ void InstrumentWorkerProxy::send_sync_continue(uint64_t sync_token) {
   msg.type = ipc::IPCMessage::Type::SYNC_CONTINUE;
   msg.id = 0;
   msg.sync_token = sync_token;
-  msg.payload_size = 0;
 
   bool sent = ipc_queue_->send(msg, std::chrono::milliseconds(1000));
 
@@ -335,19 +764,37 @@ void InstrumentWorkerProxy::send_sync_continue(uint64_t sync_token) {
   }
 }
 
+void InstrumentWorkerProxy::send_buffer_release(const std::string &buffer_id) {
+  if (!running_.load(std::memory_order_acquire) || !ipc_queue_ ||
+      !ipc_queue_->is_valid()) {
+    return;
+  }
+
+  ipc::IPCMessage msg;
+  msg.type = ipc::IPCMessage::Type::BUFFER_RELEASE;
+  msg.payload = buffer_id;
+
+  if (!ipc_queue_->send(msg, std::chrono::milliseconds(100))) {
+    LOG_WARN(instrument_name_, "PROXY", "Failed to send BUFFER_RELEASE for {}",
+             buffer_id);
+  }
+}
+
 void InstrumentWorkerProxy::handle_worker_death() {
   LOG_ERROR(instrument_name_, "PROXY", "Worker process died unexpectedly");
 
   // Fail all pending commands
   std::lock_guard lock(pending_mutex_);
-  for (auto &[msg_id, promise] : pending_responses_) {
-    CommandResponse error_resp;
-    error_resp.instrument_name = instrument_name_;
-    error_resp.success = false;
-    error_resp.error_message = "Worker process died";
-    promise.set_value(error_resp);
+  for (auto &[msg_id, pending] : pending_responses_) {
+    try {
+      pending.promise.set_value(error_response(msg_id, "Worker process died"));
+    } catch (...) {
+    }
   }
   pending_responses_.clear();
+  pending_batches_.clear();
+  credit_holders_.clear();
+  reset_credits();
 }
 
 } // namespace instserver
@@ -1,10 +1,16 @@
 #include "instrument-server/server/JobManager.hpp"
 #include "instrument-server/Logger.hpp"
+#include "instrument-server/server/LuaStatePool.hpp"
 #include "instrument-server/server/RuntimeContext.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <regex>
 #include <sol/sol.hpp>
 #include <sstream>
+#include <stdexcept>
 #include <thread>
 
 using json = nlohmann::json;
@@ -12,14 +18,90 @@ using json = nlohmann::json;
 namespace instserver {
 namespace server {
 
+// Relative share of starts per JobPriority, indexed by its value
+static constexpr uint64_t kWeights[] = {8, 4, 1};
+
+static size_t class_index(JobPriority priority) {
+  return static_cast<size_t>(priority);
+}
+
+const char *priority_name(JobPriority priority) {
+  switch (priority) {
+  case JobPriority::Interactive:
+    return "interactive";
+  case JobPriority::Batch:
+    return "batch";
+  default:
+    return "normal";
+  }
+}
+
+std::optional<JobPriority> priority_from_name(const std::string &name) {
+  if (name == "interactive")
+    return JobPriority::Interactive;
+  if (name == "normal")
+    return JobPriority::Normal;
+  if (name == "batch")
+    return JobPriority::Batch;
+  return std::nullopt;
+}
+
+static size_t executor_count_from_env() {
+  size_t count = 4;
+  if (const char *env = std::getenv("INSTRUMENT_SCRIPT_SERVER_JOB_WORKERS")) {
+    try {
+      count = static_cast<size_t>(std::stoull(env));
+    } catch (const std::exception &) {
+      LOG_WARN("JOB", "MGR", "Ignoring invalid executor count: {}", env);
+    }
+  }
+  return std::max<size_t>(count, 1);
+}
+
+// Instruments named by string literals passed to call() or bind() in the
+// script at `path`. Returns false unless every call()/bind() in the script
+// takes a literal, since otherwise the script may reach other instruments.
+static bool infer_script_instruments(const std::string &path,
+                                     std::set<std::string> &out) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  std::string source((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+
+  static const std::regex any_call(R"(\b(?:call|bind)\s*\()");
+  static const std::regex literal_call(
+      R"re(\b(?:call|bind)\s*\(\s*(?:"([^"\\]*)"|'([^'\\]*)'))re");
+
+  auto calls = std::distance(
+      std::sregex_iterator(source.begin(), source.end(), any_call),
+      std::sregex_iterator());
+  std::set<std::string> found;
+  decltype(calls) literals = 0;
+  for (std::sregex_iterator it(source.begin(), source.end(), literal_call), end;
+       it != end; ++it, ++literals) {
+    std::string name = (*it)[1].matched ? (*it)[1].str() : (*it)[2].str();
+    found.insert(name.substr(0, name.find_first_of(":.")));
+  }
+  if (literals != calls)
+    return false;
+  out = std::move(found);
+  return true;
+}
+
 JobManager &JobManager::instance() {
   static JobManager mgr;
   return mgr;
 }
 
-JobManager::JobManager()
-    : running_(true), worker_thread_(&JobManager::worker_loop, this) {
-  LOG_INFO("JOB", "MGR", "JobManager started");
+JobManager::JobManager() : running_(true) {
+  // Warm the Lua states now rather than on the first measure job. Built
+  // before this constructor returns, the pool is also destroyed after us.
+  LuaStatePool::instance();
+  size_t count = executor_count_from_env();
+  for (size_t i = 0; i < count; ++i)
+    workers_.emplace_back(&JobManager::worker_loop, this);
+  LOG_INFO("JOB", "MGR", "JobManager started with {} executors", count);
 }
 
 JobManager::~JobManager() { stop(); }
@@ -32,8 +114,10 @@ void JobManager::stop() {
     running_ = false;
   }
   cv_.notify_all();
-  if (worker_thread_.joinable())
-    worker_thread_.join();
+  for (auto &worker : workers_) {
+    if (worker.joinable())
+      worker.join();
+  }
   LOG_INFO("JOB", "MGR", "JobManager stopped");
 }
 
@@ -57,14 +141,49 @@ std::string JobManager::submit_job(const std::string &job_type,
   info.status = "queued";
   info.created_at = std::chrono::system_clock::now();
 
+  if (params.contains("priority")) {
+    const auto &name = params["priority"];
+    auto priority = name.is_string()
+                        ? priority_from_name(name.get<std::string>())
+                        : std::nullopt;
+    if (!priority)
+      throw std::invalid_argument("priority must be one of interactive, "
+                                  "normal, batch");
+    info.priority = *priority;
+  }
+  if (params.contains("deadline_ms")) {
+    if (!params["deadline_ms"].is_number())
+      throw std::invalid_argument("deadline_ms must be a number");
+    info.deadline = std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(params["deadline_ms"].get<int64_t>()));
+  }
+
+  if (params.contains("instruments") && params["instruments"].is_array()) {
+    for (const auto &name : params["instruments"]) {
+      if (name.is_string())
+        info.instruments.insert(name.get<std::string>());
+    }
+    info.exclusive = false;
+  } else if (job_type == "measure") {
+    info.exclusive = !infer_script_instruments(
+        params.value("script_path", ""), info.instruments);
+  }
+
   {
     std::lock_guard<std::mutex> lk(mutex_);
     jobs_.emplace(info.id, info);
-    queue_.push_back(info.id);
+    enqueue(info);
   }
   cv_.notify_one();
 
-  LOG_INFO("JOB", "SUBMIT", "Submitted job {} type={}", info.id, job_type);
+  LOG_INFO("JOB", "SUBMIT",
+           "Submitted job {} type={} priority={} instruments={}", info.id, job_type, priority_name(info.priority),
+           info.exclusive ? std::string("all") : [&info] {
+             std::string names;
+             for (const auto &name : info.instruments)
+               names += (names.empty() ? "" : ",") + name;
+             return names;
+           }());
   return info.id;
 }
 
@@ -101,6 +220,7 @@ std::vector<JobInfo> JobManager::list_jobs() {
   v.reserve(jobs_.size());
   for (auto &kv : jobs_)
     v.push_back(kv.second);
+  estimate_queue(v);
   return v;
 }
 
@@ -111,9 +231,7 @@ bool JobManager::cancel_job(const std::string &job_id) {
     return false;
   // If queued, remove from queue and mark canceled
   if (it->second.status == "queued") {
-    auto qit = std::find(queue_.begin(), queue_.end(), job_id);
-    if (qit != queue_.end())
-      queue_.erase(qit);
+    dequeue(it->second);
     it->second.status = "canceled";
     it->second.finished_at = std::chrono::system_clock::now();
     it->second.error = "canceled";
@@ -129,40 +247,198 @@ bool JobManager::cancel_job(const std::string &job_id) {
   return false;
 }
 
+bool JobManager::reprioritize_job(const std::string &job_id,
+                                  JobPriority priority) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto it = jobs_.find(job_id);
+  if (it == jobs_.end() || it->second.status != "queued")
+    return false;
+  auto &job = it->second;
+  if (job.priority != priority) {
+    auto &from = queues_[class_index(job.priority)];
+    auto &to = queues_[class_index(priority)];
+    if (to.jobs.empty())
+      to.pass = std::max(to.pass, virtual_time_);
+    // Relinks the node, so the iterator in queued_ stays valid
+    to.jobs.splice(to.jobs.end(), from.jobs, queued_.at(job_id));
+    job.priority = priority;
+    // The job may now be first in line for free instruments
+    cv_.notify_all();
+  }
+  LOG_INFO("JOB", "PRIO", "Job {} moved to {} queue", job_id,
+           priority_name(priority));
+  return true;
+}
+
+void JobManager::enqueue(const JobInfo &job) {
+  auto &queue = queues_[class_index(job.priority)];
+  if (queue.jobs.empty())
+    queue.pass = std::max(queue.pass, virtual_time_);
+  queue.jobs.push_back(job.id);
+  queued_[job.id] = std::prev(queue.jobs.end());
+}
+
+void JobManager::dequeue(const JobInfo &job) {
+  auto it = queued_.find(job.id);
+  if (it == queued_.end())
+    return;
+  queues_[class_index(job.priority)].jobs.erase(it->second);
+  queued_.erase(it);
+}
+
+void JobManager::estimate_queue(std::vector<JobInfo> &jobs) const {
+  auto run_ms = [this](const std::string &type) {
+    auto it = avg_run_ms_.find(type);
+    // Types that have not run yet count as instant
+    return it == avg_run_ms_.end() ? 0.0 : it->second;
+  };
+  auto now = std::chrono::system_clock::now();
+
+  // Time in ms until each executor is free, starting with running jobs
+  std::vector<double> free_in(workers_.size(), 0.0);
+  for (const auto &kv : jobs_) {
+    const auto &job = kv.second;
+    if (job.status != "running" && job.status != "canceling")
+      continue;
+    double elapsed = std::chrono::duration<double, std::milli>(
+                         now - job.started_at)
+                         .count();
+    *std::min_element(free_in.begin(), free_in.end()) +=
+        std::max(0.0, run_ms(job.type) - elapsed);
+  }
+
+  // Replay the dispatch order claim_next_job() would follow
+  std::array<uint64_t, kPriorityCount> pass;
+  std::array<std::list<std::string>::const_iterator, kPriorityCount> next;
+  for (size_t c = 0; c < kPriorityCount; ++c) {
+    pass[c] = queues_[c].pass;
+    next[c] = queues_[c].jobs.begin();
+  }
+  std::unordered_map<std::string, std::pair<size_t, double>> placement;
+  for (size_t position = 1;; ++position) {
+    size_t best = kPriorityCount;
+    for (size_t c = 0; c < kPriorityCount; ++c) {
+      if (next[c] != queues_[c].jobs.end() &&
+          (best == kPriorityCount || pass[c] < pass[best]))
+        best = c;
+    }
+    if (best == kPriorityCount)
+      break;
+    const auto &job = jobs_.at(*next[best]);
+    auto slot = std::min_element(free_in.begin(), free_in.end());
+    placement[job.id] = {position, *slot};
+    *slot += run_ms(job.type);
+    ++next[best];
+    pass[best] += kStride / kWeights[best];
+  }
+
+  for (auto &job : jobs) {
+    auto it = placement.find(job.id);
+    if (it == placement.end())
+      continue;
+    job.queue_position = it->second.first;
+    job.estimated_start =
+        now + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                  std::chrono::duration<double, std::milli>(it->second.second));
+  }
+}
+
+std::string JobManager::claim_next_job() {
+  auto now = std::chrono::system_clock::now();
+  // Classes by pass, lowest first; ties go to the higher priority
+  std::array<size_t, kPriorityCount> order{0, 1, 2};
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return queues_[a].pass < queues_[b].pass;
+  });
+
+  // Instruments wanted by jobs passed over so far; later jobs must not
+  // overtake them on those instruments
+  std::set<std::string> wanted;
+  bool passed_over = false;
+  for (size_t cls : order) {
+    auto &queue = queues_[cls];
+    for (auto qit = queue.jobs.begin(); qit != queue.jobs.end();) {
+      auto &job = jobs_.at(*qit);
+      if (job.deadline && now > *job.deadline) {
+        job.status = "failed";
+        job.error = "deadline passed before the job could start";
+        job.finished_at = now;
+        LOG_WARN("JOB", "SCHED", "Job {} missed its start deadline", job.id);
+        queued_.erase(job.id);
+        qit = queue.jobs.erase(qit);
+        continue;
+      }
+
+      bool free;
+      if (job.exclusive) {
+        // Nothing may run alongside it, nor be waiting ahead of it
+        free = holding_jobs_ == 0 && !passed_over;
+      } else {
+        free = !exclusive_held_ &&
+               std::none_of(job.instruments.begin(), job.instruments.end(),
+                            [this, &wanted](const std::string &name) {
+                              return held_instruments_.count(name) ||
+                                     wanted.count(name);
+                            });
+      }
+
+      if (!free) {
+        if (job.exclusive)
+          return {};
+        wanted.insert(job.instruments.begin(), job.instruments.end());
+        passed_over = true;
+        ++qit;
+        continue;
+      }
+
+      // All of the job's instruments are taken at once, under the manager's
+      // lock, so executors never hold some while waiting for others
+      held_instruments_.insert(job.instruments.begin(), job.instruments.end());
+      exclusive_held_ = job.exclusive;
+      ++holding_jobs_;
+      job.status = "running";
+      job.started_at = now;
+      virtual_time_ = queue.pass;
+      queue.pass += kStride / kWeights[cls];
+      std::string jid = job.id;
+      queued_.erase(jid);
+      queue.jobs.erase(qit);
+      return jid;
+    }
+  }
+  return {};
+}
+
+void JobManager::release_instruments(const JobInfo &job) {
+  for (const auto &name : job.instruments)
+    held_instruments_.erase(name);
+  if (job.exclusive)
+    exclusive_held_ = false;
+  --holding_jobs_;
+
+  double ms = std::chrono::duration<double, std::milli>(job.finished_at -
+                                                        job.started_at)
+                  .count();
+  auto avg = avg_run_ms_.emplace(job.type, ms);
+  if (!avg.second)
+    avg.first->second += 0.2 * (ms - avg.first->second);
+  cv_.notify_all();
+}
+
 void JobManager::worker_loop() {
   while (true) {
     std::string jid;
     {
       std::unique_lock<std::mutex> lk(mutex_);
-      cv_.wait(lk, [this]() { return !queue_.empty() || !running_; });
-      if (!running_ && queue_.empty())
+      // When stopping, queued jobs that can still start are run first
+      cv_.wait(lk, [this, &jid]() {
+        jid = claim_next_job();
+        return !jid.empty() || !running_;
+      });
+      if (jid.empty())
         break;
-      if (!queue_.empty()) {
-        // Before popping a non-measure job, wait for active measure jobs to
-        // finish. Peek at the front to see its type.
-        jid = queue_.front();
-        auto &jpeek = jobs_.at(jid);
-        if (jpeek.type != "measure") {
-          // Wait until there are no active measure jobs before proceeding.
-          while (!active_measure_jobs_.empty() && running_) {
-            LOG_DEBUG("JOB", "LOOP",
-                      "Waiting for active measure jobs to finish before "
-                      "running non-measure job");
-            measure_cv_.wait(lk);
-          }
-        }
-
-        // Pop and set running
-        queue_.pop_front();
-        auto &j = jobs_.at(jid);
-        j.status = "running";
-        j.started_at = std::chrono::system_clock::now();
-      }
     }
 
-    if (jid.empty())
-      continue;
-
     LOG_INFO("JOB", "RUN", "Starting job {}", jid);
 
     // Execute based on job type
@@ -215,37 +491,50 @@ void JobManager::worker_loop() {
           throw std::runtime_error("missing script_path");
         }
 
-        // Prepare Lua state and runtime context (enqueue mode)
-        sol::state lua;
-        lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::table,
-                           sol::lib::string, sol::lib::io, sol::lib::os);
-
-        SyncCoordinator sync_coordinator;
-        auto ctx = bind_runtime_context(lua, InstrumentRegistry::instance(),
-                                        sync_coordinator, true);
-
-        // Run script to parse and enqueue commands (this may block on parallel
-        // blocks)
-        auto load_result = lua.safe_script_file(script_path);
-        if (!load_result.valid()) {
-          sol::error err = load_result;
-          throw std::runtime_error(std::string("Script error: ") + err.what());
-        }
-
-        // Mark this measure job active
+        // Borrow a pooled Lua state and bind a runtime context (enqueue mode).
+        // The state goes back to the pool once the script has run; the
+        // monitor thread only needs the context.
+        auto &registry = InstrumentRegistry::instance();
+        std::shared_ptr<RuntimeContext> ctx;
         {
-          std::lock_guard<std::mutex> lk(mutex_);
-          active_measure_jobs_.insert(jid);
+          auto lease = LuaStatePool::instance().acquire();
+          // The registry's coordinator outlives this job's monitor thread
+          ctx = lease.bind_context(registry, registry.sync_coordinator(), true);
+          // Running beside other jobs: keep to the instruments claimed
+          if (!run_info.exclusive)
+            ctx->restrict_instruments(run_info.instruments);
+
+          // Run script to parse and enqueue commands (this may block on
+          // parallel blocks)
+          // A context payload (checked by the RPC handler) is passed to the
+          // function the script returns
+          auto load_result =
+              run_info.params.contains("context_type")
+                  ? lease.run_file(script_path,
+                                   run_info.params.value("context",
+                                                         json::object()))
+                  : lease.run_file(script_path);
+          if (!load_result.valid()) {
+            sol::error err = load_result;
+            throw std::runtime_error(std::string("Script error: ") +
+                                     err.what());
+          }
         }
 
-        // Spawn monitor thread to wait for enqueued commands to complete.
+        // Spawn monitor thread to wait for enqueued commands to complete. The
+        // job keeps its instruments until then.
         std::thread monitor([jid, ctx]() mutable {
           LOG_INFO("JOB", "MON", "Monitoring job {}", jid);
           // Release tokens in order and wait for command completion
           ctx->process_tokens_and_wait();
 
-          // Collect results JSON
+          // Collect results JSON; the job keeps the buffers it names
           json r = ctx->collect_results_json();
+          std::vector<std::shared_ptr<const void>> buffers;
+          for (const auto &cr : ctx->get_results()) {
+            if (cr.buffer_ref)
+              buffers.push_back(cr.buffer_ref);
+          }
 
           // Update job record and mark inactive
           auto &mgr = JobManager::instance();
@@ -254,15 +543,13 @@ void JobManager::worker_loop() {
             auto it = mgr.jobs_.find(jid);
             if (it != mgr.jobs_.end()) {
               it->second.result = r;
+              it->second.buffers = std::move(buffers);
               it->second.status = "completed";
               it->second.finished_at = std::chrono::system_clock::now();
               LOG_INFO("JOB", "MON", "Job {} completed (monitor)", jid);
+              mgr.release_instruments(it->second);
             }
-            // Remove from active measure jobs and notify waiting non-measure
-            // jobs
-            mgr.active_measure_jobs_.erase(jid);
           }
-          mgr.measure_cv_.notify_all();
         });
 
         monitor.detach();
@@ -296,6 +583,7 @@ void JobManager::worker_loop() {
             it->second.error = err;
           }
           it->second.finished_at = std::chrono::system_clock::now();
+          release_instruments(it->second);
         } else {
           // measure: monitor thread will mark completion; leave as
           // running/enqueued
@@ -303,9 +591,8 @@ void JobManager::worker_loop() {
             it->second.status = "failed";
             it->second.error = err;
             it->second.finished_at = std::chrono::system_clock::now();
-            // remove from active set if failed at enqueue time
-            active_measure_jobs_.erase(jid);
-            measure_cv_.notify_all();
+            // Failed at enqueue time, so no monitor will release them
+            release_instruments(it->second);
           } else {
             // it->second.status remains "running" while monitor works
           }
@@ -0,0 +1,181 @@
+#include "instrument-server/server/LuaStatePool.hpp"
+#include "instrument-server/Logger.hpp"
+#include "instrument-server/server/ScriptCache.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+namespace instserver {
+
+static size_t pool_size_from_env() {
+  size_t size = 4;
+  if (const char *env = std::getenv("INSTRUMENT_SCRIPT_SERVER_LUA_POOL_SIZE")) {
+    try {
+      size = static_cast<size_t>(std::stoull(env));
+    } catch (const std::exception &) {
+      LOG_WARN("LUA_POOL", "CONFIG", "Ignoring invalid pool size: {}", env);
+    }
+  }
+  return size;
+}
+
+LuaStatePool &LuaStatePool::instance() {
+  static LuaStatePool pool(pool_size_from_env());
+  return pool;
+}
+
+LuaStatePool::LuaStatePool(size_t capacity) : capacity_(capacity) {
+  idle_.reserve(capacity_);
+  for (size_t i = 0; i < capacity_; ++i)
+    idle_.push_back(make_state());
+  LOG_INFO("LUA_POOL", "INIT", "Pre-warmed {} Lua states", capacity_);
+}
+
+std::unique_ptr<sol::state> LuaStatePool::make_state() {
+  auto lua = std::make_unique<sol::state>();
+  lua->open_libraries(sol::lib::base, sol::lib::math, sol::lib::table,
+                      sol::lib::string, sol::lib::io, sol::lib::os);
+  register_runtime_types(*lua);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++created_;
+  return lua;
+}
+
+LuaStatePool::Lease LuaStatePool::acquire() {
+  std::unique_ptr<sol::state> lua;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      lua = std::move(idle_.back());
+      idle_.pop_back();
+    }
+  }
+  if (!lua) {
+    LOG_DEBUG("LUA_POOL", "ACQUIRE", "No idle Lua state, building one");
+    lua = make_state();
+  }
+  return Lease(*this, std::move(lua));
+}
+
+void LuaStatePool::release(std::unique_ptr<sol::state> lua) {
+  // Collect the finished script's environment and whatever only it
+  // referenced (its context among them) before the next script runs
+  lua->collect_garbage();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (idle_.size() < capacity_)
+    idle_.push_back(std::move(lua));
+}
+
+size_t LuaStatePool::idle() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_.size();
+}
+
+size_t LuaStatePool::created() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return created_;
+}
+
+LuaStatePool::Lease::Lease(LuaStatePool &pool, std::unique_ptr<sol::state> lua)
+    : pool_(&pool), lua_(std::move(lua)),
+      env_(*lua_, sol::create, lua_->globals()) {
+  // Keep _G pointing at the script's globals, so writes through it do not
+  // leak into the shared table either
+  env_["_G"] = env_;
+}
+
+LuaStatePool::Lease::~Lease() {
+  if (!lua_)
+    return;
+  env_ = sol::environment();
+  context_.reset();
+  pool_->release(std::move(lua_));
+}
+
+std::shared_ptr<RuntimeContext>
+LuaStatePool::Lease::bind_context(InstrumentRegistry &registry,
+                                  SyncCoordinator &sync_coordinator,
+                                  bool enqueue_mode) {
+  auto ctx = std::make_shared<RuntimeContext>(registry, sync_coordinator,
+                                              enqueue_mode);
+  env_["context"] = ctx;
+  context_ = ctx;
+  return ctx;
+}
+
+sol::protected_function_result
+LuaStatePool::Lease::run_file(const std::string &path) {
+  sol::load_result chunk = ScriptCache::instance().load(*lua_, path);
+  if (!chunk.valid()) {
+    sol::error err = chunk;
+    throw err;
+  }
+  sol::protected_function script = chunk;
+  env_.set_on(script);
+  return script();
+}
+
+// JSON objects become tables with the same keys, arrays 1-based sequences
+static sol::object to_lua(sol::state &lua, const nlohmann::json &value) {
+  switch (value.type()) {
+  case nlohmann::json::value_t::object: {
+    sol::table table = lua.create_table(0, static_cast<int>(value.size()));
+    for (const auto &[key, item] : value.items())
+      table[key] = to_lua(lua, item);
+    return table;
+  }
+  case nlohmann::json::value_t::array: {
+    sol::table table = lua.create_table(static_cast<int>(value.size()), 0);
+    for (size_t i = 0; i < value.size(); ++i)
+      table[i + 1] = to_lua(lua, value[i]);
+    return table;
+  }
+  case nlohmann::json::value_t::string:
+    return sol::make_object(lua, value.get<std::string>());
+  case nlohmann::json::value_t::boolean:
+    return sol::make_object(lua, value.get<bool>());
+  case nlohmann::json::value_t::number_integer:
+  case nlohmann::json::value_t::number_unsigned:
+    return sol::make_object(lua, value.get<int64_t>());
+  case nlohmann::json::value_t::number_float:
+    return sol::make_object(lua, value.get<double>());
+  default:
+    return sol::nil;
+  }
+}
+
+sol::protected_function_result
+LuaStatePool::Lease::run_file(const std::string &path,
+                              const nlohmann::json &fields) {
+  if (!context_)
+    throw std::logic_error("bind_context() must be called before run_file()");
+
+  auto loaded = run_file(path);
+  if (!loaded.valid())
+    return loaded;
+  if (loaded.get_type() != sol::type::function)
+    throw sol::error("script must return function(ctx) to take a context");
+  sol::protected_function entry = loaded.get<sol::protected_function>();
+
+  sol::table ctx = lua_->create_table();
+  for (const auto &[name, value] : fields.items())
+    ctx[name] = to_lua(*lua_, value);
+  auto context = context_;
+  ctx.set_function("call", [context](const std::string &func_name,
+                                     sol::variadic_args args,
+                                     sol::this_state s) {
+    return context->call(func_name, args, s);
+  });
+  ctx.set_function("bind",
+                   [context](const std::string &func_name, sol::this_state s) {
+                     return context->bind(func_name, s);
+                   });
+  ctx.set_function("parallel", [context](sol::function block) {
+    context->parallel(std::move(block));
+  });
+  ctx.set_function("log",
+                   [context](const std::string &msg) { context->log(msg); });
+  return entry(ctx);
+}
+
+} // namespace instserver
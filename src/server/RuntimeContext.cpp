@@ -1,5 +1,6 @@
 #include "instrument-server/server/RuntimeContext.hpp"
 #include "instrument-server/Logger.hpp"
+#include "instrument-server/server/DataHandle.hpp"
 #include <fmt/format.h>
 #include <set>
 #include <variant>
@@ -25,6 +26,16 @@ static std::string param_value_type_name(const ParamValue &val) {
 
 namespace instserver {
 
+static std::string join_names(const std::set<std::string> &names) {
+  std::string out;
+  for (const auto &name : names) {
+    if (!out.empty())
+      out += ", ";
+    out += name;
+  }
+  return out;
+}
+
 RuntimeContext::RuntimeContext(InstrumentRegistry &registry,
                                SyncCoordinator &sync_coordinator,
                                bool enqueue_mode)
@@ -39,6 +50,7 @@ static void populate_callresult_from_response(CallResult &cr,
   if (resp.has_large_data) {
     cr.has_large_data = true;
     cr.buffer_id = resp.buffer_id;
+    cr.buffer_ref = resp.buffer_ref;
     cr.element_count = resp.element_count;
     cr.data_type = resp.data_type;
     cr.return_type = "buffer";
@@ -71,36 +83,172 @@ static void populate_callresult_from_response(CallResult &cr,
   }
 }
 
-sol::object RuntimeContext::call(const std::string &func_name,
-                                 sol::variadic_args args, sol::this_state s) {
-  sol::state_view lua(s);
+// Registry slot holding the LuaJIT FFI binder, if the runtime has one
+static constexpr const char *FFI_BINDER_KEY = "instrument_server.ffi_bind";
+
+// Run with the ffi module; returns function(handle, fallback) that builds a
+// bound function calling isrv_call_d(), or nil if the symbol is not
+// reachable through ffi.C (e.g. Windows DLLs). Arguments go through a
+// per-function array, so sweep loops compile without allocating.
+static constexpr const char *FFI_BINDER_CHUNK = R"lua(
+local ffi = ...
+ffi.cdef[[
+int32_t isrv_call_d(void *handle, const double *args, int32_t count,
+                    double *result);
+]]
+local ok, call_d = pcall(function() return ffi.C.isrv_call_d end)
+if not ok then
+  return nil
+end
+local MAX_ARGS = 16
+return function(handle, fallback)
+  local args = ffi.new("double[?]", MAX_ARGS)
+  local result = ffi.new("double[1]")
+  return function(...)
+    local n = select("#", ...)
+    if n > MAX_ARGS then
+      return fallback(...)
+    end
+    for i = 1, n do
+      local v = select(i, ...)
+      if type(v) ~= "number" then
+        return fallback(...)
+      end
+      args[i - 1] = v
+    end
+    if call_d(handle, args, n, result) == 1 then
+      return result[0]
+    end
+    return nil
+  end
+end
+)lua";
+
+// Positional argument names, built once rather than on every call
+static const std::string &arg_key(size_t i) {
+  static const std::vector<std::string> keys = [] {
+    std::vector<std::string> k;
+    for (size_t n = 0; n < 16; ++n)
+      k.push_back("arg" + std::to_string(n));
+    return k;
+  }();
+  if (i < keys.size())
+    return keys[i];
+  thread_local std::string key;
+  key = "arg" + std::to_string(i);
+  return key;
+}
 
-  LOG_DEBUG("LUA_CONTEXT", "CALL", "Calling function: {}", func_name);
+CallSite *RuntimeContext::resolve_call_site(const std::string &func_name) {
+  auto it = call_sites_.find(func_name);
+  if (it != call_sites_.end())
+    return &it->second;
 
   size_t dot_pos = func_name.find('.');
   if (dot_pos == std::string::npos) {
     LOG_ERROR("LUA_CONTEXT", "CALL", "Invalid function name format: {}",
               func_name);
-    return sol::nil;
+    return nullptr;
   }
 
-  std::string instrument_spec = func_name.substr(0, dot_pos);
-  std::string verb = func_name.substr(dot_pos + 1);
-
-  std::string instrument_id = instrument_spec;
-  std::optional<int> channel;
-  size_t colon_pos = instrument_spec.find(':');
+  CallSite site;
+  site.spec = func_name.substr(0, dot_pos);
+  site.verb = func_name.substr(dot_pos + 1);
+  site.instrument_id = site.spec;
+  size_t colon_pos = site.spec.find(':');
   if (colon_pos != std::string::npos) {
-    instrument_id = instrument_spec.substr(0, colon_pos);
+    site.instrument_id = site.spec.substr(0, colon_pos);
     try {
-      channel = std::stoi(instrument_spec.substr(colon_pos + 1));
+      site.channel = std::stoi(site.spec.substr(colon_pos + 1));
     } catch (const std::exception &e) {
       LOG_ERROR("LUA_CONTEXT", "CALL", "Invalid channel number in:  {}",
                 func_name);
-      return sol::nil;
+      return nullptr;
     }
   }
 
+  if (allowed_instruments_ && !allowed_instruments_->count(site.instrument_id)) {
+    LOG_ERROR("LUA_CONTEXT", "CALL",
+              "Instrument {} is not among the instruments this job holds; "
+              "list it in the job's instruments",
+              site.instrument_id);
+    return nullptr;
+  }
+
+  return &call_sites_.emplace(func_name, std::move(site)).first->second;
+}
+
+std::shared_ptr<InstrumentWorkerProxy>
+RuntimeContext::site_worker(CallSite &site) {
+  if (auto worker = site.worker.lock())
+    return worker;
+
+  // First use, or the instrument was removed (and maybe re-created with a
+  // different API) since
+  site.expects_response =
+      registry_.command_expects_response(site.instrument_id, site.verb);
+  auto worker = registry_.get_instrument(site.instrument_id);
+  site.worker = worker;
+  return worker;
+}
+
+sol::object RuntimeContext::call(const std::string &func_name,
+                                 sol::variadic_args args, sol::this_state s) {
+  LOG_DEBUG("LUA_CONTEXT", "CALL", "Calling function: {}", func_name);
+
+  CallSite *site = resolve_call_site(func_name);
+  if (!site)
+    return sol::nil;
+  return invoke(*site, args, s);
+}
+
+sol::object RuntimeContext::bind(const std::string &func_name,
+                                 sol::this_state s) {
+  sol::state_view lua(s);
+
+  CallSite *site = resolve_call_site(func_name);
+  if (!site)
+    return sol::nil;
+  sol::object bound = sol::make_object(
+      lua, [this, site](sol::variadic_args args, sol::this_state ts) {
+        return invoke(*site, args, ts);
+      });
+
+  // On LuaJIT, numeric calls skip sol2 entirely; anything else falls back
+  // to `bound`
+  sol::object binder = lua.registry()[FFI_BINDER_KEY];
+  if (binder.is<sol::protected_function>() && native_callable(*site)) {
+    // Binding the same name again (e.g. inside a sweep loop) reuses the
+    // site's handle
+    NativeCall &call =
+        native_calls_.try_emplace(site, NativeCall{this, site}).first->second;
+    sol::protected_function make_fast = binder.as<sol::protected_function>();
+    auto fast = make_fast(sol::lightuserdata_value{&call}, bound);
+    if (fast.valid())
+      return fast.get<sol::object>();
+    sol::error err = fast;
+    LOG_WARN("LUA_CONTEXT", "BIND", "FFI bind failed for {}: {}", func_name,
+             err.what());
+  }
+  return bound;
+}
+
+bool RuntimeContext::native_callable(const CallSite &site) const {
+  auto table = registry_.command_table(site.instrument_id);
+  const CommandSpec *spec = table ? table->find(site.verb) : nullptr;
+  if (!spec)
+    return false;
+  if (!spec->expects_response)
+    return true;
+  static const std::set<std::string> numeric = {"float", "double", "int",
+                                                "integer"};
+  return spec->return_type && numeric.count(*spec->return_type) > 0;
+}
+
+sol::object RuntimeContext::invoke(CallSite &site, sol::variadic_args args,
+                                   sol::this_state s) {
+  sol::state_view lua(s);
+
   std::unordered_map<std::string, ParamValue> params;
 
   if (args.size() == 1 && args[0].is<sol::table>()) {
@@ -120,7 +268,7 @@ sol::object RuntimeContext::call(const std::string &func_name,
   } else {
     for (size_t i = 0; i < args.size(); ++i) {
       auto arg = args[i];
-      std::string key = "arg" + std::to_string(i);
+      const std::string &key = arg_key(i);
 
       if (arg.is<double>()) {
         params[key] = arg.as<double>();
@@ -134,116 +282,141 @@ sol::object RuntimeContext::call(const std::string &func_name,
     }
   }
 
-  if (channel) {
-    params["channel"] = static_cast<int64_t>(*channel);
+  auto resp = dispatch(site, std::move(params));
+  if (!resp || !resp->success)
+    return sol::nil;
+
+  if (!resp->return_value && !resp->has_large_data)
+    return sol::nil;
+
+  if (resp->has_large_data) {
+    // View of the shared memory pages; nothing is copied into Lua
+    if (auto handle = DataHandle::from_buffer(resp->buffer_id))
+      return sol::make_object(lua, std::move(*handle));
+    return sol::nil;
+  }
+
+  // Map return types into Lua
+  if (auto d = std::get_if<double>(&*resp->return_value)) {
+    return sol::make_object(lua, *d);
+  } else if (auto i = std::get_if<int64_t>(&*resp->return_value)) {
+    return sol::make_object(lua, *i);
+  } else if (auto s = std::get_if<std::string>(&*resp->return_value)) {
+    return sol::make_object(lua, *s);
+  } else if (auto b = std::get_if<bool>(&*resp->return_value)) {
+    return sol::make_object(lua, *b);
+  } else if (auto arr =
+                 std::get_if<std::vector<double>>(&*resp->return_value)) {
+    return sol::make_object(lua, DataHandle(std::move(*arr)));
   }
 
-  bool expects_response =
-      registry_.command_expects_response(instrument_id, verb);
+  return sol::nil;
+}
+
+int32_t RuntimeContext::call_native(CallSite &site, const double *args,
+                                    size_t count, double *result) {
+  std::unordered_map<std::string, ParamValue> params;
+  for (size_t i = 0; i < count; ++i)
+    params[arg_key(i)] = args[i];
+
+  auto resp = dispatch(site, std::move(params));
+  if (!resp)
+    return 0;
+  if (!resp->success)
+    return -1;
+  if (resp->return_value) {
+    if (auto d = std::get_if<double>(&*resp->return_value)) {
+      *result = *d;
+      return 1;
+    } else if (auto i = std::get_if<int64_t>(&*resp->return_value)) {
+      *result = static_cast<double>(*i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+std::optional<CommandResponse>
+RuntimeContext::dispatch(CallSite &site,
+                         std::unordered_map<std::string, ParamValue> params) {
+  if (site.channel) {
+    params["channel"] = *site.channel;
+  }
+
+  auto worker = site_worker(site);
 
   // Buffer when inside parallel block
   if (in_parallel_block_) {
     SerializedCommand cmd;
-    cmd.instrument_name = instrument_id;
-    cmd.verb = verb;
-    cmd.params = params;
-    cmd.expects_response = expects_response;
+    cmd.instrument_name = site.instrument_id;
+    cmd.verb = site.verb;
+    cmd.params = std::move(params);
+    cmd.expects_response = site.expects_response;
     cmd.created_at = std::chrono::steady_clock::now();
 
     parallel_buffer_.push_back(std::move(cmd));
     LOG_DEBUG("LUA_CONTEXT", "PARALLEL", "Buffered parallel command: {}.{}",
-              instrument_id, verb);
-    return sol::nil;
+              site.instrument_id, site.verb);
+    return std::nullopt;
   }
 
   // Enqueue-mode per-call behavior (single-call tokens)
   if (enqueue_mode_ && !in_parallel_block_) {
-    auto worker = registry_.get_instrument(instrument_id);
     if (!worker) {
       LOG_ERROR("LUA_CONTEXT", "CALL", "Instrument not found: {}",
-                instrument_id);
-      return sol::nil;
+                site.instrument_id);
+      return std::nullopt;
     }
 
     SerializedCommand cmd;
-    cmd.instrument_name = instrument_id;
-    cmd.verb = verb;
+    cmd.instrument_name = site.instrument_id;
+    cmd.verb = site.verb;
     cmd.params = params;
-    cmd.expects_response = expects_response;
+    cmd.expects_response = site.expects_response;
     cmd.created_at = std::chrono::steady_clock::now();
 
-    // Single-call token
-    uint64_t token = next_sync_token_.fetch_add(1);
-
-    // Register barrier across all instruments (global participation)
-    auto all_instruments = registry_.list_instruments();
-    sync_coordinator_.register_barrier(token, all_instruments);
-
+    // Single-call token. A lone call needs no barrier: the instrument's
+    // queue already orders it after everything sent to it earlier, and no
+    // other instrument has to wait for it.
+    uint64_t token = sync_coordinator_.next_token();
     token_order_.push_back(token);
-    for (auto &inst : all_instruments)
-      token_instruments_[token].insert(inst);
-
-    // tag command with sync token and mark as sync barrier for this instrument
-    cmd.sync_token = token;
-    cmd.is_sync_barrier = true; // single call -> barrier on this cmd
+    token_timeouts_[token] = cmd.timeout;
 
     // record placeholder result index
     CallResult cr;
     cr.command_id = "";
     cr.instrument_name =
-        instrument_spec; // Preserve channel addressing like "MockInstrument1:1"
-    cr.verb = verb;
-    cr.params = params;
+        site.spec; // Preserve channel addressing like "MockInstrument1:1"
+    cr.verb = site.verb;
+    cr.params = std::move(params);
     cr.executed_at = std::chrono::steady_clock::now();
     size_t result_index = collected_results_.size();
-    collected_results_.push_back(cr);
+    collected_results_.push_back(std::move(cr));
     token_result_indices_[token].push_back(result_index);
 
     auto fut = worker->execute(std::move(cmd));
     token_futures_[token].push_back(std::move(fut));
 
-    return sol::nil;
+    return std::nullopt;
   }
 
   // Synchronous path
-  CommandResponse resp =
-      send_command(instrument_id, verb, params, expects_response);
+  CommandResponse resp = send_command(worker, site, params);
 
   CallResult cr;
   populate_callresult_from_response(cr, resp);
   cr.instrument_name =
-      instrument_spec; // Preserve channel addressing like "MockInstrument1:1"
-  cr.verb = verb;
-  cr.params = params;
+      site.spec; // Preserve channel addressing like "MockInstrument1:1"
+  cr.verb = site.verb;
+  cr.params = std::move(params);
   cr.executed_at = std::chrono::steady_clock::now();
 
-  collected_results_.push_back(cr);
+  collected_results_.push_back(std::move(cr));
 
   if (!resp.success) {
     LOG_ERROR("LUA_CONTEXT", "CALL", "Command failed: {}", resp.error_message);
-    return sol::nil;
-  }
-
-  if (!resp.return_value && !resp.has_large_data)
-    return sol::nil;
-
-  if (resp.has_large_data) {
-    // No direct Lua return for large buffers
-    return sol::nil;
-  }
-
-  // Map return types into Lua
-  if (auto d = std::get_if<double>(&*resp.return_value)) {
-    return sol::make_object(lua, *d);
-  } else if (auto i = std::get_if<int64_t>(&*resp.return_value)) {
-    return sol::make_object(lua, *i);
-  } else if (auto s = std::get_if<std::string>(&*resp.return_value)) {
-    return sol::make_object(lua, *s);
-  } else if (auto b = std::get_if<bool>(&*resp.return_value)) {
-    return sol::make_object(lua, *b);
   }
-
-  return sol::nil;
+  return resp;
 }
 
 void RuntimeContext::parallel(sol::function block) {
@@ -274,90 +447,96 @@ void RuntimeContext::parallel(sol::function block) {
   }
 
   if (enqueue_mode_) {
-    // Create token
-    uint64_t token = next_sync_token_.fetch_add(1);
-
-    // Determine instruments participating in this token:
-    // - include all registered instruments (global participation)
-    auto all_instruments = registry_.list_instruments();
-    sync_coordinator_.register_barrier(token, all_instruments);
+    uint64_t token = sync_coordinator_.next_token();
     token_order_.push_back(token);
-    for (auto &inst : all_instruments)
-      token_instruments_[token].insert(inst);
 
-    // Group buffered commands by instrument
+    // Group buffered commands by instrument, in order of first use. The
+    // block gets as long as its slowest command.
+    std::vector<std::string> instruments;
     std::unordered_map<std::string, std::vector<SerializedCommand>> per_inst;
+    std::chrono::milliseconds timeout{0};
     for (auto &cmd : parallel_buffer_) {
-      per_inst[cmd.instrument_name].push_back(cmd);
+      timeout = std::max(timeout, cmd.timeout);
+      auto &vec = per_inst[cmd.instrument_name];
+      if (vec.empty())
+        instruments.push_back(cmd.instrument_name);
+      vec.push_back(std::move(cmd));
+    }
+    parallel_buffer_.clear();
+    token_timeouts_[token] = timeout;
+
+    // Only the instruments the block uses take part in its barrier; the
+    // rest keep running whatever they were sent before or after it
+    std::unordered_map<std::string, std::shared_ptr<InstrumentWorkerProxy>>
+        workers;
+    std::vector<std::string> participants;
+    for (const auto &inst : instruments) {
+      if (auto worker = registry_.get_instrument(inst)) {
+        workers.emplace(inst, std::move(worker));
+        participants.push_back(inst);
+      } else {
+        LOG_ERROR("LUA_CONTEXT", "PARALLEL", "Instrument not found: {}",
+                  inst);
+      }
     }
 
-    // For each registered instrument:
-    for (const auto &inst : all_instruments) {
-      auto it = per_inst.find(inst);
-      if (it == per_inst.end()) {
-        // No real command for this instrument -> send NOP barrier command
-        SerializedCommand nop;
-        nop.instrument_name = inst;
-        nop.verb = "__BARRIER_NOP__";
-        nop.params = {};
-        nop.expects_response = true;
-        nop.created_at = std::chrono::steady_clock::now();
-        nop.sync_token = token;
-        nop.is_sync_barrier = true;
-
-        // placeholder result
-        CallResult cr;
-        cr.command_id = "";
-        cr.instrument_name = inst;
-        cr.verb = nop.verb;
-        cr.executed_at = std::chrono::steady_clock::now();
-        size_t result_index = collected_results_.size();
-        collected_results_.push_back(cr);
-        token_result_indices_[token].push_back(result_index);
+    // A block on a single instrument is already ordered by its queue
+    bool barrier = participants.size() > 1;
+    std::optional<ipc::SharedBarrierTicket> shared;
+    if (barrier) {
+      sync_coordinator_.register_barrier(token, participants, timeout);
+      token_instruments_[token].insert(participants.begin(),
+                                       participants.end());
+      shared = sync_coordinator_.arm_shared_barrier(token, participants.size());
+    }
 
-        auto worker = registry_.get_instrument(inst);
-        if (worker) {
-          token_futures_[token].push_back(worker->execute(std::move(nop)));
-        }
-      } else {
-        // Send each command for this instrument in order; mark last as barrier
-        auto &vec = it->second;
-        for (size_t i = 0; i < vec.size(); ++i) {
-          SerializedCommand cmd = vec[i];
+    for (const auto &inst : instruments) {
+      // Send this instrument's commands as one batch, in order; the last
+      // one is the barrier
+      auto &vec = per_inst[inst];
+      auto worker = workers.find(inst);
+      for (size_t i = 0; i < vec.size(); ++i) {
+        SerializedCommand &cmd = vec[i];
+        if (barrier) {
           cmd.sync_token = token;
-          if (i + 1 == vec.size()) {
-            cmd.is_sync_barrier = true;
-          } else {
-            cmd.is_sync_barrier = false;
+          cmd.is_sync_barrier = i + 1 == vec.size();
+          if (shared && cmd.is_sync_barrier) {
+            cmd.barrier_slot = shared->slot;
+            cmd.barrier_epoch = shared->epoch;
           }
+        }
 
-          CallResult cr;
-          cr.command_id = "";
-          // Reconstruct display name with channel if present
-          std::string display_name = cmd.instrument_name;
-          auto channel_it = cmd.params.find("channel");
-          if (channel_it != cmd.params.end()) {
-            if (auto ch = std::get_if<int64_t>(&channel_it->second)) {
-              display_name += ":" + std::to_string(*ch);
-            }
+        CallResult cr;
+        cr.command_id = "";
+        // Reconstruct display name with channel if present
+        std::string display_name = cmd.instrument_name;
+        auto channel_it = cmd.params.find("channel");
+        if (channel_it != cmd.params.end()) {
+          if (auto ch = std::get_if<int64_t>(&channel_it->second)) {
+            display_name += ":" + std::to_string(*ch);
           }
-          cr.instrument_name = display_name;
-          cr.verb = cmd.verb;
-          cr.params = cmd.params;
-          cr.executed_at = std::chrono::steady_clock::now();
-          size_t result_index = collected_results_.size();
+        }
+        cr.instrument_name = display_name;
+        cr.verb = cmd.verb;
+        cr.params = cmd.params;
+        cr.executed_at = std::chrono::steady_clock::now();
+        if (worker == workers.end()) {
+          cr.error_message = "Instrument not found: " + inst;
           collected_results_.push_back(cr);
-          token_result_indices_[token].push_back(result_index);
-
-          auto worker = registry_.get_instrument(cmd.instrument_name);
-          if (worker) {
-            token_futures_[token].push_back(worker->execute(std::move(cmd)));
-          }
+          continue;
         }
+        size_t result_index = collected_results_.size();
+        collected_results_.push_back(cr);
+        token_result_indices_[token].push_back(result_index);
+      }
+
+      if (worker != workers.end()) {
+        for (auto &fut : worker->second->execute_batch(std::move(vec)))
+          token_futures_[token].push_back(std::move(fut));
       }
     }
 
-    // Done dispatching token commands across all instruments
+    // Done dispatching token commands to the participating instruments
     return;
   }
 
@@ -370,46 +549,96 @@ void RuntimeContext::execute_parallel_buffer() {
     return;
   }
 
-  uint64_t sync_token = next_sync_token_++;
+  uint64_t sync_token = sync_coordinator_.next_token();
 
   std::vector<std::string> instruments;
   std::set<std::string> unique_instruments;
+  std::chrono::milliseconds timeout{0};
   for (const auto &cmd : parallel_buffer_) {
+    timeout = std::max(timeout, cmd.timeout);
     if (unique_instruments.insert(cmd.instrument_name).second) {
       instruments.push_back(cmd.instrument_name);
     }
   }
 
-  sync_coordinator_.register_barrier(sync_token, instruments);
+  sync_coordinator_.register_barrier(sync_token, instruments, timeout);
 
-  std::vector<std::future<CommandResponse>> futures;
-  for (auto &cmd : parallel_buffer_) {
-    cmd.sync_token = sync_token;
+  // One batch per instrument; remember each command's buffer position so
+  // results are still collected in script order
+  std::unordered_map<std::string, std::vector<size_t>> positions;
+  std::vector<std::string> owners;
+  owners.reserve(parallel_buffer_.size());
+  for (size_t i = 0; i < parallel_buffer_.size(); ++i) {
+    positions[parallel_buffer_[i].instrument_name].push_back(i);
+    owners.push_back(parallel_buffer_[i].instrument_name);
+  }
 
-    auto worker = registry_.get_instrument(cmd.instrument_name);
-    if (!worker) {
+  std::unordered_map<std::string, std::shared_ptr<InstrumentWorkerProxy>>
+      workers;
+  for (const auto &inst_name : instruments) {
+    if (auto worker = registry_.get_instrument(inst_name)) {
+      workers.emplace(inst_name, std::move(worker));
+    } else {
       LOG_ERROR("LUA_CONTEXT", "PARALLEL", "Instrument not found: {}",
-                cmd.instrument_name);
-      continue;
+                inst_name);
     }
+  }
+  // Each instrument's last command is where it waits for the others
+  auto shared =
+      sync_coordinator_.arm_shared_barrier(sync_token, workers.size());
 
-    cmd.id = fmt::format(
-        "{}-{}", cmd.instrument_name,
-        std::chrono::steady_clock::now().time_since_epoch().count());
+  std::vector<std::future<CommandResponse>> futures(parallel_buffer_.size());
+  for (const auto &inst_name : instruments) {
+    auto worker = workers.find(inst_name);
+    if (worker == workers.end())
+      continue;
 
-    LOG_DEBUG(
-        "LUA_CONTEXT", "PARALLEL",
-        "Dispatching sync command:  {} to {} (token={}, expects_response={})",
-        cmd.verb, cmd.instrument_name, sync_token, cmd.expects_response);
+    const auto &indices = positions[inst_name];
+    std::vector<SerializedCommand> batch;
+    batch.reserve(indices.size());
+    for (size_t index : indices) {
+      SerializedCommand &cmd = parallel_buffer_[index];
+      cmd.sync_token = sync_token;
+      LOG_DEBUG(
+          "LUA_CONTEXT", "PARALLEL",
+          "Dispatching sync command:  {} to {} (token={}, expects_response={})",
+          cmd.verb, cmd.instrument_name, sync_token, cmd.expects_response);
+      batch.push_back(std::move(cmd));
+    }
+    if (shared) {
+      batch.back().barrier_slot = shared->slot;
+      batch.back().barrier_epoch = shared->epoch;
+    }
 
-    futures.push_back(worker->execute(std::move(cmd)));
+    auto batch_futures = worker->second->execute_batch(std::move(batch));
+    for (size_t i = 0; i < batch_futures.size(); ++i) {
+      futures[indices[i]] = std::move(batch_futures[i]);
+    }
   }
 
   LOG_DEBUG("LUA_CONTEXT", "PARALLEL", "Waiting for {} futures",
             futures.size());
 
-  // Wait for futures first, populate results
+  // Wait for futures first, populate results. An instrument that has not
+  // answered by the barrier's deadline fails the block instead of hanging it.
+  auto deadline = sync_coordinator_.barrier_deadline(sync_token)
+                      .value_or(std::chrono::steady_clock::now() + timeout);
+  std::set<std::string> missing;
   for (size_t i = 0; i < futures.size(); ++i) {
+    if (!futures[i].valid())
+      continue;
+    if (futures[i].wait_until(deadline) != std::future_status::ready) {
+      const auto &inst_name = owners[i];
+      missing.insert(inst_name);
+      CallResult cr;
+      cr.instrument_name = inst_name;
+      cr.error_message = fmt::format("Barrier timeout (token={}): {} did not "
+                                     "respond",
+                                     sync_token, inst_name);
+      cr.executed_at = std::chrono::steady_clock::now();
+      collected_results_.push_back(cr);
+      continue;
+    }
     try {
       auto resp = futures[i].get();
       CallResult cr;
@@ -425,16 +654,24 @@ void RuntimeContext::execute_parallel_buffer() {
     }
   }
 
-  // After responses are in, send SYNC_CONTINUE to all instruments
-  for (const auto &inst_name : instruments) {
-    auto worker = registry_.get_instrument(inst_name);
-    if (worker) {
+  // After responses are in, send SYNC_CONTINUE to all instruments. Workers
+  // on a shared barrier have already passed it.
+  if (!shared) {
+    for (const auto &[inst_name, worker] : workers) {
       worker->send_sync_continue(sync_token);
       LOG_DEBUG("LUA_CONTEXT", "PARALLEL",
-                "Sent SYNC_CONTINUE to {} for token={}", inst_name, sync_token);
+                "Sent SYNC_CONTINUE to {} for token={}", inst_name,
+                sync_token);
     }
   }
 
+  if (!missing.empty()) {
+    sync_coordinator_.fail_barrier(sync_token);
+    LOG_ERROR("LUA_CONTEXT", "PARALLEL",
+              "Parallel block failed (token={}), no response from: {}",
+              sync_token, join_names(missing));
+    return;
+  }
   sync_coordinator_.clear_barrier(sync_token);
 
   LOG_INFO("LUA_CONTEXT", "PARALLEL", "Parallel block complete (token={})",
@@ -446,30 +683,28 @@ void RuntimeContext::log(const std::string &msg) {
 }
 
 CommandResponse RuntimeContext::send_command(
-    const std::string &instrument_id, const std::string &verb,
-    const std::unordered_map<std::string, ParamValue> &params,
-    bool expects_response) {
-  auto worker = registry_.get_instrument(instrument_id);
+    const std::shared_ptr<InstrumentWorkerProxy> &worker, const CallSite &site,
+    const std::unordered_map<std::string, ParamValue> &params) {
   if (!worker) {
     CommandResponse resp;
     resp.success = false;
-    resp.error_message = "Instrument not found: " + instrument_id;
+    resp.error_message = "Instrument not found: " + site.instrument_id;
     return resp;
   }
 
   SerializedCommand cmd;
   cmd.id =
-      fmt::format("{}-{}", instrument_id,
+      fmt::format("{}-{}", site.instrument_id,
                   std::chrono::steady_clock::now().time_since_epoch().count());
-  cmd.instrument_name = instrument_id;
-  cmd.verb = verb;
+  cmd.instrument_name = site.instrument_id;
+  cmd.verb = site.verb;
   cmd.params = params;
   cmd.created_at = std::chrono::steady_clock::now();
-  cmd.expects_response = expects_response;
+  cmd.expects_response = site.expects_response;
 
   LOG_DEBUG("LUA_CONTEXT", "SEND",
-            "Sending command {}.{} (expects_response={})", instrument_id, verb,
-            expects_response);
+            "Sending command {}.{} (expects_response={})", site.instrument_id,
+            site.verb, site.expects_response);
 
   return worker->execute_sync(std::move(cmd), std::chrono::milliseconds(5000));
 }
@@ -479,11 +714,21 @@ void RuntimeContext::process_tokens_and_wait() {
     auto it_futs = token_futures_.find(token);
     auto it_inds = token_result_indices_.find(token);
 
+    // Earlier tokens may have kept the token's instruments busy past its
+    // barrier deadline, so it always gets its full timeout from here on
+    auto timeout_it = token_timeouts_.find(token);
+    auto timeout = timeout_it != token_timeouts_.end()
+                       ? timeout_it->second
+                       : SyncCoordinator::DEFAULT_BARRIER_TIMEOUT;
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = std::max(
+        sync_coordinator_.barrier_deadline(token).value_or(now), now + timeout);
+    std::set<std::string> missing;
+
     if (it_futs != token_futures_.end()) {
       auto &futs = it_futs->second;
       for (size_t i = 0; i < futs.size(); ++i) {
         try {
-          auto resp = futs[i].get();
           size_t result_index = 0;
           if (it_inds != token_result_indices_.end() &&
               i < it_inds->second.size()) {
@@ -493,6 +738,19 @@ void RuntimeContext::process_tokens_and_wait() {
             collected_results_.push_back(CallResult());
           }
 
+          if (futs[i].wait_until(deadline) != std::future_status::ready) {
+            auto &cr = collected_results_[result_index];
+            auto inst = cr.instrument_name.substr(
+                0, cr.instrument_name.find(':'));
+            missing.insert(inst);
+            cr.success = false;
+            cr.error_message = fmt::format(
+                "Barrier timeout (token={}): {} did not respond", token, inst);
+            cr.executed_at = std::chrono::steady_clock::now();
+            continue;
+          }
+
+          auto resp = futs[i].get();
           auto &cr = collected_results_[result_index];
           populate_callresult_from_response(cr, resp);
           cr.executed_at = std::chrono::steady_clock::now();
@@ -504,9 +762,11 @@ void RuntimeContext::process_tokens_and_wait() {
       }
     }
 
-    // Now send SYNC_CONTINUE to all instruments in the token
+    // Now send SYNC_CONTINUE to all instruments in the token, unless its
+    // workers met at a shared barrier and have already moved on
     auto it_inst = token_instruments_.find(token);
-    if (it_inst != token_instruments_.end()) {
+    if (it_inst != token_instruments_.end() &&
+        !sync_coordinator_.is_shared_barrier(token)) {
       for (const auto &inst : it_inst->second) {
         auto worker = registry_.get_instrument(inst);
         if (worker) {
@@ -517,6 +777,13 @@ void RuntimeContext::process_tokens_and_wait() {
       }
     }
 
+    if (!missing.empty()) {
+      sync_coordinator_.fail_barrier(token);
+      LOG_ERROR("LUA_CONTEXT", "TOKEN",
+                "Token {} failed, no response from: {}", token,
+                join_names(missing));
+    }
+
     try {
       sync_coordinator_.clear_barrier(token);
     } catch (...) {
@@ -529,6 +796,7 @@ void RuntimeContext::process_tokens_and_wait() {
   token_instruments_.clear();
   token_futures_.clear();
   token_result_indices_.clear();
+  token_timeouts_.clear();
 }
 
 nlohmann::json RuntimeContext::collect_results_json() const {
@@ -569,13 +837,68 @@ nlohmann::json RuntimeContext::collect_results_json() const {
   return out;
 }
 
-std::shared_ptr<RuntimeContext>
-bind_runtime_context(sol::state &lua, InstrumentRegistry &registry,
-                     SyncCoordinator &sync_coordinator, bool enqueue_mode) {
+void register_runtime_types(sol::state &lua) {
+  // Lua indices are 1-based; slice(first, last) is inclusive like
+  // string.sub, with last defaulting to the end
+  lua.new_usertype<DataHandle>(
+      "DataHandle", sol::no_constructor, "id", &DataHandle::id, "size",
+      &DataHandle::size, "type", &DataHandle::data_type, "sum",
+      &DataHandle::sum, "mean", &DataHandle::mean, "min", &DataHandle::min,
+      "max", &DataHandle::max, "slice",
+      [](const DataHandle &handle, int64_t first,
+         sol::optional<int64_t> last) {
+        int64_t size = static_cast<int64_t>(handle.size());
+        int64_t from = std::max<int64_t>(first, 1);
+        int64_t to = std::min(last.value_or(size), size);
+        if (to < from)
+          return handle.slice(0, 0);
+        return handle.slice(static_cast<size_t>(from - 1),
+                            static_cast<size_t>(to - from + 1));
+      },
+      "to_table",
+      [](const DataHandle &handle) { return sol::as_table(handle.to_vector()); },
+      sol::meta_function::length, &DataHandle::size, sol::meta_function::index,
+      [](const DataHandle &handle, sol::stack_object key,
+         sol::this_state s) -> sol::object {
+        if (!key.is<int64_t>())
+          return sol::nil;
+        int64_t index = key.as<int64_t>();
+        if (index < 1)
+          return sol::nil;
+        auto value = handle.at(static_cast<size_t>(index - 1));
+        if (!value)
+          return sol::nil;
+        return sol::make_object(s, *value);
+      });
+
   lua.new_usertype<RuntimeContext>(
       "RuntimeContext", sol::no_constructor, "call", &RuntimeContext::call,
-      "parallel", &RuntimeContext::parallel, "log", &RuntimeContext::log);
+      "bind", &RuntimeContext::bind, "parallel", &RuntimeContext::parallel,
+      "log", &RuntimeContext::log);
+
+#ifdef INSTRUMENT_SERVER_LUAJIT
+  // Opened by calling luaopen_ffi directly, not through require, so the
+  // module never lands in package.loaded: scripts get no raw memory access
+  // through require "ffi" even if the package library is opened
+  lua_State *L = lua.lua_state();
+  lua_pushcfunction(L, luaopen_ffi);
+  lua_call(L, 0, 1);
+  sol::table ffi = sol::stack::pop<sol::table>(L);
+  sol::load_result chunk = lua.load(FFI_BINDER_CHUNK, "=ffi_binder");
+  if (chunk.valid()) {
+    // The chunk takes the ffi module as its vararg
+    sol::protected_function make_binder = chunk;
+    auto made = make_binder(ffi);
+    if (made.valid() && made.get_type() == sol::type::function)
+      lua.registry()[FFI_BINDER_KEY] = made.get<sol::protected_function>();
+  }
+#endif
+}
 
+std::shared_ptr<RuntimeContext>
+bind_runtime_context(sol::state &lua, InstrumentRegistry &registry,
+                     SyncCoordinator &sync_coordinator, bool enqueue_mode) {
+  register_runtime_types(lua);
   auto ctx = std::make_shared<RuntimeContext>(registry, sync_coordinator,
                                               enqueue_mode);
   lua["context"] = ctx;
@@ -583,3 +906,17 @@ bind_runtime_context(sol::state &lua, InstrumentRegistry &registry,
 }
 
 } // namespace instserver
+
+extern "C" int32_t isrv_call_d(void *handle, const double *args,
+                               int32_t count, double *result) {
+  auto *call = static_cast<instserver::RuntimeContext::NativeCall *>(handle);
+  if (!call || count < 0 || (count > 0 && !args) || !result)
+    return -1;
+  try {
+    return call->context->call_native(*call->site, args,
+                                      static_cast<size_t>(count), result);
+  } catch (const std::exception &e) {
+    LOG_ERROR("LUA_CONTEXT", "FFI", "Native call failed: {}", e.what());
+    return -1;
+  }
+}
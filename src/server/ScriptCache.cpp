@@ -0,0 +1,128 @@
+#include "instrument-server/server/ScriptCache.hpp"
+#include "instrument-server/Logger.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <optional>
+
+namespace instserver {
+
+// FNV-1a; only compared against earlier versions of the same file
+static uint64_t content_hash(const std::string &data) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Blank out what luaL_loadfile would skip (a UTF-8 BOM and a leading '#'
+// line), keeping line numbers the same
+static void strip_file_prefix(std::string &source) {
+  if (source.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    source.erase(0, 3);
+  if (!source.empty() && source[0] == '#')
+    source.erase(0, source.find('\n'));
+}
+
+ScriptCache &ScriptCache::instance() {
+  static ScriptCache cache;
+  return cache;
+}
+
+sol::load_result ScriptCache::load(sol::state &lua, const std::string &path) {
+  const std::string chunk_name = "@" + path;
+
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  uintmax_t size = ec ? 0 : std::filesystem::file_size(path, ec);
+  if (ec) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      entries_.erase(path);
+    }
+    // Let Lua report the missing file the way it always has
+    return lua.load_file(path);
+  }
+
+  std::shared_ptr<const std::string> bytecode;
+  std::optional<uint64_t> cached_hash;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+      if (it->second.mtime == mtime && it->second.size == size)
+        bytecode = it->second.bytecode;
+      else
+        cached_hash = it->second.hash;
+    }
+  }
+
+  std::string source;
+  uint64_t hash = 0;
+  if (!bytecode) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+      return lua.load_file(path);
+    source.assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+    hash = content_hash(source);
+
+    // Touched but not changed: keep the bytecode, remember the new stamp
+    if (cached_hash && *cached_hash == hash) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(path);
+      if (it != entries_.end() && it->second.hash == hash) {
+        it->second.mtime = mtime;
+        it->second.size = size;
+        bytecode = it->second.bytecode;
+      }
+    }
+  }
+
+  if (bytecode) {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return lua.load(*bytecode, chunk_name, sol::load_mode::binary);
+  }
+
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  strip_file_prefix(source);
+  sol::load_result chunk = lua.load(source, chunk_name, sol::load_mode::text);
+  if (!chunk.valid())
+    return chunk;
+
+  // Keep debug info so runtime errors still name file and line
+  sol::protected_function compiled = chunk;
+  sol::bytecode code = compiled.dump();
+  auto entry_code = std::make_shared<const std::string>(code.as_string_view());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[path] = Entry{mtime, size, hash, std::move(entry_code)};
+  }
+  LOG_DEBUG("SCRIPT_CACHE", "COMPILE", "Compiled {} ({} bytes of bytecode)",
+            path, code.size());
+  return chunk;
+}
+
+void ScriptCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+nlohmann::json ScriptCache::stats_json() const {
+  uint64_t hit_count = hits();
+  uint64_t miss_count = misses();
+  uint64_t total = hit_count + miss_count;
+  size_t entry_count;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry_count = entries_.size();
+  }
+  return {{"hits", hit_count},
+          {"misses", miss_count},
+          {"entries", entry_count},
+          {"hit_rate", total ? static_cast<double>(hit_count) / total : 0.0}};
+}
+
+} // namespace instserver
@@ -1,103 +1,417 @@
 #include "instrument-server/server/SyncCoordinator.hpp"
 #include "instrument-server/Logger.hpp"
 
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <deque>
+#include <shared_mutex>
+
 namespace instserver {
 
+namespace {
+
+constexpr size_t MASK_BITS = 64;
+
+/// Arrival latency counters for one instrument, updated without a lock
+struct ArrivalHistogram {
+  std::atomic<uint64_t> buckets[BARRIER_ARRIVAL_BUCKETS] = {};
+  std::atomic<uint64_t> arrivals{0};
+  std::atomic<uint64_t> timeouts{0};
+  std::atomic<uint64_t> total_us{0};
+  std::atomic<uint64_t> max_us{0};
+};
+
+/// Process-wide name <-> ID table; read far more often than written.
+/// `arrivals` is indexed by ID like `names`; a deque so entries never move.
+struct InstrumentIds {
+  std::shared_mutex mutex;
+  std::unordered_map<std::string, uint32_t> ids;
+  std::vector<std::string> names;
+  std::deque<ArrivalHistogram> arrivals;
+};
+
+InstrumentIds &instrument_ids() {
+  static InstrumentIds table;
+  return table;
+}
+
+size_t arrival_bucket(uint64_t us) {
+  size_t bucket = 0;
+  while (bucket + 1 < BARRIER_ARRIVAL_BUCKETS && us >= (uint64_t{1} << bucket))
+    ++bucket;
+  return bucket;
+}
+
+void record_arrival(uint32_t instrument_id,
+                    std::chrono::steady_clock::duration latency) {
+  uint64_t us = static_cast<uint64_t>(std::max<int64_t>(
+      0, std::chrono::duration_cast<std::chrono::microseconds>(latency)
+             .count()));
+  auto &table = instrument_ids();
+  std::shared_lock lock(table.mutex);
+  if (instrument_id >= table.arrivals.size())
+    return;
+  auto &hist = table.arrivals[instrument_id];
+  hist.buckets[arrival_bucket(us)].fetch_add(1, std::memory_order_relaxed);
+  hist.arrivals.fetch_add(1, std::memory_order_relaxed);
+  hist.total_us.fetch_add(us, std::memory_order_relaxed);
+  uint64_t max = hist.max_us.load(std::memory_order_relaxed);
+  while (us > max &&
+         !hist.max_us.compare_exchange_weak(max, us, std::memory_order_relaxed))
+    ;
+}
+
+void record_timeout(uint32_t instrument_id) {
+  auto &table = instrument_ids();
+  std::shared_lock lock(table.mutex);
+  if (instrument_id < table.arrivals.size())
+    table.arrivals[instrument_id].timeouts.fetch_add(1,
+                                                     std::memory_order_relaxed);
+}
+
+} // namespace
+
+uint32_t SyncCoordinator::intern_instrument(const std::string &instrument_name) {
+  auto &table = instrument_ids();
+  {
+    std::shared_lock lock(table.mutex);
+    auto it = table.ids.find(instrument_name);
+    if (it != table.ids.end())
+      return it->second;
+  }
+
+  std::unique_lock lock(table.mutex);
+  auto [it, inserted] = table.ids.emplace(
+      instrument_name, static_cast<uint32_t>(table.names.size()));
+  if (inserted) {
+    table.names.push_back(instrument_name);
+    table.arrivals.emplace_back();
+  }
+  return it->second;
+}
+
+std::string SyncCoordinator::instrument_name(uint32_t instrument_id) {
+  auto &table = instrument_ids();
+  std::shared_lock lock(table.mutex);
+  return instrument_id < table.names.size() ? table.names[instrument_id]
+                                            : std::string();
+}
+
+SyncCoordinator::SyncBarrier::SyncBarrier(std::vector<uint64_t> mask)
+    : expected(std::move(mask)), pending(expected.size()),
+      created_at(std::chrono::steady_clock::now()) {
+  for (size_t i = 0; i < expected.size(); ++i) {
+    pending[i].store(expected[i], std::memory_order_relaxed);
+    expected_count += std::bitset<MASK_BITS>(expected[i]).count();
+  }
+  remaining.store(expected_count, std::memory_order_release);
+}
+
+SyncCoordinator::~SyncCoordinator() {
+  for (auto &shard : shards_) {
+    for (const auto &[token, barrier] : shard.barriers)
+      disarm_shared(barrier->shared);
+  }
+}
+
 void SyncCoordinator::register_barrier(
-    uint64_t sync_token, const std::vector<std::string> &instruments) {
-  std::lock_guard lock(mutex_);
+    uint64_t sync_token, const std::vector<std::string> &instruments,
+    std::chrono::milliseconds timeout) {
+  std::vector<uint32_t> ids;
+  ids.reserve(instruments.size());
+  for (const auto &name : instruments)
+    ids.push_back(intern_instrument(name));
+  register_barrier_ids(sync_token, ids, timeout);
+}
 
-  SyncBarrier barrier;
-  barrier.expected_instruments =
-      std::set<std::string>(instruments.begin(), instruments.end());
-  barrier.created_at = std::chrono::steady_clock::now();
+void SyncCoordinator::register_barrier_ids(
+    uint64_t sync_token, const std::vector<uint32_t> &instrument_ids,
+    std::chrono::milliseconds timeout) {
+  std::vector<uint64_t> mask;
+  for (uint32_t id : instrument_ids) {
+    size_t word = id / MASK_BITS;
+    if (word >= mask.size())
+      mask.resize(word + 1, 0);
+    mask[word] |= uint64_t{1} << (id % MASK_BITS);
+  }
+  auto barrier = std::make_shared<SyncBarrier>(std::move(mask));
+  barrier->deadline = barrier->created_at + timeout;
 
-  barriers_[sync_token] = std::move(barrier);
+  std::optional<ipc::SharedBarrierTicket> replaced;
+  {
+    auto &shard = shard_for(sync_token);
+    std::lock_guard lock(shard.mutex);
+    auto &slot = shard.barriers[sync_token];
+    if (slot)
+      replaced = slot->shared;
+    slot = barrier;
+  }
+  disarm_shared(replaced);
 
   LOG_DEBUG("SYNC", "REGISTER",
             "Registered barrier token={} with {} instruments", sync_token,
-            instruments.size());
+            barrier->expected_count);
+}
+
+std::optional<ipc::SharedBarrierTicket>
+SyncCoordinator::arm_shared_barrier(uint64_t sync_token, size_t participants) {
+  auto *table = ipc::SharedBarrierTable::server();
+  if (!table || participants == 0 ||
+      participants > ipc::SHARED_BARRIER_MAX_PARTICIPANTS)
+    return std::nullopt;
+
+  auto &shard = shard_for(sync_token);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.barriers.find(sync_token);
+  if (it == shard.barriers.end()) {
+    LOG_WARN("SYNC", "SHARED", "Cannot arm unregistered token={}", sync_token);
+    return std::nullopt;
+  }
+
+  auto ticket = table->arm(static_cast<uint32_t>(participants));
+  if (!ticket) {
+    LOG_DEBUG("SYNC", "SHARED",
+              "No free shared barrier slot for token={}; using SYNC_ACK",
+              sync_token);
+    return std::nullopt;
+  }
+
+  disarm_shared(it->second->shared);
+  it->second->shared = ticket;
+  LOG_DEBUG("SYNC", "SHARED",
+            "Armed shared barrier token={} slot={} epoch={} ({} workers)",
+            sync_token, ticket->slot, ticket->epoch, participants);
+  return ticket;
+}
+
+bool SyncCoordinator::is_shared_barrier(uint64_t sync_token) const {
+  const auto &shard = shard_for(sync_token);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.barriers.find(sync_token);
+  return it != shard.barriers.end() && it->second->shared.has_value();
 }
 
 bool SyncCoordinator::handle_ack(uint64_t sync_token,
                                  const std::string &instrument_name) {
-  std::lock_guard lock(mutex_);
+  return handle_ack(sync_token, intern_instrument(instrument_name));
+}
 
-  auto it = barriers_.find(sync_token);
-  if (it == barriers_.end()) {
+bool SyncCoordinator::handle_ack(uint64_t sync_token, uint32_t instrument_id) {
+  auto barrier = find_barrier(sync_token);
+  if (!barrier) {
     LOG_WARN("SYNC", "ACK", "Unknown sync token:  {}", sync_token);
     return false;
   }
 
-  auto &barrier = it->second;
-
   // Check if this instrument is expected
-  if (barrier.expected_instruments.find(instrument_name) ==
-      barrier.expected_instruments.end()) {
+  size_t word = instrument_id / MASK_BITS;
+  uint64_t bit = uint64_t{1} << (instrument_id % MASK_BITS);
+  if (word >= barrier->expected.size() || !(barrier->expected[word] & bit)) {
     LOG_WARN("SYNC", "ACK",
              "Unexpected ACK from {} for token {} (not in expected set)",
-             instrument_name, sync_token);
+             instrument_name(instrument_id), sync_token);
     return false;
   }
 
-  // Record acknowledgment
-  barrier.acked_instruments.insert(instrument_name);
+  // Record acknowledgment; a duplicate finds its bit already clear
+  uint64_t before =
+      barrier->pending[word].fetch_and(~bit, std::memory_order_acq_rel);
+  if (!(before & bit))
+    return false;
+  record_arrival(instrument_id,
+                 std::chrono::steady_clock::now() - barrier->created_at);
 
-  LOG_DEBUG("SYNC", "ACK", "Instrument {} ACKed token {} ({}/{})",
-            instrument_name, sync_token, barrier.acked_instruments.size(),
-            barrier.expected_instruments.size());
+  size_t remaining =
+      barrier->remaining.fetch_sub(1, std::memory_order_acq_rel) - 1;
+  LOG_DEBUG("SYNC", "ACK", "Instrument #{} ACKed token {} ({}/{})",
+            instrument_id, sync_token, barrier->expected_count - remaining,
+            barrier->expected_count);
+  if (remaining != 0)
+    return false;
 
-  // Check if all instruments have acknowledged
-  bool complete = (barrier.acked_instruments == barrier.expected_instruments);
+  LOG_INFO("SYNC", "COMPLETE", "Barrier {} complete, all {} instruments ACKed",
+           sync_token, barrier->expected_count);
 
-  if (complete) {
-    LOG_INFO("SYNC", "COMPLETE",
-             "Barrier {} complete, all {} instruments ACKed", sync_token,
-             barrier.expected_instruments.size());
-    barriers_.erase(it);
-    LOG_DEBUG("SYNC", "AUTO_CLEAR", "Auto-cleared completed barrier token={}",
-              sync_token);
+  // Only the ACK that took the count to zero gets here. Leave a barrier
+  // re-registered under the same token in the meantime alone.
+  std::optional<ipc::SharedBarrierTicket> ticket;
+  {
+    auto &shard = shard_for(sync_token);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.barriers.find(sync_token);
+    if (it != shard.barriers.end() && it->second == barrier) {
+      ticket = barrier->shared;
+      shard.barriers.erase(it);
+    }
   }
-
-  return complete;
+  disarm_shared(ticket);
+  LOG_DEBUG("SYNC", "AUTO_CLEAR", "Auto-cleared completed barrier token={}",
+            sync_token);
+  return true;
 }
 
 std::vector<std::string>
 SyncCoordinator::get_waiting_instruments(uint64_t sync_token) const {
-  std::lock_guard lock(mutex_);
-
-  auto it = barriers_.find(sync_token);
-  if (it == barriers_.end()) {
+  auto barrier = find_barrier(sync_token);
+  if (!barrier) {
     return {};
   }
 
-  const auto &barrier = it->second;
   std::vector<std::string> waiting;
+  for (uint32_t id : pending_ids(*barrier))
+    waiting.push_back(instrument_name(id));
+  return waiting;
+}
 
-  for (const auto &inst : barrier.expected_instruments) {
-    if (barrier.acked_instruments.find(inst) ==
-        barrier.acked_instruments.end()) {
-      waiting.push_back(inst);
-    }
+std::optional<std::chrono::steady_clock::time_point>
+SyncCoordinator::barrier_deadline(uint64_t sync_token) const {
+  auto barrier = find_barrier(sync_token);
+  if (!barrier)
+    return std::nullopt;
+  return barrier->deadline;
+}
+
+std::vector<std::string> SyncCoordinator::fail_barrier(uint64_t sync_token) {
+  std::shared_ptr<SyncBarrier> barrier;
+  {
+    auto &shard = shard_for(sync_token);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.barriers.find(sync_token);
+    if (it == shard.barriers.end())
+      return {};
+    barrier = std::move(it->second);
+    shard.barriers.erase(it);
   }
+  disarm_shared(barrier->shared);
 
-  return waiting;
+  std::vector<std::string> missing;
+  std::string list;
+  for (uint32_t id : pending_ids(*barrier)) {
+    if (!barrier->shared)
+      record_timeout(id);
+    missing.push_back(instrument_name(id));
+    list += (list.empty() ? "" : ", ") + missing.back();
+  }
+
+  auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - barrier->created_at);
+  LOG_WARN("SYNC", "TIMEOUT",
+           "Barrier {} failed after {} ms, {}/{} instruments missing: {}",
+           sync_token, waited.count(), missing.size(), barrier->expected_count,
+           list);
+  return missing;
 }
 
 bool SyncCoordinator::has_barrier(uint64_t sync_token) const {
-  std::lock_guard lock(mutex_);
-  return barriers_.find(sync_token) != barriers_.end();
+  return find_barrier(sync_token) != nullptr;
 }
 
 void SyncCoordinator::clear_barrier(uint64_t sync_token) {
-  std::lock_guard lock(mutex_);
-  barriers_.erase(sync_token);
+  std::optional<ipc::SharedBarrierTicket> ticket;
+  {
+    auto &shard = shard_for(sync_token);
+    std::lock_guard lock(shard.mutex);
+    auto it = shard.barriers.find(sync_token);
+    if (it != shard.barriers.end()) {
+      ticket = it->second->shared;
+      shard.barriers.erase(it);
+    }
+  }
+  disarm_shared(ticket);
   LOG_DEBUG("SYNC", "CLEAR", "Cleared barrier token={}", sync_token);
 }
 
 size_t SyncCoordinator::active_barrier_count() const {
-  std::lock_guard lock(mutex_);
-  return barriers_.size();
+  size_t count = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard lock(shard.mutex);
+    count += shard.barriers.size();
+  }
+  return count;
+}
+
+std::vector<BarrierArrivalStats> SyncCoordinator::arrival_stats() {
+  auto &table = instrument_ids();
+  std::shared_lock lock(table.mutex);
+
+  std::vector<BarrierArrivalStats> out;
+  out.reserve(table.names.size());
+  for (size_t id = 0; id < table.names.size(); ++id) {
+    const auto &hist = table.arrivals[id];
+    BarrierArrivalStats stats;
+    stats.instrument = table.names[id];
+    stats.arrivals = hist.arrivals.load(std::memory_order_relaxed);
+    stats.timeouts = hist.timeouts.load(std::memory_order_relaxed);
+    stats.total_us = hist.total_us.load(std::memory_order_relaxed);
+    stats.max_us = hist.max_us.load(std::memory_order_relaxed);
+    stats.buckets.reserve(BARRIER_ARRIVAL_BUCKETS);
+    for (const auto &bucket : hist.buckets)
+      stats.buckets.push_back(bucket.load(std::memory_order_relaxed));
+    out.push_back(std::move(stats));
+  }
+  return out;
+}
+
+void SyncCoordinator::reset_arrival_stats() {
+  auto &table = instrument_ids();
+  std::shared_lock lock(table.mutex);
+  for (auto &hist : table.arrivals) {
+    for (auto &bucket : hist.buckets)
+      bucket.store(0, std::memory_order_relaxed);
+    hist.arrivals.store(0, std::memory_order_relaxed);
+    hist.timeouts.store(0, std::memory_order_relaxed);
+    hist.total_us.store(0, std::memory_order_relaxed);
+    hist.max_us.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t BarrierArrivalStats::quantile_us(double q) const {
+  uint64_t counted = 0;
+  for (uint64_t count : buckets)
+    counted += count;
+  if (counted == 0)
+    return 0;
+
+  auto rank =
+      static_cast<uint64_t>(std::ceil(q * static_cast<double>(counted)));
+  rank = std::clamp<uint64_t>(rank, 1, counted);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank)
+      return i + 1 < buckets.size() ? uint64_t{1} << i : max_us;
+  }
+  return max_us;
+}
+
+std::vector<uint32_t>
+SyncCoordinator::pending_ids(const SyncBarrier &barrier) {
+  std::vector<uint32_t> ids;
+  for (size_t word = 0; word < barrier.pending.size(); ++word) {
+    uint64_t bits = barrier.pending[word].load(std::memory_order_acquire);
+    for (size_t bit = 0; bits != 0; ++bit, bits >>= 1) {
+      if (bits & 1)
+        ids.push_back(static_cast<uint32_t>(word * MASK_BITS + bit));
+    }
+  }
+  return ids;
+}
+
+std::shared_ptr<SyncCoordinator::SyncBarrier>
+SyncCoordinator::find_barrier(uint64_t sync_token) const {
+  const auto &shard = shard_for(sync_token);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.barriers.find(sync_token);
+  return it != shard.barriers.end() ? it->second : nullptr;
+}
+
+void SyncCoordinator::disarm_shared(
+    const std::optional<ipc::SharedBarrierTicket> &ticket) {
+  if (!ticket)
+    return;
+  if (auto *table = ipc::SharedBarrierTable::server())
+    table->disarm(*ticket);
 }
 
 } // namespace instserver
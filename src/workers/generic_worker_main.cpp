@@ -1,11 +1,18 @@
 #include "instrument-server/Logger.hpp"
 #include "instrument-server/SerializedCommand.hpp"
+#include "instrument-server/ipc/BinaryCodec.hpp"
+#include "instrument-server/ipc/DataBufferManager.hpp"
+#include "instrument-server/ipc/SharedBarrier.hpp"
 #include "instrument-server/ipc/SharedQueue.hpp"
 #include "instrument-server/plugin/PluginLoader.hpp"
 #include <chrono>
 #include <csignal>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 using namespace instserver;
 
@@ -110,20 +117,22 @@ static CommandResponse from_plugin_response(const PluginResponse &presp) {
 namespace {
 constexpr auto HEARTBEAT_INTERVAL = std::chrono::milliseconds(500);
 constexpr auto IPC_SEND_TIMEOUT = std::chrono::milliseconds(1000);
-constexpr auto IPC_RECV_TIMEOUT = std::chrono::milliseconds(100);
 constexpr auto HEARTBEAT_SEND_TIMEOUT = std::chrono::milliseconds(100);
 
 class Instrument {
 public:
-  Instrument(const std::string &instrument_name, const std::string &plugin_path)
+  Instrument(const std::string &instrument_name, const std::string &plugin_path,
+             int doorbell_fd, const std::string &sync_segment)
       : instrument_name_(instrument_name), plugin_path_(plugin_path),
-        plugin_(plugin_path) {}
+        plugin_(plugin_path), doorbell_fd_(doorbell_fd),
+        sync_segment_(sync_segment) {}
 
   int run() {
     if (!load_and_init_plugin())
       return 1;
     if (!connect_ipc_queue())
       return 1;
+    open_shared_barriers();
 
     LOG_INFO(instrument_name_, "WORKER_MAIN", "Entering main loop");
     main_loop();
@@ -137,8 +146,16 @@ private:
   std::string instrument_name_;
   std::string plugin_path_;
   plugin::PluginLoader plugin_;
+  int doorbell_fd_;
+  std::string sync_segment_;
   std::unique_ptr<ipc::SharedQueue> ipc_queue_;
+  std::unique_ptr<ipc::SharedBarrierTable> barriers_;
+  ipc::BinaryEncoder encoder_;
+  ipc::BinaryDecoder decoder_;
+  bool reply_binary_{false};
   std::optional<uint64_t> waiting_sync_token_;
+  std::deque<ipc::IPCMessage> deferred_; // Received while reclaiming buffers
+  std::deque<ipc::IPCMessage> blocked_;  // Received while waiting on a token
   std::chrono::steady_clock::time_point last_heartbeat_ =
       std::chrono::steady_clock::now();
 
@@ -180,13 +197,38 @@ private:
       return false;
     }
     LOG_INFO(instrument_name_, "WORKER_MAIN", "IPC queue connected");
+    // Wakes the server's event reactor whenever we send
+    ipc_queue_->set_doorbell(doorbell_fd_);
+
+    // A plugin blocked on the buffer budget is waiting for the server to
+    // release buffers, which arrive on this same queue
+    ipc::DataBufferManager::instance().set_reclaim_handler(
+        [this](std::chrono::milliseconds wait) { reclaim_buffers(wait); });
     return true;
   }
 
+  void open_shared_barriers() {
+    if (sync_segment_.empty())
+      return;
+    // Without it, commands carrying a barrier ticket just don't wait
+    barriers_ = ipc::SharedBarrierTable::open(sync_segment_);
+    if (barriers_) {
+      LOG_INFO(instrument_name_, "WORKER_MAIN", "Shared barriers mapped: {}",
+               sync_segment_);
+    }
+  }
+
   void main_loop() {
     while (g_running) {
       send_heartbeat_if_needed();
-      auto msg_opt = ipc_queue_->receive(IPC_RECV_TIMEOUT);
+      if (!deferred_.empty()) {
+        ipc::IPCMessage msg = std::move(deferred_.front());
+        deferred_.pop_front();
+        process_message(msg);
+        continue;
+      }
+      // Sleep until a message arrives or the next heartbeat is due
+      auto msg_opt = ipc_queue_->receive(time_until_heartbeat());
       if (!msg_opt)
         continue;
       process_message(*msg_opt);
@@ -194,13 +236,34 @@ private:
     LOG_INFO(instrument_name_, "WORKER_MAIN", "Shutting down");
   }
 
+  /// Runs inside a plugin call: apply buffer releases now, keep the rest
+  /// for the main loop
+  void reclaim_buffers(std::chrono::milliseconds wait) {
+    send_heartbeat_if_needed();
+    auto msg_opt = ipc_queue_->receive(wait);
+    if (!msg_opt)
+      return;
+    if (msg_opt->type == ipc::IPCMessage::Type::BUFFER_RELEASE) {
+      ipc::DataBufferManager::instance().release_buffer(msg_opt->payload);
+    } else {
+      deferred_.push_back(std::move(*msg_opt));
+    }
+  }
+
+  std::chrono::milliseconds time_until_heartbeat() const {
+    auto due = last_heartbeat_ + HEARTBEAT_INTERVAL;
+    auto now = std::chrono::steady_clock::now();
+    if (due <= now)
+      return std::chrono::milliseconds(0);
+    return std::chrono::ceil<std::chrono::milliseconds>(due - now);
+  }
+
   void send_heartbeat_if_needed() {
     auto now = std::chrono::steady_clock::now();
     if (now - last_heartbeat_ >= HEARTBEAT_INTERVAL) {
       ipc::IPCMessage heartbeat;
       heartbeat.type = ipc::IPCMessage::Type::HEARTBEAT;
       heartbeat.id = 0;
-      heartbeat.payload_size = 0;
       ipc_queue_->send(heartbeat, HEARTBEAT_SEND_TIMEOUT);
       last_heartbeat_ = now;
     }
@@ -214,13 +277,24 @@ private:
     case ipc::IPCMessage::Type::SYNC_CONTINUE:
       handle_sync_continue(msg);
       break;
+    case ipc::IPCMessage::Type::BUFFER_RELEASE:
+      // Server dropped its mapping; drop the reference taken at creation
+      ipc::DataBufferManager::instance().release_buffer(msg.payload);
+      break;
     case ipc::IPCMessage::Type::COMMAND:
+    case ipc::IPCMessage::Type::COMMAND_BATCH:
       if (!waiting_sync_token_) {
-        handle_command(msg);
+        if (msg.type == ipc::IPCMessage::Type::COMMAND_BATCH)
+          handle_command_batch(msg);
+        else
+          handle_command(msg);
       } else {
+        // The server already committed any symbols this message interns and
+        // holds a promise and a credit for it; run it after SYNC_CONTINUE
         LOG_DEBUG(instrument_name_, "WORKER_MAIN",
-                  "Blocked on sync token={}, ignoring message",
-                  *waiting_sync_token_);
+                  "Blocked on sync token={}, deferring message id={}",
+                  *waiting_sync_token_, msg.id);
+        blocked_.push_back(std::move(msg));
       }
       break;
     default:
@@ -242,6 +316,11 @@ private:
                 "Received SYNC_CONTINUE for token={}, proceeding",
                 msg.sync_token);
       waiting_sync_token_.reset();
+      // Held messages arrived before anything still in deferred_
+      deferred_.insert(deferred_.begin(),
+                       std::make_move_iterator(blocked_.begin()),
+                       std::make_move_iterator(blocked_.end()));
+      blocked_.clear();
     } else {
       LOG_WARN(instrument_name_, "WORKER_MAIN",
                "Unexpected SYNC_CONTINUE token={} (waiting={})", msg.sync_token,
@@ -250,7 +329,126 @@ private:
   }
 
   void handle_command(const ipc::IPCMessage &msg) {
-    SerializedCommand cmd = deserialize_command_from_msg(msg);
+    SerializedCommand cmd;
+    try {
+      cmd = deserialize_command_from_msg(msg);
+    } catch (const std::exception &ex) {
+      LOG_ERROR(instrument_name_, std::to_string(msg.id),
+                "Failed to decode command: {}", ex.what());
+      // The server still holds a promise (and a credit) for this message
+      CommandResponse resp;
+      resp.instrument_name = instrument_name_;
+      resp.success = false;
+      resp.error_message = std::string("Malformed command: ") + ex.what();
+      send_command_response(msg, msg.sync_token, resp);
+      // Its barrier should not wait out the deadline for us
+      if (msg.sync_token)
+        send_sync_ack(msg, msg.sync_token);
+      return;
+    }
+
+    PluginResponse plugin_resp = run_command(cmd);
+    wait_shared_barrier(cmd);
+    send_command_response(msg, cmd.sync_token.value_or(0),
+                          from_plugin_response(plugin_resp));
+    finish_sync_command(msg, cmd);
+  }
+
+  void handle_command_batch(const ipc::IPCMessage &msg) {
+    std::vector<std::string> items;
+    try {
+      items = ipc::unpack_batch(msg.payload);
+    } catch (const std::exception &ex) {
+      LOG_ERROR(instrument_name_, std::to_string(msg.id),
+                "Failed to unpack command batch: {}", ex.what());
+      send_unreadable_batch(msg);
+      return;
+    }
+    if (items.empty()) {
+      send_unreadable_batch(msg);
+      return;
+    }
+    LOG_DEBUG(instrument_name_, std::to_string(msg.id),
+              "Received batch of {} commands (sync={})", items.size(),
+              msg.sync_token);
+
+    reply_binary_ = ipc::is_binary_payload(items.front());
+    std::vector<CommandResponse> responses;
+    responses.reserve(items.size());
+    SerializedCommand last;
+    bool decoded = true;
+    for (const auto &item : items) {
+      if (decoded) {
+        try {
+          last = reply_binary_ ? decoder_.decode_command(item)
+                               : ipc::deserialize_command(item);
+        } catch (const std::exception &ex) {
+          // Intern tables may now be out of step; fail the rest unexecuted
+          LOG_ERROR(instrument_name_, std::to_string(msg.id),
+                    "Failed to decode batched command: {}", ex.what());
+          decoded = false;
+        }
+      }
+      if (!decoded) {
+        CommandResponse resp;
+        resp.instrument_name = instrument_name_;
+        resp.success = false;
+        resp.error_message = "Malformed batched command";
+        responses.push_back(std::move(resp));
+        continue;
+      }
+      responses.push_back(from_plugin_response(run_command(last)));
+    }
+    if (decoded)
+      wait_shared_barrier(last);
+
+    ipc::IPCMessage resp_msg;
+    resp_msg.type = ipc::IPCMessage::Type::RESPONSE_BATCH;
+    resp_msg.id = msg.id;
+    resp_msg.sync_token = msg.sync_token;
+
+    std::vector<std::string> payloads;
+    payloads.reserve(responses.size());
+    if (reply_binary_) {
+      for (const auto &resp : responses)
+        payloads.push_back(encoder_.encode_response(resp));
+      resp_msg.payload = ipc::pack_batch(payloads);
+      if (ipc_queue_->send(resp_msg, IPC_SEND_TIMEOUT))
+        encoder_.commit();
+      else
+        encoder_.discard();
+    } else {
+      for (const auto &resp : responses)
+        payloads.push_back(ipc::serialize_response(resp));
+      resp_msg.payload = ipc::pack_batch(payloads);
+      ipc_queue_->send(resp_msg, IPC_SEND_TIMEOUT);
+    }
+
+    // One acknowledgement covers the whole batch. After a decode failure
+    // the errors are already in the responses; still ack so the barrier
+    // does not run into its deadline waiting for us
+    if (decoded) {
+      finish_sync_command(msg, last);
+    } else if (msg.sync_token) {
+      send_sync_ack(msg, msg.sync_token);
+    }
+  }
+
+  /// An empty RESPONSE_BATCH tells the server the batch could not be read;
+  /// it fails every command it numbered from msg.id
+  void send_unreadable_batch(const ipc::IPCMessage &msg) {
+    ipc::IPCMessage resp_msg;
+    resp_msg.type = ipc::IPCMessage::Type::RESPONSE_BATCH;
+    resp_msg.id = msg.id;
+    resp_msg.sync_token = msg.sync_token;
+    resp_msg.payload = ipc::pack_batch({});
+    ipc_queue_->send(resp_msg, IPC_SEND_TIMEOUT);
+
+    if (msg.sync_token)
+      send_sync_ack(msg, msg.sync_token);
+  }
+
+  PluginResponse run_command(const SerializedCommand &cmd) {
     LOG_DEBUG(instrument_name_, cmd.id, "Received command: {} (sync={})",
               cmd.verb, cmd.sync_token.value_or(0));
 
@@ -277,46 +475,92 @@ private:
     LOG_DEBUG(instrument_name_, cmd.id,
               "Command executed:  result={} success={}", exec_result,
               plugin_resp.success);
+    return plugin_resp;
+  }
 
-    send_command_response(msg, cmd, plugin_resp);
-
-    if (cmd.sync_token) {
-      send_sync_ack(msg, *cmd.sync_token);
-      // Only block the worker after the final command for this token
-      // (is_sync_barrier).
-      if (cmd.is_sync_barrier) {
-        waiting_sync_token_ = cmd.sync_token;
-        LOG_DEBUG(instrument_name_, cmd.id,
-                  "Now waiting for SYNC_CONTINUE token={}",
-                  *waiting_sync_token_);
-      } else {
-        LOG_DEBUG(instrument_name_, cmd.id,
-                  "Received sync command (token={}), not final; continuing",
-                  *cmd.sync_token);
-      }
+  /// Wait at the command's shared barrier, if it has one. Runs before the
+  /// response is sent: once the server holds every response of a block,
+  /// no worker is still using the slot and it can be armed again.
+  void wait_shared_barrier(const SerializedCommand &cmd) {
+    if (!cmd.barrier_slot)
+      return;
+    if (!barriers_) {
+      LOG_ERROR(instrument_name_, cmd.id,
+                "Command carries barrier slot {} but no barrier segment is "
+                "mapped",
+                *cmd.barrier_slot);
+      return;
+    }
+
+    using WaitResult = ipc::SharedBarrierTable::WaitResult;
+    WaitResult result = barriers_->arrive_and_wait(
+        {*cmd.barrier_slot, cmd.barrier_epoch}, cmd.timeout,
+        [this] { send_heartbeat_if_needed(); });
+    switch (result) {
+    case WaitResult::RELEASED:
+      LOG_DEBUG(instrument_name_, cmd.id,
+                "Passed shared barrier token={} slot={}",
+                cmd.sync_token.value_or(0), *cmd.barrier_slot);
+      break;
+    case WaitResult::TIMED_OUT:
+      LOG_WARN(instrument_name_, cmd.id,
+               "Shared barrier token={} timed out after {} ms; released the "
+               "other workers",
+               cmd.sync_token.value_or(0), cmd.timeout.count());
+      break;
+    case WaitResult::BROKEN:
+    case WaitResult::STALE:
+      LOG_WARN(instrument_name_, cmd.id,
+               "Shared barrier token={} was abandoned before all workers "
+               "arrived",
+               cmd.sync_token.value_or(0));
+      break;
     }
   }
 
-  SerializedCommand deserialize_command_from_msg(const ipc::IPCMessage &msg) {
-    std::string payload(msg.payload, msg.payload_size);
-    return ipc::deserialize_command(payload);
+  void finish_sync_command(const ipc::IPCMessage &msg,
+                           const SerializedCommand &cmd) {
+    // A shared barrier already synchronised the workers; nothing to ack
+    if (!cmd.sync_token || cmd.barrier_slot)
+      return;
+    send_sync_ack(msg, *cmd.sync_token);
+    // Only block the worker after the final command for this token
+    // (is_sync_barrier).
+    if (cmd.is_sync_barrier) {
+      waiting_sync_token_ = cmd.sync_token;
+      LOG_DEBUG(instrument_name_, cmd.id,
+                "Now waiting for SYNC_CONTINUE token={}", *waiting_sync_token_);
+    } else {
+      LOG_DEBUG(instrument_name_, cmd.id,
+                "Received sync command (token={}), not final; continuing",
+                *cmd.sync_token);
+    }
   }
 
-  void send_command_response(const ipc::IPCMessage &msg,
-                             const SerializedCommand &cmd,
-                             const PluginResponse &plugin_resp) {
-    CommandResponse resp = from_plugin_response(plugin_resp);
-    std::string resp_payload = ipc::serialize_response(resp);
+  SerializedCommand deserialize_command_from_msg(const ipc::IPCMessage &msg) {
+    // Reply in whichever codec the server chose for this channel
+    reply_binary_ = ipc::is_binary_payload(msg.payload);
+    return reply_binary_ ? decoder_.decode_command(msg.payload)
+                         : ipc::deserialize_command(msg.payload);
+  }
 
+  void send_command_response(const ipc::IPCMessage &msg, uint64_t sync_token,
+                             const CommandResponse &resp) {
     ipc::IPCMessage resp_msg;
     resp_msg.type = ipc::IPCMessage::Type::RESPONSE;
     resp_msg.id = msg.id;
-    resp_msg.sync_token = cmd.sync_token.value_or(0);
-    resp_msg.payload_size =
-        std::min(resp_payload.size(), sizeof(resp_msg.payload));
-    std::memcpy(resp_msg.payload, resp_payload.data(), resp_msg.payload_size);
-
-    ipc_queue_->send(resp_msg, IPC_SEND_TIMEOUT);
+    resp_msg.sync_token = sync_token;
+
+    if (reply_binary_) {
+      resp_msg.payload = encoder_.encode_response(resp);
+      if (ipc_queue_->send(resp_msg, IPC_SEND_TIMEOUT))
+        encoder_.commit();
+      else
+        encoder_.discard();
+    } else {
+      resp_msg.payload = ipc::serialize_response(resp);
+      ipc_queue_->send(resp_msg, IPC_SEND_TIMEOUT);
+    }
   }
 
   void send_sync_ack(const ipc::IPCMessage &msg, uint64_t sync_token) {
@@ -327,13 +571,21 @@ private:
     ack_msg.type = ipc::IPCMessage::Type::SYNC_ACK;
     ack_msg.id = msg.id;
     ack_msg.sync_token = sync_token;
-    ack_msg.payload_size = 0;
 
     ipc_queue_->send(ack_msg, IPC_SEND_TIMEOUT);
   }
 
   void cleanup() {
     plugin_.shutdown();
+    auto &buffers = ipc::DataBufferManager::instance();
+    buffers.set_reclaim_handler(nullptr);
+    auto pool = buffers.pool_stats();
+    LOG_INFO(instrument_name_, "WORKER_MAIN",
+             "Buffer pool: {} hits, {} misses, {} evicted", pool.hits,
+             pool.misses, pool.evicted);
+
+    // Unlink our segments; mappings the server still holds stay valid
+    buffers.clear_all();
     ipc_queue_.reset();
   }
 };
@@ -341,13 +593,29 @@ private:
 
 int main(int argc, char **argv) {
   if (argc < 3) {
-    std::cerr << "Usage: " << argv[0] << " <instrument_name> <plugin_path>\n";
+    std::cerr << "Usage: " << argv[0]
+              << " <instrument_name> <plugin_path> [--doorbell-fd=N]"
+                 " [--sync-segment=NAME]\n";
     return 1;
   }
 
   std::string instrument_name = argv[1];
   std::string plugin_path = argv[2];
 
+  // Passed by the server when it waits on its event reactor, and when it
+  // runs shared-memory sync barriers
+  int doorbell_fd = -1;
+  std::string sync_segment;
+  const std::string doorbell_flag = "--doorbell-fd=";
+  const std::string sync_segment_flag = "--sync-segment=";
+  for (int i = 3; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind(doorbell_flag, 0) == 0)
+      doorbell_fd = std::atoi(arg.c_str() + doorbell_flag.size());
+    else if (arg.rfind(sync_segment_flag, 0) == 0)
+      sync_segment = arg.substr(sync_segment_flag.size());
+  }
+
   // Setup logging for this worker
   std::string log_file = "worker_" + instrument_name + ".log";
   InstrumentLogger::instance().init(log_file, spdlog::level::debug);
@@ -358,7 +626,8 @@ int main(int argc, char **argv) {
   std::signal(SIGTERM, signal_handler);
 
   try {
-    return Instrument(instrument_name, plugin_path).run();
+    return Instrument(instrument_name, plugin_path, doorbell_fd, sync_segment)
+        .run();
   } catch (const std::exception &e) {
     LOG_ERROR(instrument_name, "WORKER_MAIN", "Fatal error: {}", e.what());
     return 1;
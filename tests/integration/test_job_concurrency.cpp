@@ -0,0 +1,191 @@
+#include "instrument-server/server/JobManager.hpp"
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <thread>
+
+using json = nlohmann::json;
+using instserver::server::JobInfo;
+using instserver::server::JobManager;
+
+// Wait for the job to finish and return its record
+static JobInfo wait_for_job(const std::string &job_id, int timeout_ms = 5000) {
+  auto start = std::chrono::steady_clock::now();
+  JobInfo info;
+  while (std::chrono::steady_clock::now() - start <
+         std::chrono::milliseconds(timeout_ms)) {
+    if (JobManager::instance().get_job_info(job_id, info) &&
+        (info.status == "completed" || info.status == "failed" ||
+         info.status == "canceled"))
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return info;
+}
+
+static std::string submit_sleep(int ms, const json &instruments = nullptr) {
+  json params = {{"duration_ms", ms}};
+  if (!instruments.is_null())
+    params["instruments"] = instruments;
+  return JobManager::instance().submit_job("sleep", params);
+}
+
+TEST(JobConcurrencyTest, DisjointInstrumentsRunConcurrently) {
+  auto a = submit_sleep(300, {"FRIDGE1_DAC"});
+  auto b = submit_sleep(300, {"FRIDGE2_DAC"});
+
+  auto ja = wait_for_job(a);
+  auto jb = wait_for_job(b);
+  ASSERT_EQ(ja.status, "completed");
+  ASSERT_EQ(jb.status, "completed");
+  EXPECT_FALSE(ja.exclusive);
+  EXPECT_LT(jb.started_at, ja.finished_at);
+  EXPECT_LT(ja.started_at, jb.finished_at);
+}
+
+TEST(JobConcurrencyTest, SharedInstrumentRunsInSubmissionOrder) {
+  auto a = submit_sleep(200, {"DAC1", "DMM1"});
+  auto b = submit_sleep(50, {"DMM1"});
+
+  auto ja = wait_for_job(a);
+  auto jb = wait_for_job(b);
+  ASSERT_EQ(ja.status, "completed");
+  ASSERT_EQ(jb.status, "completed");
+  EXPECT_GE(jb.started_at, ja.finished_at);
+}
+
+TEST(JobConcurrencyTest, UndeclaredJobRunsAlone) {
+  auto a = submit_sleep(200, {"DAC1"});
+  auto alone = submit_sleep(100);
+  // Disjoint from `a`, but queued behind the exclusive job
+  auto c = submit_sleep(50, {"DAC2"});
+
+  auto ja = wait_for_job(a);
+  auto jalone = wait_for_job(alone);
+  auto jc = wait_for_job(c);
+  ASSERT_EQ(jalone.status, "completed");
+  ASSERT_EQ(jc.status, "completed");
+  EXPECT_TRUE(jalone.exclusive);
+  EXPECT_GE(jalone.started_at, ja.finished_at);
+  EXPECT_GE(jc.started_at, jalone.finished_at);
+}
+
+static JobInfo find_listed(const std::string &job_id) {
+  for (auto &job : JobManager::instance().list_jobs()) {
+    if (job.id == job_id)
+      return job;
+  }
+  return {};
+}
+
+static std::string submit_on(const std::string &instrument, int ms,
+                             const std::string &priority) {
+  return JobManager::instance().submit_job(
+      "sleep", {{"duration_ms", ms},
+                {"instruments", {instrument}},
+                {"priority", priority}});
+}
+
+TEST(JobPriorityTest, InteractiveJobOvertakesQueuedBatchJobs) {
+  auto blocker = submit_sleep(150, {"PRIO_DMM"});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::vector<std::string> batch;
+  for (int i = 0; i < 3; ++i)
+    batch.push_back(submit_on("PRIO_DMM", 20, "batch"));
+  auto interactive = submit_on("PRIO_DMM", 20, "interactive");
+
+  wait_for_job(blocker);
+  auto ji = wait_for_job(interactive);
+  ASSERT_EQ(ji.status, "completed");
+  EXPECT_EQ(ji.priority, instserver::server::JobPriority::Interactive);
+  for (const auto &id : batch) {
+    auto jb = wait_for_job(id);
+    ASSERT_EQ(jb.status, "completed");
+    EXPECT_GE(jb.started_at, ji.finished_at);
+  }
+}
+
+TEST(JobPriorityTest, WeightedFairShareBetweenClasses) {
+  auto blocker = submit_sleep(200, {"SHARE_DMM"});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto b1 = submit_on("SHARE_DMM", 1, "batch");
+  auto b2 = submit_on("SHARE_DMM", 1, "batch");
+  std::vector<std::string> interactive;
+  for (int i = 0; i < 12; ++i)
+    interactive.push_back(submit_on("SHARE_DMM", 1, "interactive"));
+
+  size_t last = 0, before_b2 = 0;
+  auto p2 = find_listed(b2).queue_position;
+  for (const auto &id : interactive) {
+    auto pos = find_listed(id).queue_position;
+    EXPECT_GT(pos, last); // FIFO within a class
+    last = pos;
+    before_b2 += pos < p2;
+  }
+  auto p1 = find_listed(b1).queue_position;
+  EXPECT_LT(p1, p2);
+  // Batch is not starved, but interactive gets the larger share
+  EXPECT_LT(p1, last);
+  EXPECT_GE(before_b2, 8u);
+
+  for (const auto &id : interactive)
+    wait_for_job(id);
+  EXPECT_EQ(wait_for_job(b2).status, "completed");
+}
+
+TEST(JobPriorityTest, CancelAndReprioritizeQueuedJobs) {
+  auto &mgr = JobManager::instance();
+  auto blocker = submit_sleep(200, {"QUEUE_DMM"});
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  auto a = submit_on("QUEUE_DMM", 20, "batch");
+  auto b = submit_on("QUEUE_DMM", 20, "batch");
+  JobInfo ja, jb;
+  for (auto &job : mgr.list_jobs()) {
+    if (job.id == a)
+      ja = job;
+    if (job.id == b)
+      jb = job;
+  }
+  EXPECT_EQ(ja.queue_position, 1u);
+  EXPECT_EQ(jb.queue_position, 2u);
+  EXPECT_LE(ja.estimated_start, jb.estimated_start);
+
+  EXPECT_TRUE(mgr.reprioritize_job(
+      b, instserver::server::JobPriority::Interactive));
+  EXPECT_EQ(find_listed(b).queue_position, 1u);
+  EXPECT_EQ(find_listed(a).queue_position, 2u);
+  // Only queued jobs can be moved
+  EXPECT_FALSE(mgr.reprioritize_job(
+      blocker, instserver::server::JobPriority::Batch));
+
+  EXPECT_TRUE(mgr.cancel_job(a));
+  EXPECT_EQ(find_listed(b).queue_position, 1u);
+  EXPECT_EQ(wait_for_job(a).status, "canceled");
+  EXPECT_EQ(wait_for_job(b).status, "completed");
+}
+
+TEST(JobPriorityTest, JobStillQueuedAtDeadlineFails) {
+  auto blocker = submit_sleep(150, {"DEADLINE_DMM"});
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  auto deadline = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      (std::chrono::system_clock::now() +
+                       std::chrono::milliseconds(50))
+                          .time_since_epoch())
+                      .count();
+  auto late = JobManager::instance().submit_job(
+      "sleep", {{"duration_ms", 10},
+                {"instruments", {"DEADLINE_DMM"}},
+                {"deadline_ms", deadline}});
+
+  auto jl = wait_for_job(late);
+  EXPECT_EQ(jl.status, "failed");
+  EXPECT_NE(jl.error.find("deadline"), std::string::npos);
+  EXPECT_EQ(wait_for_job(blocker).status, "completed");
+}
+
+TEST(JobPriorityTest, RejectsUnknownPriority) {
+  EXPECT_THROW(JobManager::instance().submit_job(
+                   "sleep", {{"duration_ms", 10}, {"priority", "urgent"}}),
+               std::invalid_argument);
+}
@@ -1,89 +1,156 @@
+#include "PluginTestFixture.hpp"
 #include "instrument-server/server/InstrumentRegistry.hpp"
-#include "instrument-server/server/JobManager.hpp"
-#include "instrument-server/server/ServerDaemon.hpp"
+#include "instrument-server/server/RuntimeContext.hpp"
+#include "instrument-server/server/SyncCoordinator.hpp"
 #include <chrono>
-#include <fstream>
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
+#include <sol/sol.hpp>
 #include <thread>
 
 using json = nlohmann::json;
 using namespace instserver;
 
-static bool wait_for_job_complete(const std::string &job_id,
-                                  int timeout_ms = 5000) {
-  auto start = std::chrono::steady_clock::now();
-  while (true) {
-    instserver::server::JobInfo info;
-    if (instserver::server::JobManager::instance().get_job_info(job_id, info)) {
-      if (info.status == "completed" || info.status == "failed" ||
-          info.status == "canceled")
-        return info.status == "completed";
+// Enqueue-mode contexts only put the instruments a block uses behind its
+// barrier, and none at all behind a lone call or a one-instrument block
+class SyncBarrierScopeTest : public test::PluginTestFixture {
+protected:
+  void SetUp() override {
+    PluginTestFixture::SetUp();
+    if (plugin::PluginRegistry::instance().get_plugin_path("VISA").empty())
+      GTEST_SKIP() << "Mock VISA plugin not available";
+
+    json api_def = {{"protocol", {{"type", "VISA"}}},
+                    {"commands",
+                     {{"MEASURE",
+                       {{"parameters", json::array()},
+                        {"outputs", {"current"}}}}}}};
+    auto &registry = InstrumentRegistry::instance();
+    for (const auto &name : INSTRUMENTS) {
+      json config = {{"name", name},
+                     {"connection",
+                      {{"type", "VISA"}, {"address", "mock://" + name}}}};
+      ASSERT_TRUE(registry.create_instrument_from_json(name, config.dump(),
+                                                       api_def.dump()));
+    }
+
+    lua_.open_libraries(sol::lib::base);
+    bind_runtime_context(lua_, registry, registry.sync_coordinator(), true);
+    ctx_ = std::make_unique<RuntimeContext>(
+        registry, registry.sync_coordinator(), true);
+    lua_["context"] = ctx_.get();
+    SyncCoordinator::reset_arrival_stats();
+  }
+
+  void TearDown() override {
+    ctx_.reset();
+    for (const auto &name : INSTRUMENTS)
+      InstrumentRegistry::instance().remove_instrument(name);
+  }
+
+  static SyncCoordinator &sync() {
+    return InstrumentRegistry::instance().sync_coordinator();
+  }
+
+  // Park the instrument's worker on `token` (one participant never acks),
+  // so it holds whatever it is sent next
+  static void hold(const std::string &instrument, uint64_t token) {
+    sync().register_barrier(token, {instrument, "AbsentScope"});
+    SerializedCommand cmd;
+    cmd.instrument_name = instrument;
+    cmd.verb = "MEASURE";
+    cmd.expects_response = true;
+    cmd.sync_token = token;
+    cmd.is_sync_barrier = true;
+    auto proxy = InstrumentRegistry::instance().get_instrument(instrument);
+    ASSERT_TRUE(
+        proxy->execute_sync(std::move(cmd), std::chrono::seconds(5)).success);
+  }
+
+  static void release(const std::string &instrument, uint64_t token) {
+    InstrumentRegistry::instance()
+        .get_instrument(instrument)
+        ->send_sync_continue(token);
+    sync().clear_barrier(token);
+  }
+
+  static uint64_t arrivals(const std::string &instrument) {
+    for (const auto &stats : SyncCoordinator::arrival_stats()) {
+      if (stats.instrument == instrument)
+        return stats.arrivals;
     }
-    if (std::chrono::steady_clock::now() - start >
-        std::chrono::milliseconds(timeout_ms))
-      return false;
-    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return 0;
+  }
+
+  static uint64_t commands_sent(const std::string &instrument) {
+    auto proxy = InstrumentRegistry::instance().get_instrument(instrument);
+    return proxy ? proxy->get_stats().commands_sent : 0;
   }
+
+  const std::vector<std::string> INSTRUMENTS = {"ScopeA", "ScopeB",
+                                                "ScopeIdle"};
+  sol::state lua_;
+  std::unique_ptr<RuntimeContext> ctx_;
+};
+
+TEST_F(SyncBarrierScopeTest, LoneCallRegistersNoBarrier) {
+  lua_.script(R"(context:call("ScopeA.MEASURE"))");
+  EXPECT_EQ(sync().active_barrier_count(), 0u);
+  ctx_->process_tokens_and_wait();
+
+  ASSERT_EQ(ctx_->get_results().size(), 1u);
+  EXPECT_TRUE(ctx_->get_results()[0].success);
+  EXPECT_EQ(commands_sent("ScopeA"), 1u);
+  EXPECT_EQ(arrivals("ScopeA"), 0u);
 }
 
-TEST(SyncBarrierTest, UnusedInstrumentsReceiveBarrierNOP) {
-  // Start daemon (if not running)
-  auto &daemon = ServerDaemon::instance();
-  daemon.set_rpc_port(0); // not used
-  ASSERT_TRUE(daemon.start());
-
-  auto &registry = InstrumentRegistry::instance();
-
-  // Create two mock instruments via test data config files
-  std::filesystem::path cfg1 = std::filesystem::current_path() / "tests" /
-                               "data" / "mock_instrument1.yaml";
-  std::filesystem::path cfg2 = std::filesystem::current_path() / "tests" /
-                               "data" / "mock_instrument2.yaml";
-
-  ASSERT_TRUE(std::filesystem::exists(cfg1));
-  ASSERT_TRUE(std::filesystem::exists(cfg2));
-
-  ASSERT_TRUE(registry.create_instrument(cfg1.string()));
-  ASSERT_TRUE(registry.create_instrument(cfg2.string()));
-
-  // Prepare a tiny measurement script that only calls instrument1 in a parallel
-  // block
-  std::string script_path =
-      (std::filesystem::current_path() / "tests" / "tmp_measure_only_inst1.lua")
-          .string();
-  {
-    std::ofstream f(script_path);
-    f << "context:parallel(function()\n";
-    f << "  context:call(\"MockInstrument1.MEASURE\")\n";
-    f << "end)\n";
+TEST_F(SyncBarrierScopeTest, SingleInstrumentBlockRegistersNoBarrier) {
+  lua_.script(R"(
+    context:parallel(function()
+      context:call("ScopeA.MEASURE")
+      context:call("ScopeA.MEASURE")
+    end)
+  )");
+  EXPECT_EQ(sync().active_barrier_count(), 0u);
+  ctx_->process_tokens_and_wait();
+
+  ASSERT_EQ(ctx_->get_results().size(), 2u);
+  EXPECT_EQ(commands_sent("ScopeA"), 2u);
+  EXPECT_EQ(arrivals("ScopeA"), 0u);
+}
+
+TEST_F(SyncBarrierScopeTest, BarrierCoversExactlyTheBlocksInstruments) {
+  // With ScopeB parked the block's barrier cannot complete, so its pending
+  // set can be read once ScopeA has acked
+  constexpr uint64_t HOLD_TOKEN = 900001;
+  hold("ScopeB", HOLD_TOKEN);
+  uint64_t token = sync().next_token() + 1; // The block takes the next one
+
+  lua_.script(R"(
+    context:parallel(function()
+      context:call("ScopeA.MEASURE")
+      context:call("ScopeB.MEASURE")
+    end)
+  )");
+
+  std::vector<std::string> waiting;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    waiting = sync().get_waiting_instruments(token);
+    if (waiting == std::vector<std::string>{"ScopeB"})
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
   }
+  EXPECT_EQ(waiting, std::vector<std::string>{"ScopeB"});
+  EXPECT_EQ(arrivals("ScopeA"), 1u);
+
+  release("ScopeB", HOLD_TOKEN);
+  ctx_->process_tokens_and_wait();
+  ASSERT_EQ(ctx_->get_results().size(), 2u);
+  for (const auto &result : ctx_->get_results())
+    EXPECT_TRUE(result.success) << result.error_message;
 
-  // Submit measure job (enqueue-first)
-  json params;
-  params["script_path"] = script_path;
-  std::string job_id =
-      instserver::server::JobManager::instance().submit_measure(script_path,
-                                                                params);
-  ASSERT_FALSE(job_id.empty());
-
-  // Wait for completion
-  ASSERT_TRUE(wait_for_job_complete(job_id, 10000));
-
-  // After job completion, both instruments should have recorded commands_sent >
-  // 0
-  auto p1 = registry.get_instrument("MockInstrument1");
-  auto p2 = registry.get_instrument("MockInstrument2");
-  ASSERT_NE(p1, nullptr);
-  ASSERT_NE(p2, nullptr);
-
-  auto s1 = p1->get_stats();
-  auto s2 = p2->get_stats();
-
-  EXPECT_GT(s1.commands_sent, 0u);
-  EXPECT_GT(s2.commands_sent, 0u);
-
-  // Cleanup
-  registry.remove_instrument("MockInstrument1");
-  registry.remove_instrument("MockInstrument2");
+  // The idle instrument is neither in the barrier nor sent a NOP
+  EXPECT_EQ(arrivals("ScopeIdle"), 0u);
+  EXPECT_EQ(commands_sent("ScopeIdle"), 0u);
 }
@@ -2,6 +2,8 @@
 #include "instrument-server/ipc/DataBufferManager.hpp"
 #include "instrument-server/plugin/PluginInterface.h"
 #include "instrument-server/plugin/PluginLoader.hpp"
+#include "instrument-server/plugin/PluginRegistry.hpp"
+#include "instrument-server/server/InstrumentRegistry.hpp"
 
 // CRITICAL: Define this BEFORE including <cmath> to get M_PI on Windows
 #define _USE_MATH_DEFINES
@@ -14,9 +16,20 @@
 
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <process.h>
+#define getpid _getpid
+#define setenv(name, value, overwrite) _putenv_s(name, value)
+#define unsetenv(name) _putenv_s(name, "")
+#else
+#include <unistd.h>
+#endif
 
 using namespace instserver;
 using namespace instserver::test;
+using json = nlohmann::json;
 
 class VISALargeDataTest : public ::testing::Test {
 protected:
@@ -234,3 +247,244 @@ TEST_F(VISALargeDataTest, MultipleBuffers) {
     manager.release_buffer(id);
   }
 }
+
+// The plugin runs in a worker process, so its buffers cross the IPC channel
+// and the server maps them on its side
+class VISALargeDataWorkerTest : public VISALargeDataTest {
+protected:
+  void SetUp() override {
+    VISALargeDataTest::SetUp();
+    if (IsSkipped())
+      return;
+    plugin::PluginRegistry::instance().load_plugin("VISALargeData",
+                                                   plugin_path_.string());
+  }
+
+  void TearDown() override {
+    InstrumentRegistry::instance().remove_instrument("WorkerScope");
+    VISALargeDataTest::TearDown();
+  }
+
+  std::shared_ptr<InstrumentWorkerProxy>
+  start_scope(const json &ipc = json::object()) {
+    json config = {{"name", "WorkerScope"},
+                   {"connection",
+                    {{"type", "VISALargeData"}, {"address", "mock://test"}}},
+                   {"ipc", ipc}};
+    json api_def = {{"protocol", {{"type", "VISALargeData"}}},
+                    {"commands",
+                     {{"GET_LARGE_DATA",
+                       {{"parameters", json::array()},
+                        {"outputs", {"waveform"}}}}}}};
+    auto &registry = InstrumentRegistry::instance();
+    if (!registry.create_instrument_from_json("WorkerScope", config.dump(),
+                                              api_def.dump()))
+      return nullptr;
+    return registry.get_instrument("WorkerScope");
+  }
+
+  static CommandResponse fetch(InstrumentWorkerProxy &proxy, int index) {
+    SerializedCommand cmd;
+    cmd.id = "fetch_" + std::to_string(index);
+    cmd.instrument_name = "WorkerScope";
+    cmd.verb = "GET_LARGE_DATA";
+    cmd.expects_response = true;
+    return proxy.execute_sync(std::move(cmd), std::chrono::seconds(10));
+  }
+};
+
+TEST_F(VISALargeDataWorkerTest, ResponseHoldsBufferUntilDropped) {
+  auto proxy = start_scope();
+  ASSERT_NE(proxy, nullptr);
+  auto &manager = ipc::DataBufferManager::instance();
+
+  {
+    CommandResponse resp = fetch(*proxy, 0);
+    ASSERT_TRUE(resp.success) << resp.error_message;
+    ASSERT_TRUE(resp.has_large_data);
+    EXPECT_GE(manager.budget_stats().resident_bytes, 10000 * sizeof(float));
+
+    // Copies share the one reference
+    CommandResponse copy = resp;
+    resp = CommandResponse{};
+    EXPECT_NE(manager.get_metadata(copy.buffer_id), std::nullopt);
+  }
+
+  // Last copy gone: unmapped here and handed back to the worker
+  EXPECT_EQ(manager.budget_stats().resident_bytes, 0u);
+  EXPECT_TRUE(manager.list_buffers().empty());
+}
+
+TEST_F(VISALargeDataWorkerTest, CommandsWhileBlockedOnSyncStillDecode) {
+  auto proxy = start_scope();
+  ASSERT_NE(proxy, nullptr);
+
+  // A second participant that never acks keeps the barrier open
+  constexpr uint64_t TOKEN = 7001;
+  auto &sync = InstrumentRegistry::instance().sync_coordinator();
+  sync.register_barrier(TOKEN, {"WorkerScope", "AbsentScope"});
+
+  SerializedCommand barrier_cmd;
+  barrier_cmd.instrument_name = "WorkerScope";
+  barrier_cmd.verb = "GET_SMALL_DATA";
+  barrier_cmd.expects_response = true;
+  barrier_cmd.sync_token = TOKEN;
+  barrier_cmd.is_sync_barrier = true;
+  auto barrier_resp =
+      proxy->execute_sync(std::move(barrier_cmd), std::chrono::seconds(5));
+  ASSERT_TRUE(barrier_resp.success) << barrier_resp.error_message;
+
+  // First use of this verb interns it while the worker waits on the token
+  SerializedCommand blocked_cmd;
+  blocked_cmd.instrument_name = "WorkerScope";
+  blocked_cmd.verb = "GET_LARGE_DATA";
+  blocked_cmd.expects_response = true;
+  auto blocked = proxy->execute(std::move(blocked_cmd));
+  EXPECT_EQ(blocked.wait_for(std::chrono::milliseconds(200)),
+            std::future_status::timeout);
+
+  proxy->send_sync_continue(TOKEN);
+  ASSERT_EQ(blocked.wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  auto blocked_resp = blocked.get();
+  EXPECT_TRUE(blocked_resp.success) << blocked_resp.error_message;
+
+  // Later messages refer to the verb by its interned ID only
+  for (int i = 0; i < 3; ++i) {
+    auto resp = fetch(*proxy, i);
+    EXPECT_TRUE(resp.success) << "fetch " << i << ": " << resp.error_message;
+  }
+  sync.clear_barrier(TOKEN);
+}
+
+TEST_F(VISALargeDataWorkerTest, CommandsHeldOnSyncKeepTheirCredits) {
+  auto proxy = start_scope({{"window", 3}});
+  ASSERT_NE(proxy, nullptr);
+
+  constexpr uint64_t TOKEN = 7002;
+  auto &sync = InstrumentRegistry::instance().sync_coordinator();
+  sync.register_barrier(TOKEN, {"WorkerScope", "AbsentScope"});
+
+  SerializedCommand barrier_cmd;
+  barrier_cmd.instrument_name = "WorkerScope";
+  barrier_cmd.verb = "GET_SMALL_DATA";
+  barrier_cmd.expects_response = true;
+  barrier_cmd.sync_token = TOKEN;
+  barrier_cmd.is_sync_barrier = true;
+  ASSERT_TRUE(
+      proxy->execute_sync(std::move(barrier_cmd), std::chrono::seconds(5))
+          .success);
+
+  // Held by the blocked worker, so the window fills up
+  std::vector<std::future<CommandResponse>> held;
+  for (int i = 0; i < 3; ++i) {
+    SerializedCommand cmd;
+    cmd.instrument_name = "WorkerScope";
+    cmd.verb = "GET_SMALL_DATA";
+    cmd.expects_response = true;
+    held.push_back(proxy->execute(std::move(cmd)));
+  }
+  SerializedCommand extra;
+  extra.instrument_name = "WorkerScope";
+  extra.verb = "GET_SMALL_DATA";
+  EXPECT_FALSE(proxy->try_execute(extra).has_value());
+  EXPECT_EQ(proxy->get_stats().in_flight, 3u);
+
+  // Released: every held command is answered and hands its credit back
+  proxy->send_sync_continue(TOKEN);
+  for (auto &future : held) {
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    EXPECT_TRUE(future.get().success);
+  }
+  EXPECT_EQ(proxy->get_stats().in_flight, 0u);
+  for (int i = 0; i < 5; ++i) {
+    auto resp = fetch(*proxy, i);
+    EXPECT_TRUE(resp.success) << "fetch " << i << ": " << resp.error_message;
+  }
+  sync.clear_barrier(TOKEN);
+}
+
+TEST_F(VISALargeDataWorkerTest, SyncTimeoutReturnsItsCredit) {
+  auto proxy = start_scope({{"window", 1}});
+  ASSERT_NE(proxy, nullptr);
+
+  constexpr uint64_t TOKEN = 7003;
+  auto &sync = InstrumentRegistry::instance().sync_coordinator();
+  sync.register_barrier(TOKEN, {"WorkerScope", "AbsentScope"});
+
+  SerializedCommand barrier_cmd;
+  barrier_cmd.instrument_name = "WorkerScope";
+  barrier_cmd.verb = "GET_SMALL_DATA";
+  barrier_cmd.expects_response = true;
+  barrier_cmd.sync_token = TOKEN;
+  barrier_cmd.is_sync_barrier = true;
+  ASSERT_TRUE(
+      proxy->execute_sync(std::move(barrier_cmd), std::chrono::seconds(5))
+          .success);
+
+  // The blocked worker holds each command past the caller's timeout; giving
+  // up on it frees the single credit for the next one
+  for (int i = 0; i < 2; ++i) {
+    SerializedCommand cmd;
+    cmd.instrument_name = "WorkerScope";
+    cmd.verb = "GET_SMALL_DATA";
+    cmd.expects_response = true;
+    cmd.timeout = std::chrono::milliseconds(200);
+    auto resp =
+        proxy->execute_sync(std::move(cmd), std::chrono::milliseconds(200));
+    EXPECT_FALSE(resp.success);
+    EXPECT_EQ(resp.error_message, "Command timeout");
+    EXPECT_EQ(proxy->get_stats().in_flight, 0u);
+  }
+
+  // The late answers are dropped without touching the window
+  proxy->send_sync_continue(TOKEN);
+  for (int i = 0; i < 3; ++i) {
+    auto resp = fetch(*proxy, i);
+    EXPECT_TRUE(resp.success) << "fetch " << i << ": " << resp.error_message;
+    EXPECT_EQ(proxy->get_stats().in_flight, 0u);
+  }
+  EXPECT_EQ(proxy->get_stats().window_rejections, 0u);
+  sync.clear_barrier(TOKEN);
+}
+
+TEST_F(VISALargeDataWorkerTest, StreamsPastEqualBudgets) {
+  // Server and worker both get 1 MB; the script holds every result
+  constexpr int FETCHES = 60; // 40 KB each, 2.4 MB in total
+  auto spill_dir = std::filesystem::temp_directory_path() /
+                   ("large_data_spill_" + std::to_string(getpid()));
+  auto &manager = ipc::DataBufferManager::instance();
+  manager.set_spill_directory(spill_dir.string());
+  manager.set_memory_budget(1024 * 1024);
+  setenv("INSTRUMENT_SCRIPT_SERVER_BUFFER_BUDGET_MB", "1", 1);
+  setenv("INSTRUMENT_SCRIPT_SERVER_BUFFER_WAIT_MS", "2000", 1);
+  auto proxy = start_scope();
+  unsetenv("INSTRUMENT_SCRIPT_SERVER_BUFFER_BUDGET_MB");
+  unsetenv("INSTRUMENT_SCRIPT_SERVER_BUFFER_WAIT_MS");
+  ASSERT_NE(proxy, nullptr);
+
+  std::vector<CommandResponse> held;
+  for (int i = 0; i < FETCHES; ++i) {
+    held.push_back(fetch(*proxy, i));
+    ASSERT_TRUE(held.back().success)
+        << "fetch " << i << ": " << held.back().error_message;
+  }
+
+  auto stats = manager.budget_stats();
+  EXPECT_GT(stats.spills, 0u);
+  EXPECT_LE(stats.resident_bytes, 1024u * 1024);
+
+  // Spilled results still read back
+  auto first = manager.get_buffer(held.front().buffer_id);
+  ASSERT_NE(first, nullptr);
+  EXPECT_NEAR(first->as_float32()[25], 1.0f, 0.01f);
+  first.reset();
+  manager.release_buffer(held.front().buffer_id);
+
+  held.clear();
+  EXPECT_EQ(manager.budget_stats().resident_bytes, 0u);
+  EXPECT_EQ(manager.budget_stats().spilled_bytes, 0u);
+  manager.set_memory_budget(0);
+  std::filesystem::remove_all(spill_dir);
+}
@@ -0,0 +1,112 @@
+#include "TimestampLog.hpp"
+#include "instrument-server/plugin/PluginInterface.h"
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Mock plugin that timestamps every command into a shared-memory log, for
+// measuring how far apart instruments start after a barrier
+
+using namespace instserver::test;
+
+static std::unique_ptr<boost::interprocess::mapped_region> g_region;
+static TimestampLog *g_log = nullptr;
+static char g_instrument[TIMESTAMP_NAME_LEN] = {};
+
+extern "C" {
+
+PluginMetadata plugin_get_metadata(void) {
+  PluginMetadata meta = {};
+  meta.api_version = INSTRUMENT_PLUGIN_API_VERSION;
+  strncpy(meta.name, "Mock Timestamp Plugin", PLUGIN_MAX_STRING_LEN - 1);
+  strncpy(meta.version, "1.0.0", PLUGIN_MAX_STRING_LEN - 1);
+  strncpy(meta.protocol_type, "MockTimestamp", PLUGIN_MAX_STRING_LEN - 1);
+  strncpy(meta.description,
+          "Records CLOCK_MONOTONIC_RAW at command start in shared memory",
+          PLUGIN_MAX_STRING_LEN - 1);
+  return meta;
+}
+
+int32_t plugin_initialize(const PluginConfig *config) {
+  using namespace boost::interprocess;
+  strncpy(g_instrument, config->instrument_name, TIMESTAMP_NAME_LEN - 1);
+
+  const char *segment = std::getenv(TIMESTAMP_SEGMENT_ENV);
+  if (!segment)
+    return -1;
+  try {
+    shared_memory_object shm(open_only, segment, read_write);
+    g_region = std::make_unique<mapped_region>(shm, read_write);
+  } catch (const interprocess_exception &) {
+    return -1;
+  }
+  if (g_region->get_size() < sizeof(TimestampLog))
+    return -1;
+
+  g_log = static_cast<TimestampLog *>(g_region->get_address());
+  return g_log->magic == TIMESTAMP_LOG_MAGIC ? 0 : -1;
+}
+
+int32_t plugin_execute_command(const PluginCommand *command,
+                               PluginResponse *response) {
+  // Taken first so nothing below adds to the measured start
+  uint64_t start = timestamp_now_ns();
+
+  strncpy(response->command_id, command->id, PLUGIN_MAX_STRING_LEN - 1);
+  strncpy(response->instrument_name, command->instrument_name,
+          PLUGIN_MAX_STRING_LEN - 1);
+
+  TimestampKind kind;
+  if (strcmp(command->verb, "ARM") == 0) {
+    kind = TimestampKind::ARM;
+  } else if (strcmp(command->verb, "TRIGGER") == 0) {
+    kind = TimestampKind::TRIGGER;
+  } else {
+    response->success = false;
+    strncpy(response->error_message, "Unknown command",
+            PLUGIN_MAX_STRING_LEN - 1);
+    return -1;
+  }
+
+  uint32_t round = 0;
+  for (uint32_t i = 0; i < command->param_count; i++) {
+    if (strcmp(command->params[i].name, "arg0") == 0) {
+      const auto &value = command->params[i].value;
+      if (value.type == PARAM_TYPE_INT64)
+        round = static_cast<uint32_t>(value.value.i64_val);
+      else if (value.type == PARAM_TYPE_DOUBLE)
+        round = static_cast<uint32_t>(value.value.d_val);
+      break;
+    }
+  }
+
+  uint32_t slot = g_log->count.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= TIMESTAMP_LOG_CAPACITY) {
+    response->success = false;
+    strncpy(response->error_message, "Timestamp log full",
+            PLUGIN_MAX_STRING_LEN - 1);
+    return -1;
+  }
+
+  TimestampRecord &record = g_log->records[slot];
+  record.start_ns = start;
+  record.round = round;
+  record.kind = static_cast<uint32_t>(kind);
+  memcpy(record.instrument, g_instrument, TIMESTAMP_NAME_LEN);
+  record.end_ns = timestamp_now_ns();
+
+  response->success = true;
+  strncpy(response->text_response, "OK", PLUGIN_MAX_PAYLOAD - 1);
+  return 0;
+}
+
+void plugin_shutdown(void) {
+  g_log = nullptr;
+  g_region.reset();
+}
+
+} // extern "C"
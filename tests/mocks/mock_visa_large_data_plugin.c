@@ -58,13 +58,17 @@ int32_t plugin_execute_command(const PluginCommand *cmd, PluginResponse *resp) {
 
   // Large data response
   if (strcmp(cmd->verb, "GET_LARGE_DATA") == 0) {
-    // Generate a large sine wave dataset
+    // Generate a large sine wave dataset straight into the shared buffer,
+    // as a real plugin would viRead() into it
     const size_t num_points = 10000;
-    float *waveform = (float *)malloc(num_points * sizeof(float));
+    char buffer_id[PLUGIN_MAX_STRING_LEN];
+    float *waveform = NULL;
 
-    if (!waveform) {
+    if (data_buffer_acquire(cmd->instrument_name, cmd->id,
+                            0, // FLOAT32
+                            num_points, (void **)&waveform, buffer_id) != 0) {
       resp->success = false;
-      strncpy(resp->error_message, "Failed to allocate waveform data",
+      strncpy(resp->error_message, "Failed to create data buffer",
               PLUGIN_MAX_STRING_LEN - 1);
       return -1;
     }
@@ -74,17 +78,10 @@ int32_t plugin_execute_command(const PluginCommand *cmd, PluginResponse *resp) {
       waveform[i] = (float)sin(2.0 * M_PI * i / 100.0);
     }
 
-    // Create buffer
-    char buffer_id[PLUGIN_MAX_STRING_LEN];
-    int result = data_buffer_create(cmd->instrument_name, cmd->id,
-                                    0, // FLOAT32
-                                    num_points, waveform, buffer_id);
-
-    free(waveform);
-
-    if (result != 0) {
+    if (data_buffer_commit(buffer_id) != 0) {
+      data_buffer_abort(buffer_id);
       resp->success = false;
-      strncpy(resp->error_message, "Failed to create data buffer",
+      strncpy(resp->error_message, "Failed to commit data buffer",
               PLUGIN_MAX_STRING_LEN - 1);
       return -1;
     }
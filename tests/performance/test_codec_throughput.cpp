@@ -0,0 +1,124 @@
+#include "instrument-server/SerializedCommand.hpp"
+#include "instrument-server/ipc/BinaryCodec.hpp"
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <vector>
+
+using namespace instserver;
+using namespace instserver::ipc;
+
+namespace {
+
+constexpr int ITERATIONS = 20000;
+
+template <typename Fn> double time_per_op_us(Fn &&fn) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    fn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() /
+         ITERATIONS;
+}
+
+SerializedCommand make_set_command() {
+  SerializedCommand cmd;
+  cmd.id = "DAC1-123456";
+  cmd.instrument_name = "DAC1";
+  cmd.verb = "SET_VOLTAGE";
+  cmd.params["channel"] = static_cast<int64_t>(3);
+  cmd.params["voltage"] = 0.125;
+  return cmd;
+}
+
+SerializedCommand make_get_command() {
+  SerializedCommand cmd;
+  cmd.id = "DMM1-123456";
+  cmd.instrument_name = "DMM1";
+  cmd.verb = "MEASURE_VOLTAGE";
+  cmd.expects_response = true;
+  cmd.sync_token = 77;
+  return cmd;
+}
+
+CommandResponse make_scalar_response() {
+  CommandResponse resp;
+  resp.command_id = "DMM1-123456";
+  resp.instrument_name = "DMM1";
+  resp.success = true;
+  resp.text_response = "0.12345";
+  resp.return_value = 0.12345;
+  return resp;
+}
+
+CommandResponse make_array_response() {
+  CommandResponse resp = make_scalar_response();
+  resp.return_value = std::vector<double>(256, 1.5);
+  return resp;
+}
+
+void report(const char *name, double json_us, double binary_us,
+            size_t json_bytes, size_t binary_bytes) {
+  std::cout << name << ": json " << json_us << " µs (" << json_bytes
+            << " B), binary " << binary_us << " µs (" << binary_bytes
+            << " B), speedup " << (json_us / binary_us) << "x\n";
+}
+
+} // namespace
+
+TEST(CodecPerformance, CommandRoundTrip) {
+  std::vector<std::pair<const char *, SerializedCommand>> cases = {
+      {"SET command", make_set_command()}, {"GET command", make_get_command()}};
+  for (const auto &entry : cases) {
+    const SerializedCommand &cmd = entry.second;
+    std::string json_payload = serialize_command(cmd);
+    double json_us = time_per_op_us([&]() {
+      auto out = deserialize_command(serialize_command(cmd));
+      ASSERT_EQ(out.verb, cmd.verb);
+    });
+
+    BinaryEncoder encoder;
+    BinaryDecoder decoder;
+    std::string binary_payload;
+    double binary_us = time_per_op_us([&]() {
+      binary_payload = encoder.encode_command(cmd);
+      encoder.commit();
+      auto out = decoder.decode_command(binary_payload);
+      ASSERT_EQ(out.verb, cmd.verb);
+    });
+
+    report(entry.first, json_us, binary_us, json_payload.size(),
+           binary_payload.size());
+    EXPECT_LT(binary_us, json_us);
+  }
+}
+
+TEST(CodecPerformance, ResponseRoundTrip) {
+  std::vector<std::pair<const char *, CommandResponse>> cases = {
+      {"scalar response", make_scalar_response()},
+      {"array response", make_array_response()}};
+  for (const auto &entry : cases) {
+    const CommandResponse &resp = entry.second;
+    std::string json_payload = serialize_response(resp);
+    double json_us = time_per_op_us([&]() {
+      auto out = deserialize_response(serialize_response(resp));
+      ASSERT_EQ(out.success, resp.success);
+    });
+
+    BinaryEncoder encoder;
+    BinaryDecoder decoder;
+    std::string binary_payload;
+    double binary_us = time_per_op_us([&]() {
+      binary_payload = encoder.encode_response(resp);
+      encoder.commit();
+      auto out = decoder.decode_response(binary_payload);
+      ASSERT_EQ(out.success, resp.success);
+    });
+
+    report(entry.first, json_us, binary_us, json_payload.size(),
+           binary_payload.size());
+    EXPECT_LT(binary_us, json_us);
+  }
+}
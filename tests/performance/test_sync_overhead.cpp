@@ -39,3 +39,36 @@ TEST(SyncPerformance, BarrierOverhead) {
   // Should be less than 100 µs per barrier
   EXPECT_LT(overhead_per_barrier, 100.0);
 }
+
+TEST(SyncPerformance, AckCostStaysFlatWithInstrumentCount) {
+  SyncCoordinator sync;
+
+  // Per-ACK cost with interned IDs, for a small and a large barrier
+  auto ack_cost = [&](int instruments_per_barrier) {
+    std::vector<uint32_t> ids;
+    for (int j = 0; j < instruments_per_barrier; j++) {
+      ids.push_back(
+          SyncCoordinator::intern_instrument("Inst" + std::to_string(j)));
+    }
+
+    const int num_iterations = 2000;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_iterations; i++) {
+      sync.register_barrier_ids(i, ids);
+      for (uint32_t id : ids)
+        sync.handle_ack(i, id);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           (num_iterations * instruments_per_barrier);
+  };
+
+  double small = ack_cost(10);
+  double large = ack_cost(120);
+  std::cout << "Per-ACK cost: " << small << " ns (10 instruments), " << large
+            << " ns (120 instruments)\n";
+
+  // Registration grows with the mask, but each ACK should not
+  EXPECT_LT(large, small * 3);
+  EXPECT_EQ(sync.active_barrier_count(), 0u);
+}
@@ -0,0 +1,219 @@
+#include "PlatformPaths.hpp"
+#include "TimestampLog.hpp"
+#include "instrument-server/ipc/SharedBarrier.hpp"
+#include "instrument-server/plugin/PluginRegistry.hpp"
+#include "instrument-server/server/InstrumentRegistry.hpp"
+#include "instrument-server/server/RuntimeContext.hpp"
+
+#include <algorithm>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <sol/sol.hpp>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <process.h>
+#define getpid _getpid
+#define setenv(name, value, overwrite) _putenv_s(name, value)
+#else
+#include <unistd.h>
+#endif
+
+using namespace instserver;
+using namespace instserver::test;
+using json = nlohmann::json;
+
+// How far apart instruments really start the first command after a parallel
+// block's barrier. Each round is one parallel() block of ARM commands, whose
+// barrier every instrument passes, then one of TRIGGER commands. The mock
+// plugin stamps CLOCK_MONOTONIC_RAW as each command enters it.
+//
+// Results are written as JSON to $INSTRUMENT_TEST_SKEW_REPORT (default
+// trigger_skew.json) so they can be tracked between releases. Run once with
+// INSTRUMENT_SCRIPT_SERVER_SHARED_BARRIERS=1 to measure shared barriers.
+
+namespace {
+
+constexpr int ROUNDS = 200;
+constexpr int INSTRUMENT_COUNTS[] = {2, 4, 8};
+
+double percentile(std::vector<double> values, double q) {
+  if (values.empty())
+    return 0.0;
+  std::sort(values.begin(), values.end());
+  size_t index = static_cast<size_t>(q * static_cast<double>(values.size()));
+  return values[std::min(index, values.size() - 1)];
+}
+
+json summarize(const std::vector<double> &values) {
+  return {{"p50", percentile(values, 0.50)},
+          {"p99", percentile(values, 0.99)},
+          {"max", values.empty() ? 0.0
+                                 : *std::max_element(values.begin(),
+                                                     values.end())},
+          {"samples", values.size()}};
+}
+
+std::string instrument_name(int index) {
+  return "SkewInst" + std::to_string(index);
+}
+
+} // namespace
+
+class TriggerSkewBenchmark : public ::testing::Test {
+protected:
+  void SetUp() override {
+    auto plugin_path = get_test_plugin_path("mock_timestamp_plugin");
+    if (!std::filesystem::exists(plugin_path)) {
+      GTEST_SKIP() << "mock_timestamp_plugin not built: " << plugin_path;
+    }
+
+    using namespace boost::interprocess;
+    segment_name_ = "instrument_test_timestamps_" +
+                    std::to_string(static_cast<long>(getpid()));
+    shared_memory_object::remove(segment_name_.c_str());
+    shared_memory_object shm(create_only, segment_name_.c_str(), read_write);
+    shm.truncate(static_cast<offset_t>(sizeof(TimestampLog)));
+    region_ = std::make_unique<mapped_region>(shm, read_write);
+    log_ = new (region_->get_address()) TimestampLog;
+    log_->count.store(0);
+    log_->magic = TIMESTAMP_LOG_MAGIC;
+
+    // Workers inherit the environment, so each plugin finds the log
+    setenv(TIMESTAMP_SEGMENT_ENV, segment_name_.c_str(), 1);
+    plugin::PluginRegistry::instance().load_plugin("MockTimestamp",
+                                                   plugin_path.string());
+  }
+
+  void TearDown() override {
+    InstrumentRegistry::instance().stop_all();
+    region_.reset();
+    if (!segment_name_.empty()) {
+      boost::interprocess::shared_memory_object::remove(
+          segment_name_.c_str());
+    }
+  }
+
+  bool start_instruments(int count) {
+    json api_def = {
+        {"protocol", {{"type", "MockTimestamp"}}},
+        {"commands",
+         {{"ARM", {{"parameters", json::array()}, {"outputs", {"status"}}}},
+          {"TRIGGER",
+           {{"parameters", json::array()}, {"outputs", {"status"}}}}}}};
+    auto &registry = InstrumentRegistry::instance();
+    for (int i = 0; i < count; ++i) {
+      json config = {{"name", instrument_name(i)},
+                     {"connection", {{"type", "MockTimestamp"}}}};
+      if (!registry.create_instrument_from_json(
+              instrument_name(i), config.dump(), api_def.dump()))
+        return false;
+    }
+    return true;
+  }
+
+  void stop_instruments(int count) {
+    for (int i = 0; i < count; ++i)
+      InstrumentRegistry::instance().remove_instrument(instrument_name(i));
+  }
+
+  std::string script(int count) const {
+    std::string block_arm, block_trigger;
+    for (int i = 0; i < count; ++i) {
+      block_arm += "    context:call('" + instrument_name(i) + ".ARM', r)\n";
+      block_trigger +=
+          "    context:call('" + instrument_name(i) + ".TRIGGER', r)\n";
+    }
+    return "for r = 1, " + std::to_string(ROUNDS) + " do\n" +
+           "  context:parallel(function()\n" + block_arm + "  end)\n" +
+           "  context:parallel(function()\n" + block_trigger + "  end)\n" +
+           "end\n";
+  }
+
+  std::string segment_name_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+  TimestampLog *log_{nullptr};
+};
+
+TEST_F(TriggerSkewBenchmark, StartSkewAfterParallelBarrier) {
+  json report;
+  report["benchmark"] = "trigger_skew";
+  report["clock"] = "CLOCK_MONOTONIC_RAW";
+  report["shared_barriers"] = ipc::SharedBarrierTable::server() != nullptr;
+  report["rounds"] = ROUNDS;
+  report["results"] = json::array();
+
+  std::cout << "\n=== Trigger Skew After Barrier ("
+            << (report["shared_barriers"].get<bool>() ? "shared memory"
+                                                      : "SYNC_CONTINUE")
+            << ") ===\n";
+
+  for (int count : INSTRUMENT_COUNTS) {
+    ASSERT_TRUE(start_instruments(count));
+    log_->count.store(0);
+
+    auto &registry = InstrumentRegistry::instance();
+    sol::state lua;
+    lua.open_libraries(sol::lib::base, sol::lib::math);
+    auto ctx =
+        bind_runtime_context(lua, registry, registry.sync_coordinator());
+    auto result = lua.safe_script(script(count));
+    ASSERT_TRUE(result.valid());
+
+    // Every response is in, so every record is complete
+    uint32_t records = std::min(log_->count.load(), TIMESTAMP_LOG_CAPACITY);
+    ASSERT_EQ(records, static_cast<uint32_t>(2 * count * ROUNDS));
+
+    // The barrier opens when the last instrument finishes ARM
+    std::map<uint32_t, uint64_t> barrier_open;
+    std::map<uint32_t, std::vector<uint64_t>> starts;
+    for (uint32_t i = 0; i < records; ++i) {
+      const auto &rec = log_->records[i];
+      if (rec.kind == static_cast<uint32_t>(TimestampKind::ARM)) {
+        auto &open = barrier_open[rec.round];
+        open = std::max(open, rec.end_ns);
+      } else {
+        starts[rec.round].push_back(rec.start_ns);
+      }
+    }
+
+    std::vector<double> skew_us, barrier_to_start_us;
+    for (const auto &[round, round_starts] : starts) {
+      auto [first, last] =
+          std::minmax_element(round_starts.begin(), round_starts.end());
+      skew_us.push_back(static_cast<double>(*last - *first) / 1000.0);
+      for (uint64_t start : round_starts) {
+        barrier_to_start_us.push_back(
+            static_cast<double>(start - barrier_open[round]) / 1000.0);
+      }
+    }
+
+    json entry = {{"instruments", count},
+                  {"start_skew_us", summarize(skew_us)},
+                  {"barrier_to_start_us", summarize(barrier_to_start_us)}};
+    report["results"].push_back(entry);
+
+    std::cout << count << " instruments: start skew p50="
+              << entry["start_skew_us"]["p50"] << " µs p99="
+              << entry["start_skew_us"]["p99"] << " µs max="
+              << entry["start_skew_us"]["max"]
+              << " µs; barrier-to-start p50="
+              << entry["barrier_to_start_us"]["p50"] << " µs p99="
+              << entry["barrier_to_start_us"]["p99"] << " µs\n";
+
+    // Generous bound; the numbers themselves are tracked via the report
+    EXPECT_LT(entry["start_skew_us"]["p50"].get<double>(), 50000.0);
+
+    stop_instruments(count);
+  }
+
+  const char *path = std::getenv("INSTRUMENT_TEST_SKEW_REPORT");
+  std::ofstream out(path ? path : "trigger_skew.json");
+  out << report.dump(2) << "\n";
+  EXPECT_TRUE(out.good());
+}
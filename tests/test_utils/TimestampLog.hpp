@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+namespace instserver {
+namespace test {
+
+/// Environment variable naming the shared-memory segment that
+/// mock_timestamp_plugin appends to. Workers inherit it from the server.
+constexpr const char *TIMESTAMP_SEGMENT_ENV =
+    "INSTRUMENT_TEST_TIMESTAMP_SEGMENT";
+
+constexpr uint32_t TIMESTAMP_LOG_MAGIC = 0x54534C47; // "GLST"
+constexpr uint32_t TIMESTAMP_LOG_CAPACITY = 1 << 16;
+constexpr size_t TIMESTAMP_NAME_LEN = 32;
+
+/// Verbs of mock_timestamp_plugin
+enum class TimestampKind : uint32_t {
+  ARM = 0,     // Work before a barrier
+  TRIGGER = 1, // First command after it
+};
+
+/// One command as seen by the plugin
+struct TimestampRecord {
+  uint64_t start_ns; // Entry to plugin_execute_command
+  uint64_t end_ns;   // Just before it returns
+  uint32_t round;    // arg0 of the command
+  uint32_t kind;     // TimestampKind
+  char instrument[TIMESTAMP_NAME_LEN];
+};
+
+/// Append-only log shared by the benchmark and every plugin instance. A
+/// record is complete once its command's response has reached the server.
+struct TimestampLog {
+  uint32_t magic;
+  std::atomic<uint32_t> count;
+  TimestampRecord records[TIMESTAMP_LOG_CAPACITY];
+};
+
+/// Clock every process reads the same way. CLOCK_MONOTONIC_RAW is not
+/// slewed by NTP, so short intervals between processes stay exact.
+inline uint64_t timestamp_now_ns() {
+#if defined(CLOCK_MONOTONIC_RAW)
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(ts.tv_nsec);
+#else
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+#endif
+}
+
+} // namespace test
+} // namespace instserver
@@ -2,9 +2,12 @@
 #include "instrument-server/Logger.hpp"
 #include "instrument-server/server/InstrumentRegistry.hpp"
 
+#include <chrono>
 #include <filesystem>
+#include <future>
 #include <gtest/gtest.h>
 #include <spdlog/common.h>
+#include <thread>
 
 using namespace instserver;
 
@@ -192,3 +195,136 @@ TEST_F(APILookupTest, IOOutputsStructure) {
   ASSERT_TRUE(set["outputs"].is_array());
   EXPECT_TRUE(set["outputs"].empty());
 }
+
+TEST_F(APILookupTest, CommandTableResolvesTypes) {
+  nlohmann::json api_def = {
+      {"io",
+       {{{"name", "voltage"}, {"type", "float"}},
+        {{"name", "current"}, {"type", "float"}}}},
+      {"channel_groups",
+       {{{"name", "analog"},
+         {"io_types", {{{"suffix", "waveform"}, {"type", "array"}}}}}}},
+      {"commands",
+       {{"SET",
+         {{"template", "SOUR:VOLT {voltage}"},
+          {"parameters", {{{"io", "voltage"}}}},
+          {"outputs", nlohmann::json::array()}}},
+        {"SET_RAW",
+         {{"template", "RAW {value}"},
+          {"parameters", {{{"name", "value"}, {"type", "int"}}}},
+          {"outputs", nlohmann::json::array()}}},
+        {"MEASURE",
+         {{"template", "MEAS:CURR?"},
+          {"parameters", nlohmann::json::array()},
+          {"outputs", {"current"}}}},
+        {"GET_DATA",
+         {{"template", "WAV:DATA? {analog}"},
+          {"channel_group", "analog"},
+          {"parameters", nlohmann::json::array()},
+          {"outputs", {"waveform"}}}}}}};
+
+  auto table = CommandTable::build("Table", api_def);
+  ASSERT_EQ(table->size(), 4u);
+  EXPECT_EQ(table->find("UNKNOWN"), nullptr);
+
+  const CommandSpec *set = table->find("SET");
+  ASSERT_NE(set, nullptr);
+  EXPECT_EQ(set->template_str, "SOUR:VOLT {voltage}");
+  EXPECT_FALSE(set->expects_response);
+  EXPECT_FALSE(set->return_type.has_value());
+  ASSERT_EQ(set->params.size(), 1u);
+  EXPECT_EQ(set->params[0].name, "voltage");
+  EXPECT_EQ(set->params[0].type, "float");
+
+  const CommandSpec *set_raw = table->find("SET_RAW");
+  ASSERT_NE(set_raw, nullptr);
+  ASSERT_EQ(set_raw->params.size(), 1u);
+  EXPECT_EQ(set_raw->params[0].name, "value");
+  EXPECT_EQ(set_raw->params[0].type, "int");
+
+  const CommandSpec *measure = table->find("MEASURE");
+  ASSERT_NE(measure, nullptr);
+  EXPECT_TRUE(measure->expects_response);
+  EXPECT_EQ(measure->output, "current");
+  EXPECT_EQ(measure->return_type, "float");
+
+  const CommandSpec *get_data = table->find("GET_DATA");
+  ASSERT_NE(get_data, nullptr);
+  EXPECT_EQ(get_data->channel_group, "analog");
+  EXPECT_EQ(get_data->return_type, "array");
+}
+
+TEST_F(APILookupTest, CommandTableFollowsInstrumentLifetime) {
+  auto config_path = test_data_dir_ / "mock_instrument1.yaml";
+
+  if (!std::filesystem::exists(config_path)) {
+    GTEST_SKIP() << "Config not found";
+  }
+
+  EXPECT_EQ(registry_->command_table("MockInstrument1"), nullptr);
+  ASSERT_TRUE(registry_->create_instrument(config_path.string()));
+
+  auto table = registry_->command_table("MockInstrument1");
+  ASSERT_NE(table, nullptr);
+  ASSERT_NE(table->find("MEASURE"), nullptr);
+  EXPECT_TRUE(table->find("MEASURE")->expects_response);
+
+  registry_->remove_instrument("MockInstrument1");
+  EXPECT_EQ(registry_->command_table("MockInstrument1"), nullptr);
+  EXPECT_FALSE(
+      registry_->command_expects_response("MockInstrument1", "MEASURE"));
+
+  // Tables already handed out stay valid
+  EXPECT_NE(table->find("MEASURE"), nullptr);
+}
+
+TEST_F(APILookupTest, LookupsDoNotWaitForStartingInstrument) {
+  auto config1 = test_data_dir_ / "mock_instrument1.yaml";
+  auto config2 = test_data_dir_ / "mock_instrument2.yaml";
+
+  if (!std::filesystem::exists(config1) || !std::filesystem::exists(config2)) {
+    GTEST_SKIP() << "Config not found";
+  }
+
+  ASSERT_TRUE(registry_->create_instrument(config1.string()));
+
+  // Worker startup takes hundreds of milliseconds
+  auto creating = std::async(std::launch::async, [&] {
+    return registry_->create_instrument(config2.string());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_NE(registry_->get_instrument("MockInstrument1"), nullptr);
+  EXPECT_TRUE(registry_->has_instrument("MockInstrument1"));
+  EXPECT_TRUE(
+      registry_->command_expects_response("MockInstrument1", "MEASURE"));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  bool still_starting = creating.wait_for(std::chrono::milliseconds(0)) !=
+                        std::future_status::ready;
+
+  ASSERT_TRUE(creating.get());
+  EXPECT_NE(registry_->get_instrument("MockInstrument2"), nullptr);
+  if (still_starting) {
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+  }
+}
+
+TEST_F(APILookupTest, DuplicateCreateFailsWhileStarting) {
+  auto config_path = test_data_dir_ / "mock_instrument1.yaml";
+
+  if (!std::filesystem::exists(config_path)) {
+    GTEST_SKIP() << "Config not found";
+  }
+
+  auto first = std::async(std::launch::async, [&] {
+    return registry_->create_instrument(config_path.string());
+  });
+  auto second = std::async(std::launch::async, [&] {
+    return registry_->create_instrument(config_path.string());
+  });
+
+  // Exactly one of them gets the name
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_EQ(registry_->list_instruments().size(), 1u);
+}
@@ -0,0 +1,191 @@
+#include "instrument-server/ipc/BinaryCodec.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace instserver;
+using namespace instserver::ipc;
+
+static SerializedCommand make_command() {
+  SerializedCommand cmd;
+  cmd.id = "DAC1-17";
+  cmd.instrument_name = "DAC1";
+  cmd.verb = "SET_VOLTAGE";
+  cmd.expects_response = true;
+  cmd.timeout = std::chrono::milliseconds(2500);
+  cmd.sync_token = 42;
+  cmd.params["channel"] = static_cast<int64_t>(-3);
+  cmd.params["voltage"] = 5.5;
+  cmd.params["label"] = std::string("Gate1");
+  cmd.params["enabled"] = false;
+  cmd.params["waveform"] = std::vector<double>{1.0, 2.5, -3.25};
+  return cmd;
+}
+
+TEST(BinaryCodec, CommandRoundTrip) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  std::string payload = encoder.encode_command(make_command());
+  encoder.commit();
+  EXPECT_TRUE(is_binary_payload(payload));
+
+  SerializedCommand cmd = decoder.decode_command(payload);
+  EXPECT_EQ(cmd.id, "DAC1-17");
+  EXPECT_EQ(cmd.instrument_name, "DAC1");
+  EXPECT_EQ(cmd.verb, "SET_VOLTAGE");
+  EXPECT_TRUE(cmd.expects_response);
+  EXPECT_EQ(cmd.timeout.count(), 2500);
+  ASSERT_TRUE(cmd.sync_token.has_value());
+  EXPECT_EQ(*cmd.sync_token, 42u);
+  ASSERT_EQ(cmd.params.size(), 5u);
+  EXPECT_EQ(std::get<int64_t>(cmd.params["channel"]), -3);
+  EXPECT_DOUBLE_EQ(std::get<double>(cmd.params["voltage"]), 5.5);
+  EXPECT_EQ(std::get<std::string>(cmd.params["label"]), "Gate1");
+  EXPECT_FALSE(std::get<bool>(cmd.params["enabled"]));
+  EXPECT_EQ(std::get<std::vector<double>>(cmd.params["waveform"]),
+            (std::vector<double>{1.0, 2.5, -3.25}));
+}
+
+TEST(BinaryCodec, CommandCarriesSharedBarrierTicket) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  SerializedCommand cmd = make_command();
+  EXPECT_FALSE(decoder.decode_command(encoder.encode_command(cmd))
+                   .barrier_slot.has_value());
+  encoder.commit();
+
+  cmd.barrier_slot = 17;
+  cmd.barrier_epoch = 123456;
+  SerializedCommand decoded =
+      decoder.decode_command(encoder.encode_command(cmd));
+  ASSERT_TRUE(decoded.barrier_slot.has_value());
+  EXPECT_EQ(*decoded.barrier_slot, 17u);
+  EXPECT_EQ(decoded.barrier_epoch, 123456u);
+  EXPECT_EQ(decoded.params.size(), 5u);
+}
+
+TEST(BinaryCodec, InternedStringsShrinkLaterMessages) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  std::string first = encoder.encode_command(make_command());
+  encoder.commit();
+  std::string second = encoder.encode_command(make_command());
+  encoder.commit();
+
+  EXPECT_LT(second.size(), first.size());
+  decoder.decode_command(first);
+  SerializedCommand cmd = decoder.decode_command(second);
+  EXPECT_EQ(cmd.verb, "SET_VOLTAGE");
+  EXPECT_EQ(std::get<std::string>(cmd.params["label"]), "Gate1");
+}
+
+TEST(BinaryCodec, DiscardKeepsTablesInStep) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  // Never delivered: its definitions must be resent next time
+  encoder.encode_command(make_command());
+  encoder.discard();
+  EXPECT_EQ(encoder.interned_count(), 0u);
+
+  std::string delivered = encoder.encode_command(make_command());
+  encoder.commit();
+  SerializedCommand cmd = decoder.decode_command(delivered);
+  EXPECT_EQ(cmd.instrument_name, "DAC1");
+}
+
+TEST(BinaryCodec, ResetStartsFreshTables) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  decoder.decode_command(encoder.encode_command(make_command()));
+  encoder.commit();
+
+  // Peer restarted: both sides drop their tables and resend definitions
+  encoder.reset();
+  EXPECT_EQ(encoder.interned_count(), 0u);
+  BinaryDecoder restarted;
+  std::string payload = encoder.encode_command(make_command());
+  encoder.commit();
+  SerializedCommand cmd = restarted.decode_command(payload);
+  EXPECT_EQ(cmd.verb, "SET_VOLTAGE");
+
+  decoder.reset();
+  cmd = decoder.decode_command(payload);
+  EXPECT_EQ(std::get<std::string>(cmd.params["label"]), "Gate1");
+}
+
+TEST(BinaryCodec, ResponseRoundTrip) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  CommandResponse resp;
+  resp.command_id = "SCOPE1-9";
+  resp.instrument_name = "SCOPE1";
+  resp.success = true;
+  resp.error_code = -7;
+  resp.text_response = "1.5";
+  resp.return_value = static_cast<int64_t>(1) << 40;
+  resp.has_large_data = true;
+  resp.buffer_id = "buffer_123";
+  resp.element_count = 100000;
+  resp.data_type = "float32";
+
+  CommandResponse out = decoder.decode_response(encoder.encode_response(resp));
+  EXPECT_EQ(out.command_id, "SCOPE1-9");
+  EXPECT_EQ(out.instrument_name, "SCOPE1");
+  EXPECT_TRUE(out.success);
+  EXPECT_EQ(out.error_code, -7);
+  EXPECT_EQ(out.text_response, "1.5");
+  EXPECT_EQ(std::get<int64_t>(*out.return_value), static_cast<int64_t>(1)
+                                                      << 40);
+  EXPECT_TRUE(out.has_large_data);
+  EXPECT_EQ(out.buffer_id, "buffer_123");
+  EXPECT_EQ(out.element_count, 100000u);
+  EXPECT_EQ(out.data_type, "float32");
+}
+
+TEST(BinaryCodec, RejectsMalformedPayload) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  std::string payload = encoder.encode_command(make_command());
+  EXPECT_THROW(decoder.decode_command(payload.substr(0, payload.size() / 2)),
+               std::runtime_error);
+  EXPECT_THROW(decoder.decode_response(payload), std::runtime_error);
+  EXPECT_FALSE(is_binary_payload("{\"id\":1}"));
+}
+
+TEST(BinaryCodec, BatchRoundTrip) {
+  BinaryEncoder encoder;
+  BinaryDecoder decoder;
+
+  // Later items reference symbols the first one defines; one commit
+  std::vector<std::string> items;
+  for (int i = 0; i < 3; ++i) {
+    SerializedCommand cmd = make_command();
+    cmd.id = "DAC1-" + std::to_string(i);
+    items.push_back(encoder.encode_command(cmd));
+  }
+  encoder.commit();
+  items.push_back(serialize_command(make_command()));
+
+  std::vector<std::string> out = unpack_batch(pack_batch(items));
+  ASSERT_EQ(out, items);
+  for (int i = 0; i < 3; ++i) {
+    SerializedCommand cmd = decoder.decode_command(out[i]);
+    EXPECT_EQ(cmd.id, "DAC1-" + std::to_string(i));
+    EXPECT_EQ(cmd.verb, "SET_VOLTAGE");
+  }
+  EXPECT_FALSE(is_binary_payload(out[3]));
+  EXPECT_TRUE(unpack_batch(pack_batch({})).empty());
+}
+
+TEST(BinaryCodec, RejectsMalformedBatch) {
+  std::string batch = pack_batch({"abc", "defg"});
+  EXPECT_THROW(unpack_batch(batch.substr(0, batch.size() - 1)),
+               std::runtime_error);
+  EXPECT_THROW(unpack_batch(batch + "x"), std::runtime_error);
+}
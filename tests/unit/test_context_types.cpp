@@ -0,0 +1,126 @@
+#include "instrument-server/server/ContextTypes.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace instserver;
+using json = nlohmann::json;
+
+static json dc_getset_payload() {
+  return {{"getters", {{{"id", "GPI1"}, {"channel", 1}}}},
+          {"setters", {{{"id", "API1"}, {"channel", 2}}, {{"id", "API2"}}}},
+          {"setVoltages", {{"API1:2", 0.25}, {"API2", -1}}},
+          {"sampleRate", 1e6},
+          {"numPoints", 100}};
+}
+
+static bool has_error_at(const std::vector<ContextTypeError> &errors,
+                         const std::string &path) {
+  for (const auto &e : errors) {
+    if (e.path == path)
+      return true;
+  }
+  return false;
+}
+
+TEST(ContextTypesTest, BuiltinTypesMatchLuaTypes) {
+  const auto &types = ContextTypes::builtin();
+  EXPECT_EQ(types.keys(), (std::vector<std::string>{"dc_getset", "waveform_1d",
+                                                    "waveform_2d"}));
+
+  const auto *dc = types.find("dc_getset");
+  ASSERT_NE(dc, nullptr);
+  EXPECT_EQ(dc->name, "RuntimeContext_DCGetSet");
+  EXPECT_EQ(dc->fields.size(), 5u);
+  EXPECT_EQ(types.find("waveform_2d")->fields.size(), 10u);
+  EXPECT_EQ(types.find("missing"), nullptr);
+}
+
+TEST(ContextTypesTest, AcceptsValidPayload) {
+  auto errors = ContextTypes::builtin().validate("dc_getset", dc_getset_payload());
+  EXPECT_TRUE(errors.empty()) << errors.front().path << ": "
+                              << errors.front().message;
+
+  json waveform = {
+      {"setters", json::array()},
+      {"bufferedGetters", {{{"id", "GPI1"}, {"channel", 1}}}},
+      {"bufferedSetters", {{{"id", "API1"}, {"channel", 1}}}},
+      {"setVoltageDomains", {{"API1:1", {{"min", -0.5}, {"max", 0.5}}}}},
+      {"sampleRate", 10000},
+      {"numPoints", 64},
+      {"numSteps", 21}};
+  EXPECT_TRUE(ContextTypes::builtin().validate("waveform_1d", waveform).empty());
+}
+
+TEST(ContextTypesTest, ReportsEachProblemWithItsPath) {
+  auto payload = dc_getset_payload();
+  payload.erase("sampleRate");
+  payload["numPoints"] = 1.5;
+  payload["setters"][1] = {{"id", "API2"}, {"chanel", 3}};
+  payload["setVoltages"]["API1:2"] = "high";
+  payload["extra"] = true;
+
+  auto errors = ContextTypes::builtin().validate("dc_getset", payload);
+  EXPECT_EQ(errors.size(), 5u);
+  EXPECT_TRUE(has_error_at(errors, "/sampleRate"));
+  EXPECT_TRUE(has_error_at(errors, "/numPoints"));
+  EXPECT_TRUE(has_error_at(errors, "/setters/1/chanel"));
+  EXPECT_TRUE(has_error_at(errors, "/setVoltages/API1:2"));
+  EXPECT_TRUE(has_error_at(errors, "/extra"));
+}
+
+TEST(ContextTypesTest, RejectsUnknownTypeAndNonObjectPayload) {
+  EXPECT_EQ(ContextTypes::builtin().validate("sweep", json::object()).size(),
+            1u);
+  EXPECT_EQ(ContextTypes::builtin().validate("dc_getset", json::array()).size(),
+            1u);
+}
+
+TEST(ContextTypesTest, OptionalFieldsMayBeLeftOut) {
+  json doc = {{"contexts",
+               {{"probe",
+                 {{"name", "Probe"},
+                  {"description", "Single read"},
+                  {"fields",
+                   {{{"name", "target"}, {"type", "InstrumentTarget"}},
+                    {{"name", "repeats"},
+                     {"type", "integer"},
+                     {"optional", true}}}}}}}}};
+  std::vector<ContextTypeError> errors;
+  auto types = ContextTypes::from_json(doc, errors);
+  ASSERT_TRUE(errors.empty());
+
+  EXPECT_TRUE(types.validate("probe", {{"target", {{"id", "DMM1"}}}}).empty());
+  EXPECT_TRUE(has_error_at(types.validate("probe", json::object()), "/target"));
+}
+
+TEST(ContextTypesTest, DefinitionsAreCheckedAgainstSchema) {
+  json doc = {
+      {"contexts",
+       {{"Bad-Key", {{"name", "A"}, {"description", ""}, {"fields", json::array()}}},
+        {"no_fields", {{"name", "B"}, {"description", ""}}},
+        {"reserved",
+         {{"name", "C"},
+          {"description", ""},
+          {"fields", {{{"name", "log"}, {"type", "string"}}}}}},
+        {"bad_type",
+         {{"name", "D"},
+          {"description", ""},
+          {"fields", {{{"name", "points"}, {"type", "vector<int>"}}}}}},
+        {"good",
+         {{"name", "E"},
+          {"description", ""},
+          {"fields",
+           {{{"name", "levels"}, {"type", "table<string, number[]>"}}}}}}}}};
+
+  std::vector<ContextTypeError> errors;
+  auto types = ContextTypes::from_json(doc, errors);
+  EXPECT_EQ(types.keys(), std::vector<std::string>{"good"});
+  EXPECT_TRUE(has_error_at(errors, "/contexts/Bad-Key"));
+  EXPECT_TRUE(has_error_at(errors, "/contexts/no_fields"));
+  EXPECT_TRUE(has_error_at(errors, "/contexts/reserved/fields/0"));
+  EXPECT_TRUE(has_error_at(errors, "/contexts/bad_type/fields/0"));
+
+  errors.clear();
+  ContextTypes::from_json(json::object(), errors);
+  EXPECT_EQ(errors.size(), 1u);
+}
@@ -1,11 +1,20 @@
 #include "instrument-server/ipc/DataBufferManager.hpp"
+#include "instrument-server/ipc/DataBufferManager_c_api.h"
 
 #include <algorithm>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 using namespace instserver::ipc;
 
 class DataBufferManagerTest : public ::testing::Test {
@@ -15,7 +24,11 @@ protected:
     manager_->clear_all();
   }
 
-  void TearDown() override { manager_->clear_all(); }
+  void TearDown() override {
+    manager_->set_memory_budget(0);
+    manager_->set_reclaim_handler(nullptr);
+    manager_->clear_all();
+  }
 
   DataBufferManager *manager_;
 };
@@ -274,6 +287,26 @@ TEST_F(DataBufferManagerTest, InvalidBufferId) {
   EXPECT_FALSE(metadata.has_value());
 }
 
+TEST_F(DataBufferManagerTest, RejectsOversizedElementCount) {
+  // Would wrap to a tiny byte size if multiplied unchecked
+  size_t wrapping = SIZE_MAX / sizeof(double) + 2;
+  EXPECT_EQ(manager_->create_buffer("Scope", "CMD1", DataType::FLOAT64,
+                                    wrapping),
+            "");
+
+  void *data = reinterpret_cast<void *>(1);
+  EXPECT_EQ(manager_->acquire_buffer("Scope", "CMD2", DataType::FLOAT64,
+                                     wrapping, &data),
+            "");
+  EXPECT_EQ(data, nullptr);
+
+  // Past the sanity limit without wrapping
+  EXPECT_EQ(manager_->create_buffer("Scope", "CMD3", DataType::UINT8,
+                                    SIZE_MAX / 2 + 1),
+            "");
+  EXPECT_TRUE(manager_->list_buffers().empty());
+}
+
 TEST_F(DataBufferManagerTest, ClearAll) {
   std::vector<float> data(10);
   manager_->create_buffer("I1", "C1", DataType::FLOAT32, 10, data.data());
@@ -286,3 +319,270 @@ TEST_F(DataBufferManagerTest, ClearAll) {
   EXPECT_EQ(manager_->list_buffers().size(), 0);
   EXPECT_EQ(manager_->total_memory_usage(), 0);
 }
+
+TEST_F(DataBufferManagerTest, ReleasedBufferCannotBeAttached) {
+  std::vector<double> data = {1.0, 2.0};
+  std::string buffer_id = manager_->create_buffer(
+      "I1", "C1", DataType::FLOAT64, data.size(), data.data());
+
+  manager_->release_buffer(buffer_id);
+
+  // Segment is pooled or unlinked; either way the ID is dead
+  EXPECT_EQ(manager_->get_buffer(buffer_id), nullptr);
+}
+
+TEST_F(DataBufferManagerTest, PoolRecyclesReleasedSegments) {
+  auto before = manager_->pool_stats();
+  std::vector<float> data(1000, 1.0f);
+
+  std::string first = manager_->create_buffer("I1", "C1", DataType::FLOAT32,
+                                              data.size(), data.data());
+  manager_->release_buffer(first);
+
+  auto pooled = manager_->pool_stats();
+  EXPECT_EQ(pooled.recycled, before.recycled + 1);
+  EXPECT_EQ(pooled.pooled_segments, 1u);
+  EXPECT_EQ(pooled.pooled_bytes, 4096u);
+  EXPECT_EQ(manager_->total_memory_usage(), 4096u);
+
+  // Same size class, so the segment is reused under a new ID
+  std::string second =
+      manager_->create_buffer("I1", "C2", DataType::FLOAT32, 900, nullptr);
+  auto after = manager_->pool_stats();
+  EXPECT_EQ(after.hits, before.hits + 1);
+  EXPECT_EQ(after.pooled_segments, 0u);
+  EXPECT_NE(second, first);
+  EXPECT_EQ(second.rfind(first, 0), 0u);
+
+  // create_buffer without data still hands out zeroed memory
+  auto buffer = manager_->get_buffer(second);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(buffer->as_float32()[0], 0.0f);
+  EXPECT_EQ(manager_->get_buffer(first), nullptr);
+  EXPECT_EQ(manager_->get_metadata(second)->command_id, "C2");
+}
+
+TEST_F(DataBufferManagerTest, PoolLimitEvicts) {
+  manager_->set_pool_limit(0);
+  auto before = manager_->pool_stats();
+
+  std::string id =
+      manager_->create_buffer("I1", "C1", DataType::UINT8, 100, nullptr);
+  manager_->release_buffer(id);
+
+  auto after = manager_->pool_stats();
+  EXPECT_EQ(after.evicted, before.evicted + 1);
+  EXPECT_EQ(after.pooled_segments, 0u);
+  EXPECT_EQ(manager_->total_memory_usage(), 0u);
+
+  manager_->set_pool_limit(256 * 1024 * 1024);
+}
+
+TEST_F(DataBufferManagerTest, AcquireThenCommit) {
+  char buffer_id[128];
+  float *samples = nullptr;
+  ASSERT_EQ(data_buffer_acquire("Scope", "CMD1", 0, 4096,
+                                reinterpret_cast<void **>(&samples), buffer_id),
+            0);
+  ASSERT_NE(samples, nullptr);
+
+  // Not visible until committed
+  EXPECT_EQ(manager_->get_buffer(buffer_id), nullptr);
+  EXPECT_FALSE(manager_->get_metadata(buffer_id).has_value());
+
+  for (size_t i = 0; i < 4096; ++i) {
+    samples[i] = static_cast<float>(i);
+  }
+  ASSERT_EQ(data_buffer_commit(buffer_id), 0);
+  EXPECT_NE(data_buffer_abort(buffer_id), 0);
+
+  auto buffer = manager_->get_buffer(buffer_id);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(buffer->as_float32(), samples);
+  EXPECT_EQ(buffer->as_float32()[1234], 1234.0f);
+  EXPECT_EQ(manager_->get_metadata(buffer_id)->byte_size, 4096 * sizeof(float));
+}
+
+TEST_F(DataBufferManagerTest, AbortDiscardsAcquiredBuffer) {
+  char buffer_id[128];
+  void *data = nullptr;
+  ASSERT_EQ(data_buffer_acquire("Scope", "CMD1", 1, 16, &data, buffer_id), 0);
+
+  ASSERT_EQ(data_buffer_abort(buffer_id), 0);
+  EXPECT_TRUE(manager_->list_buffers().empty());
+  EXPECT_NE(data_buffer_commit(buffer_id), 0);
+  EXPECT_EQ(manager_->get_buffer(buffer_id), nullptr);
+}
+
+TEST_F(DataBufferManagerTest, BudgetRejectsAfterTimeout) {
+  manager_->set_memory_budget(1024 * 1024);
+  manager_->set_backpressure_timeout(std::chrono::milliseconds(50));
+  auto before = manager_->budget_stats();
+
+  std::string first =
+      manager_->create_buffer("I1", "C1", DataType::UINT8, 600 * 1024);
+  ASSERT_FALSE(first.empty());
+
+  // Nothing frees up within the timeout
+  EXPECT_TRUE(
+      manager_->create_buffer("I1", "C2", DataType::UINT8, 600 * 1024).empty());
+  // Can never fit
+  EXPECT_TRUE(
+      manager_->create_buffer("I1", "C3", DataType::UINT8, 2048 * 1024)
+          .empty());
+
+  auto after = manager_->budget_stats();
+  EXPECT_EQ(after.rejections, before.rejections + 2);
+  EXPECT_EQ(after.waits, before.waits + 1);
+  EXPECT_EQ(after.resident_bytes, 600u * 1024);
+
+  manager_->release_buffer(first);
+  EXPECT_FALSE(
+      manager_->create_buffer("I1", "C4", DataType::UINT8, 600 * 1024).empty());
+}
+
+TEST_F(DataBufferManagerTest, ReclaimHandlerUnblocksCreator) {
+  manager_->set_memory_budget(1024 * 1024);
+  manager_->set_backpressure_timeout(std::chrono::milliseconds(5000));
+
+  std::string first =
+      manager_->create_buffer("I1", "C1", DataType::UINT8, 600 * 1024);
+  int calls = 0;
+  manager_->set_reclaim_handler([&](std::chrono::milliseconds) {
+    calls++;
+    manager_->release_buffer(first);
+  });
+
+  EXPECT_FALSE(
+      manager_->create_buffer("I1", "C2", DataType::UINT8, 600 * 1024).empty());
+  EXPECT_EQ(calls, 1);
+}
+
+#ifndef _WIN32
+TEST_F(DataBufferManagerTest, AttachFromAnotherProcess) {
+  int to_parent[2];
+  int to_child[2];
+  ASSERT_EQ(pipe(to_parent), 0);
+  ASSERT_EQ(pipe(to_child), 0);
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // Child plays the worker: create the buffer and wait until the parent
+    // has looked at it. _exit skips cleanup, like a worker still running.
+    std::vector<float> samples(1000);
+    for (size_t i = 0; i < samples.size(); ++i)
+      samples[i] = static_cast<float>(i) * 0.5f;
+    std::string id = DataBufferManager::instance().create_buffer(
+        "ChildScope", "cmd_7", DataType::FLOAT32, samples.size(),
+        samples.data());
+    char out[128] = {};
+    std::strncpy(out, id.c_str(), sizeof(out) - 1);
+    (void)!write(to_parent[1], out, sizeof(out));
+    char done;
+    (void)!read(to_child[0], &done, 1);
+    _exit(0);
+  }
+
+  char id_buf[128] = {};
+  ASSERT_EQ(read(to_parent[0], id_buf, sizeof(id_buf)),
+            static_cast<ssize_t>(sizeof(id_buf)));
+  std::string buffer_id(id_buf);
+
+  std::vector<std::string> released;
+  manager_->set_release_handler(
+      "ChildScope", [&](const std::string &id) { released.push_back(id); });
+
+  auto buffer = manager_->get_buffer(buffer_id);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_TRUE(buffer->read_only());
+  EXPECT_EQ(buffer->element_count(), 1000u);
+  EXPECT_FLOAT_EQ(buffer->as_float32()[10], 5.0f);
+
+  auto metadata = manager_->get_metadata(buffer_id);
+  ASSERT_TRUE(metadata.has_value());
+  EXPECT_EQ(metadata->instrument_name, "ChildScope");
+  EXPECT_EQ(metadata->command_id, "cmd_7");
+
+  manager_->release_buffer(buffer_id);
+  ASSERT_EQ(released.size(), 1u);
+  EXPECT_EQ(released[0], buffer_id);
+
+  manager_->clear_release_handler("ChildScope");
+  (void)!write(to_child[1], "x", 1);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  boost::interprocess::shared_memory_object::remove(buffer_id.c_str());
+}
+#endif
+
+#ifndef _WIN32
+TEST_F(DataBufferManagerTest, SpillsIdleAdoptedBuffers) {
+  constexpr size_t COUNT = 64 * 1024; // 512 KB of doubles
+  int to_parent[2];
+  int to_child[2];
+  ASSERT_EQ(pipe(to_parent), 0);
+  ASSERT_EQ(pipe(to_child), 0);
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // Child plays the worker and keeps its segments until told to exit
+    char ids[3][128] = {};
+    for (int b = 0; b < 3; ++b) {
+      std::vector<double> samples(COUNT, static_cast<double>(b + 1));
+      std::string id = DataBufferManager::instance().create_buffer(
+          "Digitizer", "cmd", DataType::FLOAT64, COUNT, samples.data());
+      std::strncpy(ids[b], id.c_str(), sizeof(ids[b]) - 1);
+    }
+    (void)!write(to_parent[1], ids, sizeof(ids));
+    char done;
+    (void)!read(to_child[0], &done, 1);
+    _exit(0);
+  }
+
+  char ids[3][128] = {};
+  ASSERT_EQ(read(to_parent[0], ids, sizeof(ids)),
+            static_cast<ssize_t>(sizeof(ids)));
+
+  auto spill_dir = std::filesystem::temp_directory_path() /
+                   ("dbm_spill_test_" + std::to_string(getpid()));
+  manager_->set_spill_directory(spill_dir.string());
+  manager_->set_memory_budget(1024 * 1024);
+  std::vector<std::string> released;
+  manager_->set_release_handler(
+      "Digitizer", [&](const std::string &id) { released.push_back(id); });
+
+  for (auto &id : ids) {
+    ASSERT_TRUE(manager_->adopt_buffer(id));
+  }
+
+  // Least recently used ones went to disk and their segments were handed
+  // back, leaving the creator room for one more buffer of the same size
+  auto stats = manager_->budget_stats();
+  EXPECT_EQ(stats.spills, 2u);
+  EXPECT_EQ(stats.spilled_bytes, 2 * COUNT * sizeof(double));
+  EXPECT_LE(stats.resident_bytes, 1024u * 1024 - COUNT * sizeof(double));
+  ASSERT_EQ(released.size(), 2u);
+  EXPECT_EQ(released[0], ids[0]);
+  EXPECT_EQ(released[1], ids[1]);
+
+  // Transparently mapped back from the spill file
+  auto buffer = manager_->get_buffer(ids[0]);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_DOUBLE_EQ(buffer->as_float64()[COUNT - 1], 1.0);
+  EXPECT_EQ(manager_->budget_stats().restores, 1u);
+  manager_->release_buffer(ids[0]);
+
+  manager_->clear_all();
+  manager_->clear_release_handler("Digitizer");
+  (void)!write(to_child[1], "x", 1);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  for (auto &id : ids) {
+    boost::interprocess::shared_memory_object::remove(id);
+  }
+  EXPECT_TRUE(std::filesystem::is_empty(spill_dir));
+  std::filesystem::remove_all(spill_dir);
+}
+#endif
@@ -0,0 +1,102 @@
+#include "instrument-server/ipc/DataBufferManager.hpp"
+#include "instrument-server/server/DataHandle.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace instserver;
+using namespace instserver::ipc;
+
+class DataHandleTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    manager_ = &DataBufferManager::instance();
+    manager_->clear_all();
+  }
+
+  void TearDown() override { manager_->clear_all(); }
+
+  DataBufferManager *manager_;
+};
+
+TEST_F(DataHandleTest, ReadsBufferInPlace) {
+  std::vector<float> samples = {3.0f, -1.0f, 4.0f, 1.5f, 9.0f};
+  std::string buffer_id =
+      manager_->create_buffer("Scope", "GET_DATA", DataType::FLOAT32,
+                              samples.size(), samples.data());
+  ASSERT_FALSE(buffer_id.empty());
+
+  auto handle = DataHandle::from_buffer(buffer_id);
+  ASSERT_TRUE(handle.has_value());
+  EXPECT_EQ(handle->id(), buffer_id);
+  EXPECT_EQ(handle->size(), samples.size());
+  EXPECT_STREQ(handle->data_type(), "float32");
+
+  // The view reads the buffer's own pages
+  auto buffer = manager_->get_buffer(buffer_id);
+  ASSERT_NE(buffer, nullptr);
+  buffer->as_float32()[0] = 2.0f;
+  EXPECT_DOUBLE_EQ(*handle->at(0), 2.0);
+  manager_->release_buffer(buffer_id);
+
+  EXPECT_DOUBLE_EQ(*handle->at(4), 9.0);
+  EXPECT_FALSE(handle->at(5).has_value());
+  EXPECT_DOUBLE_EQ(handle->sum(), 15.5);
+  EXPECT_DOUBLE_EQ(handle->mean(), 3.1);
+  EXPECT_DOUBLE_EQ(handle->min(), -1.0);
+  EXPECT_DOUBLE_EQ(handle->max(), 9.0);
+}
+
+TEST_F(DataHandleTest, SliceSharesStorage) {
+  std::vector<int32_t> samples = {10, 20, 30, 40, 50, 60};
+  std::string buffer_id = manager_->create_buffer(
+      "Counter", "READ", DataType::INT32, samples.size(), samples.data());
+
+  auto handle = DataHandle::from_buffer(buffer_id);
+  ASSERT_TRUE(handle.has_value());
+
+  DataHandle middle = handle->slice(1, 3);
+  EXPECT_EQ(middle.size(), 3u);
+  EXPECT_DOUBLE_EQ(*middle.at(0), 20.0);
+  EXPECT_DOUBLE_EQ(middle.sum(), 90.0);
+  EXPECT_EQ(middle.to_vector(), (std::vector<double>{20.0, 30.0, 40.0}));
+
+  // Out-of-range slices are clamped
+  EXPECT_EQ(handle->slice(4, 10).size(), 2u);
+  EXPECT_EQ(handle->slice(10, 1).size(), 0u);
+  EXPECT_TRUE(std::isnan(handle->slice(10, 1).mean()));
+}
+
+TEST_F(DataHandleTest, LastViewReleasesBuffer) {
+  std::vector<double> samples(1024, 0.5);
+  std::string buffer_id = manager_->create_buffer(
+      "Scope", "GET_DATA", DataType::FLOAT64, samples.size(), samples.data());
+
+  {
+    auto handle = DataHandle::from_buffer(buffer_id);
+    ASSERT_TRUE(handle.has_value());
+    DataHandle tail = handle->slice(512, 512);
+    handle.reset();
+    EXPECT_DOUBLE_EQ(tail.sum(), 256.0);
+  }
+
+  // Only the creator's reference is left
+  manager_->release_buffer(buffer_id);
+  auto buffers = manager_->list_buffers();
+  EXPECT_EQ(std::find(buffers.begin(), buffers.end(), buffer_id),
+            buffers.end());
+}
+
+TEST_F(DataHandleTest, UnknownBuffer) {
+  EXPECT_FALSE(DataHandle::from_buffer("no_such_buffer").has_value());
+}
+
+TEST_F(DataHandleTest, InlineArray) {
+  DataHandle handle(std::vector<double>{1.0, 2.0, 6.0});
+  EXPECT_TRUE(handle.id().empty());
+  EXPECT_EQ(handle.size(), 3u);
+  EXPECT_DOUBLE_EQ(handle.mean(), 3.0);
+  EXPECT_DOUBLE_EQ(*handle.slice(2, 1).at(0), 6.0);
+}
@@ -0,0 +1,119 @@
+#include "instrument-server/ipc/EventReactor.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace instserver::ipc;
+
+namespace {
+
+bool wait_for(const std::atomic<int> &value, int expected) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (value.load() < expected) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+} // namespace
+
+#if defined(__linux__)
+
+TEST(EventReactor, DoorbellWakesHandler) {
+  auto &reactor = EventReactor::instance();
+  int doorbell = EventReactor::make_doorbell();
+  ASSERT_GE(doorbell, 0);
+
+  std::atomic<int> readable{0};
+  int owner = 0;
+  ASSERT_TRUE(reactor.add(&owner, doorbell, -1,
+                          {[&]() { readable++; }, nullptr}));
+
+  EventReactor::ring_doorbell(doorbell);
+  EXPECT_TRUE(wait_for(readable, 1));
+
+  // Rings after removal are not delivered
+  reactor.remove(&owner);
+  int seen = readable.load();
+  EventReactor::ring_doorbell(doorbell);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(readable.load(), seen);
+
+  close(doorbell);
+}
+
+TEST(EventReactor, ReportsProcessExitOnce) {
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    usleep(50000);
+    _exit(0);
+  }
+
+  int exit_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+  if (exit_fd < 0) {
+    waitpid(pid, nullptr, 0);
+    GTEST_SKIP() << "pidfd_open not supported";
+  }
+
+  auto &reactor = EventReactor::instance();
+  int doorbell = EventReactor::make_doorbell();
+  std::atomic<int> readable{0};
+  std::atomic<int> exited{0};
+  int owner = 0;
+  ASSERT_TRUE(reactor.add(&owner, doorbell, exit_fd,
+                          {[&]() { readable++; }, [&]() { exited++; }}));
+
+  EXPECT_TRUE(wait_for(exited, 1));
+  EXPECT_GE(readable.load(), 1); // Drained before the exit is reported
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(exited.load(), 1);
+
+  reactor.remove(&owner);
+  waitpid(pid, nullptr, 0);
+  close(exit_fd);
+  close(doorbell);
+}
+
+TEST(EventReactor, RemoveWaitsForRunningHandler) {
+  auto &reactor = EventReactor::instance();
+  int doorbell = EventReactor::make_doorbell();
+
+  std::atomic<int> started{0};
+  std::atomic<bool> finished{false};
+  int owner = 0;
+  ASSERT_TRUE(reactor.add(&owner, doorbell, -1,
+                          {[&]() {
+                             started++;
+                             std::this_thread::sleep_for(
+                                 std::chrono::milliseconds(100));
+                             finished = true;
+                           },
+                           nullptr}));
+
+  EventReactor::ring_doorbell(doorbell);
+  ASSERT_TRUE(wait_for(started, 1));
+  reactor.remove(&owner);
+  EXPECT_TRUE(finished.load());
+
+  close(doorbell);
+}
+
+#else
+
+TEST(EventReactor, UnsupportedPlatform) {
+  EXPECT_FALSE(EventReactor::supported());
+  EXPECT_EQ(EventReactor::make_doorbell(), -1);
+}
+
+#endif
@@ -30,8 +30,7 @@ TEST(IPCQueue, SendReceive) {
   msg.type = IPCMessage::Type::COMMAND;
   msg.id = 42;
   msg.sync_token = 0;
-  msg.payload_size = 5;
-  std::memcpy(msg.payload, "test", 5);
+  msg.payload = "test";
 
   bool sent = server_queue->send(msg, std::chrono::milliseconds(1000));
   ASSERT_TRUE(sent);
@@ -41,7 +40,7 @@ TEST(IPCQueue, SendReceive) {
   ASSERT_TRUE(received.has_value());
   EXPECT_EQ(received->type, IPCMessage::Type::COMMAND);
   EXPECT_EQ(received->id, 42);
-  EXPECT_EQ(std::string(received->payload), "test");
+  EXPECT_EQ(received->payload, "test");
 
   SharedQueue::cleanup(name);
 }
@@ -58,3 +57,176 @@ TEST(IPCQueue, Timeout) {
 
   SharedQueue::cleanup(name);
 }
+
+TEST(IPCQueue, SpscRingSendReceive) {
+  std::string name = "test_queue_ring_1";
+
+  auto server_queue =
+      SharedQueue::create_server_queue(name, QueueTransport::SPSC_RING);
+  auto worker_queue = SharedQueue::create_worker_queue(name);
+
+  ASSERT_NE(server_queue, nullptr);
+  ASSERT_NE(worker_queue, nullptr);
+  EXPECT_EQ(server_queue->transport(), QueueTransport::SPSC_RING);
+  EXPECT_EQ(worker_queue->transport(), QueueTransport::SPSC_RING);
+
+  IPCMessage msg;
+  msg.type = IPCMessage::Type::COMMAND;
+  msg.id = 7;
+  msg.payload = "ring";
+  ASSERT_TRUE(server_queue->send(msg, std::chrono::milliseconds(1000)));
+
+  auto received = worker_queue->receive(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(received.has_value());
+  EXPECT_EQ(received->id, 7);
+  EXPECT_EQ(received->payload, "ring");
+
+  // Reply travels on the other ring
+  IPCMessage reply;
+  reply.type = IPCMessage::Type::RESPONSE;
+  reply.id = 7;
+  ASSERT_TRUE(worker_queue->send(reply, std::chrono::milliseconds(1000)));
+  auto got = server_queue->receive(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(got.has_value());
+  EXPECT_EQ(got->type, IPCMessage::Type::RESPONSE);
+
+  SharedQueue::cleanup(name);
+}
+
+TEST(IPCQueue, SpscRingTimeoutAndFull) {
+  std::string name = "test_queue_ring_2";
+
+  auto server_queue =
+      SharedQueue::create_server_queue(name, QueueTransport::SPSC_RING);
+  ASSERT_NE(server_queue, nullptr);
+
+  EXPECT_FALSE(server_queue->receive(std::chrono::milliseconds(50)));
+
+  // Nobody drains the request ring: it fills, then send times out
+  IPCMessage msg;
+  for (uint32_t i = 0; i < SPSC_RING_SLOTS; ++i) {
+    msg.id = i;
+    ASSERT_TRUE(server_queue->send(msg, std::chrono::milliseconds(10)));
+  }
+  EXPECT_FALSE(server_queue->send(msg, std::chrono::milliseconds(50)));
+
+  SharedQueue::cleanup(name);
+}
+
+TEST(IPCQueue, SpscRingWakesBlockedReceiver) {
+  std::string name = "test_queue_ring_3";
+
+  auto server_queue =
+      SharedQueue::create_server_queue(name, QueueTransport::SPSC_RING);
+  auto worker_queue = SharedQueue::create_worker_queue(name);
+
+  constexpr uint64_t count = 1000;
+  std::thread consumer([&]() {
+    for (uint64_t i = 0; i < count; ++i) {
+      auto msg = worker_queue->receive(std::chrono::milliseconds(2000));
+      ASSERT_TRUE(msg.has_value());
+      EXPECT_EQ(msg->id, i);
+    }
+  });
+
+  for (uint64_t i = 0; i < count; ++i) {
+    IPCMessage msg;
+    msg.id = i;
+    ASSERT_TRUE(server_queue->send(msg, std::chrono::milliseconds(2000)));
+    if (i % 100 == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  consumer.join();
+  SharedQueue::cleanup(name);
+}
+
+TEST(IPCQueue, WorkerFallsBackToMessageQueue) {
+  std::string name = "test_queue_ring_4";
+
+  // A ring left from an earlier run must not win over the server's choice
+  SharedQueue::create_server_queue(name, QueueTransport::SPSC_RING);
+  auto server_queue = SharedQueue::create_server_queue(name);
+  auto worker_queue = SharedQueue::create_worker_queue(name);
+  EXPECT_EQ(worker_queue->transport(), QueueTransport::MESSAGE_QUEUE);
+
+  EXPECT_EQ(parse_queue_transport("spsc_ring"), QueueTransport::SPSC_RING);
+  EXPECT_FALSE(parse_queue_transport("bogus").has_value());
+
+  SharedQueue::cleanup(name);
+}
+
+static void expect_large_round_trip(QueueTransport transport,
+                                    const std::string &name) {
+  auto server_queue = SharedQueue::create_server_queue(name, transport);
+  auto worker_queue = SharedQueue::create_worker_queue(name);
+
+  // Spans many frames and does not land on a frame boundary
+  std::string payload(25 * IPC_MAX_FRAME_BODY + 123, '\0');
+  for (size_t i = 0; i < payload.size(); ++i)
+    payload[i] = static_cast<char>('a' + i % 26);
+
+  IPCMessage big;
+  big.type = IPCMessage::Type::COMMAND;
+  big.id = 99;
+  big.sync_token = 5;
+  big.payload = payload;
+  ASSERT_TRUE(server_queue->send(big, std::chrono::milliseconds(1000)));
+
+  IPCMessage small;
+  small.type = IPCMessage::Type::SYNC_CONTINUE;
+  small.id = 100;
+  ASSERT_TRUE(server_queue->send(small, std::chrono::milliseconds(1000)));
+
+  auto received = worker_queue->receive(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(received.has_value());
+  EXPECT_EQ(received->id, 99);
+  EXPECT_EQ(received->sync_token, 5);
+  EXPECT_EQ(received->payload, payload);
+
+  auto next = worker_queue->receive(std::chrono::milliseconds(1000));
+  ASSERT_TRUE(next.has_value());
+  EXPECT_EQ(next->type, IPCMessage::Type::SYNC_CONTINUE);
+  EXPECT_TRUE(next->payload.empty());
+
+  SharedQueue::cleanup(name);
+}
+
+TEST(IPCQueue, MultiFramePayloadMessageQueue) {
+  expect_large_round_trip(QueueTransport::MESSAGE_QUEUE, "test_queue_frame_1");
+}
+
+TEST(IPCQueue, MultiFramePayloadSpscRing) {
+  expect_large_round_trip(QueueTransport::SPSC_RING, "test_queue_frame_2");
+}
+
+static void expect_send_depth(QueueTransport transport,
+                              const std::string &name, size_t capacity) {
+  auto server_queue = SharedQueue::create_server_queue(name, transport);
+  auto worker_queue = SharedQueue::create_worker_queue(name);
+  EXPECT_EQ(server_queue->send_capacity(), capacity);
+  EXPECT_EQ(server_queue->send_depth(), 0u);
+
+  IPCMessage msg;
+  msg.type = IPCMessage::Type::COMMAND;
+  for (uint64_t i = 0; i < 3; ++i) {
+    msg.id = i;
+    ASSERT_TRUE(server_queue->send(msg, std::chrono::milliseconds(100)));
+  }
+  EXPECT_EQ(server_queue->send_depth(), 3u);
+  EXPECT_EQ(worker_queue->send_depth(), 0u);
+
+  ASSERT_TRUE(worker_queue->receive(std::chrono::milliseconds(100)));
+  EXPECT_EQ(server_queue->send_depth(), 2u);
+
+  SharedQueue::cleanup(name);
+}
+
+TEST(IPCQueue, SendDepthMessageQueue) {
+  expect_send_depth(QueueTransport::MESSAGE_QUEUE, "test_queue_depth_1", 100);
+}
+
+TEST(IPCQueue, SendDepthSpscRing) {
+  expect_send_depth(QueueTransport::SPSC_RING, "test_queue_depth_2",
+                    SPSC_RING_SLOTS);
+}
@@ -0,0 +1,141 @@
+#include "instrument-server/server/InstrumentRegistry.hpp"
+#include "instrument-server/server/LuaStatePool.hpp"
+#include "instrument-server/server/SyncCoordinator.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace instserver;
+
+class LuaStatePoolTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    script_path_ = std::filesystem::temp_directory_path() /
+                   ("lua_pool_test_" + std::to_string(now) + ".lua");
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove(script_path_, ec);
+  }
+
+  std::string write_script(const std::string &source) {
+    std::ofstream out(script_path_);
+    out << source;
+    return script_path_.string();
+  }
+
+  std::filesystem::path script_path_;
+};
+
+TEST_F(LuaStatePoolTest, PrewarmsAndReusesStates) {
+  LuaStatePool pool(1);
+  EXPECT_EQ(pool.created(), 1u);
+  EXPECT_EQ(pool.idle(), 1u);
+
+  sol::state *first = nullptr;
+  {
+    auto lease = pool.acquire();
+    first = &lease.state();
+    EXPECT_EQ(pool.idle(), 0u);
+  }
+  EXPECT_EQ(pool.idle(), 1u);
+
+  auto lease = pool.acquire();
+  EXPECT_EQ(&lease.state(), first);
+  EXPECT_EQ(pool.created(), 1u);
+}
+
+TEST_F(LuaStatePoolTest, BuildsStateWhenNoneIsIdle) {
+  LuaStatePool pool(1);
+  {
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    EXPECT_NE(&a.state(), &b.state());
+    EXPECT_EQ(pool.created(), 2u);
+  }
+  // Only `capacity` states are kept
+  EXPECT_EQ(pool.idle(), 1u);
+}
+
+TEST_F(LuaStatePoolTest, ScriptGlobalsDoNotLeakIntoNextScript) {
+  LuaStatePool pool(1);
+  auto path = write_script("leaked = 42\n_G.also_leaked = 1\n"
+                           "assert(string.format('%d', 7) == '7')\n");
+  {
+    auto lease = pool.acquire();
+    auto result = lease.run_file(path);
+    ASSERT_TRUE(result.valid());
+    EXPECT_EQ(lease.environment()["leaked"].get<int>(), 42);
+  }
+
+  auto path2 = write_script("return leaked == nil and also_leaked == nil\n");
+  auto lease = pool.acquire();
+  auto result = lease.run_file(path2);
+  ASSERT_TRUE(result.valid());
+  EXPECT_TRUE(result.get<bool>());
+}
+
+TEST_F(LuaStatePoolTest, ContextIsBoundPerLease) {
+  LuaStatePool pool(1);
+  auto &registry = InstrumentRegistry::instance();
+  SyncCoordinator sync;
+
+  std::weak_ptr<RuntimeContext> weak;
+  {
+    auto lease = pool.acquire();
+    auto ctx = lease.bind_context(registry, sync);
+    weak = ctx;
+    auto result = lease.run_file(
+        write_script("context:log('pooled')\nreturn context ~= nil\n"));
+    ASSERT_TRUE(result.valid());
+    EXPECT_TRUE(result.get<bool>());
+  }
+  // Releasing the state drops the script's reference to its context
+  EXPECT_TRUE(weak.expired());
+
+  auto lease = pool.acquire();
+  auto result = lease.run_file(write_script("return context == nil\n"));
+  ASSERT_TRUE(result.valid());
+  EXPECT_TRUE(result.get<bool>());
+}
+
+TEST_F(LuaStatePoolTest, ContextPayloadIsPassedToReturnedFunction) {
+  LuaStatePool pool(1);
+  auto &registry = InstrumentRegistry::instance();
+  SyncCoordinator sync;
+  auto path = write_script(R"(
+return function(ctx)
+  ctx.log("payload " .. ctx.setters[1].id)
+  assert(type(ctx.call) == "function" and type(ctx.parallel) == "function")
+  return ctx.numPoints + ctx.setters[1].channel + ctx.setVoltages["DAC1:3"]
+end
+)");
+  nlohmann::json fields = {{"setters", {{{"id", "DAC1"}, {"channel", 3}}}},
+                           {"setVoltages", {{"DAC1:3", 0.5}}},
+                           {"numPoints", 10}};
+
+  // Same compiled script, different parameters
+  for (int points : {10, 20}) {
+    fields["numPoints"] = points;
+    auto lease = pool.acquire();
+    lease.bind_context(registry, sync);
+    auto result = lease.run_file(path, fields);
+    ASSERT_TRUE(result.valid());
+    EXPECT_DOUBLE_EQ(result.get<double>(), points + 3.5);
+  }
+}
+
+TEST_F(LuaStatePoolTest, ContextPayloadNeedsScriptToReturnFunction) {
+  LuaStatePool pool(1);
+  auto &registry = InstrumentRegistry::instance();
+  SyncCoordinator sync;
+  auto lease = pool.acquire();
+  lease.bind_context(registry, sync);
+  EXPECT_THROW(lease.run_file(write_script("return 1\n"),
+                              nlohmann::json::object()),
+               sol::error);
+}
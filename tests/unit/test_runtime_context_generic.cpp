@@ -1,4 +1,6 @@
+#include "PlatformPaths.hpp"
 #include "instrument-server/Logger.hpp"
+#include "instrument-server/plugin/PluginRegistry.hpp"
 #include "instrument-server/server/InstrumentRegistry.hpp"
 #include "instrument-server/server/RuntimeContext.hpp"
 #include "instrument-server/server/SyncCoordinator.hpp"
@@ -7,6 +9,7 @@
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
 #include <sol/sol.hpp>
 #include <spdlog/spdlog.h>
 #include <thread>
@@ -199,3 +202,120 @@ TEST_F(RuntimeContextGenericTest, NestedCallsProduceUserLogsInOrder) {
   EXPECT_LT(pos_main, pos_helper);
   EXPECT_LT(pos_helper, pos_done);
 }
+
+// Test: bind() rejects malformed names the same way call() does
+TEST_F(RuntimeContextGenericTest, BindRejectsMalformedName) {
+  lua_->script(R"(
+    bound_is_nil = context:bind("NoVerb") == nil
+  )");
+
+  EXPECT_TRUE((*lua_)["bound_is_nil"].get<bool>());
+  expect_log_contains("Invalid function name format: NoVerb");
+}
+
+// Test: a bound function records each call exactly as context:call() would
+TEST_F(RuntimeContextGenericTest, BoundFunctionRecordsCallsLikeCall) {
+  auto ctx = std::make_unique<RuntimeContext>(*registry_, *sync_coordinator_);
+  (*lua_)["context"] = ctx.get();
+
+  lua_->script(R"(
+    local set = context:bind("Inst1:2.Command")
+    for i = 1, 3 do
+      set(i * 0.5)
+    end
+    context:call("Inst1:2.Command", 2.0)
+  )");
+
+  const auto &results = ctx->get_results();
+  ASSERT_EQ(results.size(), 4u);
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].instrument_name, "Inst1:2");
+    EXPECT_EQ(results[i].verb, "Command");
+    EXPECT_FALSE(results[i].success);
+    EXPECT_EQ(results[i].error_message, "Instrument not found: Inst1");
+    EXPECT_EQ(std::get<int64_t>(results[i].params.at("channel")), 2);
+    EXPECT_DOUBLE_EQ(std::get<double>(results[i].params.at("arg0")),
+                     0.5 * static_cast<double>(i + 1));
+  }
+}
+
+// Exposes call-site resolution so the FFI entry point can be driven directly
+class NativeCallContext : public RuntimeContext {
+public:
+  using RuntimeContext::resolve_call_site;
+  using RuntimeContext::RuntimeContext;
+};
+
+// Test: the FFI entry point records calls exactly as context:call() would
+TEST_F(RuntimeContextGenericTest, NativeCallRecordsCallsLikeCall) {
+  NativeCallContext ctx(*registry_, *sync_coordinator_);
+  CallSite *site = ctx.resolve_call_site("Inst1:2.Command");
+  ASSERT_NE(site, nullptr);
+  RuntimeContext::NativeCall call{&ctx, site};
+
+  double args[] = {1.5, -3.0};
+  double result = 0.0;
+  EXPECT_EQ(isrv_call_d(&call, args, 2, &result), -1);
+
+  const auto &results = ctx.get_results();
+  ASSERT_EQ(results.size(), 1u);
+  EXPECT_EQ(results[0].instrument_name, "Inst1:2");
+  EXPECT_EQ(results[0].verb, "Command");
+  EXPECT_EQ(results[0].error_message, "Instrument not found: Inst1");
+  EXPECT_DOUBLE_EQ(std::get<double>(results[0].params.at("arg0")), 1.5);
+  EXPECT_DOUBLE_EQ(std::get<double>(results[0].params.at("arg1")), -3.0);
+  EXPECT_EQ(std::get<int64_t>(results[0].params.at("channel")), 2);
+
+  // Bad handles and argument counts are rejected without calling
+  EXPECT_EQ(isrv_call_d(nullptr, args, 1, &result), -1);
+  EXPECT_EQ(isrv_call_d(&call, args, -1, &result), -1);
+  EXPECT_EQ(ctx.get_results().size(), 1u);
+}
+
+#ifdef INSTRUMENT_SERVER_LUAJIT
+// Test: bind() hands numeric commands to the FFI binder, whose function
+// falls back to the sol2 path for anything it cannot pass as doubles
+TEST_F(RuntimeContextGenericTest, BindUsesFfiFastPathForNumericCommands) {
+  auto plugin_path = test::get_test_plugin_path("mock_visa_plugin");
+  if (!std::filesystem::exists(plugin_path))
+    GTEST_SKIP() << "Mock VISA plugin not found at: " << plugin_path;
+  plugin::PluginRegistry::instance().load_plugin("VISA", plugin_path.string());
+
+  // No outputs, so the command is callable through the FFI
+  nlohmann::json api_def = {
+      {"protocol", {{"type", "VISA"}}},
+      {"commands", {{"SET", {{"parameters", nlohmann::json::array()}}}}}};
+  nlohmann::json config = {
+      {"name", "FastInst"},
+      {"connection", {{"type", "VISA"}, {"address", "mock://fast"}}}};
+  ASSERT_TRUE(registry_->create_instrument_from_json(
+      "FastInst", config.dump(), api_def.dump()));
+
+  auto ctx = std::make_unique<RuntimeContext>(*registry_, *sync_coordinator_);
+  (*lua_)["context"] = ctx.get();
+  lua_->script(R"(
+    set = context:bind("FastInst.SET")
+    set(1.5, 2.5)
+    set("text")
+  )");
+
+  // The sol2 closure is a C function; the FFI one is plain Lua
+  lua_State *L = lua_->lua_state();
+  sol::object set = (*lua_)["set"];
+  set.push(L);
+  EXPECT_FALSE(lua_iscfunction(L, -1));
+  lua_pop(L, 1);
+
+  const auto &results = ctx->get_results();
+  ASSERT_EQ(results.size(), 2u);
+  EXPECT_TRUE(results[0].success) << results[0].error_message;
+  EXPECT_DOUBLE_EQ(std::get<double>(results[0].params.at("arg0")), 1.5);
+  EXPECT_DOUBLE_EQ(std::get<double>(results[0].params.at("arg1")), 2.5);
+
+  // Only the sol2 path can carry a string
+  EXPECT_TRUE(results[1].success) << results[1].error_message;
+  EXPECT_EQ(std::get<std::string>(results[1].params.at("arg0")), "text");
+
+  registry_->remove_instrument("FastInst");
+}
+#endif
@@ -0,0 +1,122 @@
+#include "instrument-server/server/ScriptCache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace instserver;
+
+class ScriptCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    script_path_ = std::filesystem::temp_directory_path() /
+                   ("script_cache_test_" + std::to_string(now) + ".lua");
+  }
+
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove(script_path_, ec);
+  }
+
+  // Write the script and move its mtime on, so a rewrite within the clock's
+  // resolution still looks modified
+  void write_script(const std::string &source) {
+    {
+      std::ofstream out(script_path_);
+      out << source;
+    }
+    bump_mtime();
+  }
+
+  void bump_mtime() {
+    stamp_ += std::chrono::seconds(1);
+    std::filesystem::last_write_time(script_path_, stamp_);
+  }
+
+  int run(ScriptCache &cache, sol::state &lua) {
+    sol::load_result chunk = cache.load(lua, script_path_.string());
+    EXPECT_TRUE(chunk.valid());
+    sol::protected_function script = chunk;
+    auto result = script();
+    EXPECT_TRUE(result.valid());
+    return result.get<int>();
+  }
+
+  std::filesystem::path script_path_;
+  std::filesystem::file_time_type stamp_ =
+      std::filesystem::file_time_type::clock::now();
+};
+
+TEST_F(ScriptCacheTest, SecondLoadUsesCachedBytecode) {
+  ScriptCache cache;
+  sol::state lua;
+  write_script("return 40 + 2\n");
+
+  EXPECT_EQ(run(cache, lua), 42);
+  EXPECT_EQ(run(cache, lua), 42);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_EQ(cache.hits(), 1u);
+
+  auto stats = cache.stats_json();
+  EXPECT_EQ(stats["entries"].get<size_t>(), 1u);
+  EXPECT_DOUBLE_EQ(stats["hit_rate"].get<double>(), 0.5);
+}
+
+TEST_F(ScriptCacheTest, SharedBetweenStates) {
+  ScriptCache cache;
+  sol::state first;
+  sol::state second;
+  write_script("return 7\n");
+
+  EXPECT_EQ(run(cache, first), 7);
+  EXPECT_EQ(run(cache, second), 7);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_EQ(cache.hits(), 1u);
+}
+
+TEST_F(ScriptCacheTest, ChangedScriptIsRecompiled) {
+  ScriptCache cache;
+  sol::state lua;
+  write_script("return 1\n");
+  EXPECT_EQ(run(cache, lua), 1);
+
+  write_script("return 2\n");
+  EXPECT_EQ(run(cache, lua), 2);
+  EXPECT_EQ(cache.misses(), 2u);
+  EXPECT_EQ(cache.hits(), 0u);
+}
+
+TEST_F(ScriptCacheTest, TouchedButUnchangedScriptIsNotRecompiled) {
+  ScriptCache cache;
+  sol::state lua;
+  write_script("return 3\n");
+  EXPECT_EQ(run(cache, lua), 3);
+
+  bump_mtime();
+  EXPECT_EQ(run(cache, lua), 3);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_EQ(cache.hits(), 1u);
+}
+
+TEST_F(ScriptCacheTest, ShebangLineIsSkipped) {
+  ScriptCache cache;
+  sol::state lua;
+  write_script("#!/usr/bin/env lua\nreturn 5\n");
+  EXPECT_EQ(run(cache, lua), 5);
+}
+
+TEST_F(ScriptCacheTest, ErrorsAreReportedAndNotCached) {
+  ScriptCache cache;
+  sol::state lua;
+  write_script("return (\n");
+
+  sol::load_result broken = cache.load(lua, script_path_.string());
+  EXPECT_FALSE(broken.valid());
+
+  sol::load_result missing = cache.load(lua, script_path_.string() + ".gone");
+  EXPECT_FALSE(missing.valid());
+
+  EXPECT_EQ(cache.stats_json()["entries"].get<size_t>(), 0u);
+}
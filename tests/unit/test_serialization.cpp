@@ -57,6 +57,22 @@ TEST(Serialization, CommandWithSyncToken) {
   EXPECT_EQ(*deserialized.sync_token, 42);
 }
 
+TEST(Serialization, CommandWithSharedBarrier) {
+  SerializedCommand cmd;
+  cmd.id = "sync-cmd";
+  cmd.instrument_name = "DAC1";
+  cmd.verb = "SET";
+  cmd.sync_token = 42;
+  cmd.barrier_slot = 3;
+  cmd.barrier_epoch = 9;
+
+  SerializedCommand deserialized = deserialize_command(serialize_command(cmd));
+
+  ASSERT_TRUE(deserialized.barrier_slot.has_value());
+  EXPECT_EQ(*deserialized.barrier_slot, 3u);
+  EXPECT_EQ(deserialized.barrier_epoch, 9u);
+}
+
 TEST(Serialization, CommandWithArrayParam) {
   SerializedCommand cmd;
   cmd.id = "array-cmd";
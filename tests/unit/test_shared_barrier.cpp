@@ -0,0 +1,168 @@
+#include "instrument-server/ipc/SharedBarrier.hpp"
+
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace instserver::ipc;
+using WaitResult = SharedBarrierTable::WaitResult;
+
+namespace {
+
+std::string table_name(const char *test) {
+  return std::string("test_sync_") + test + "_" +
+         std::to_string(static_cast<long>(getpid()));
+}
+
+} // namespace
+
+TEST(SharedBarrier, ReleasesWhenAllArrive) {
+  auto table = SharedBarrierTable::create(table_name("release"));
+  ASSERT_NE(table, nullptr);
+  auto ticket = table->arm(3);
+  ASSERT_TRUE(ticket.has_value());
+
+  // Each "worker" maps the segment itself, as a worker process would
+  std::vector<std::future<WaitResult>> arrivals;
+  for (int i = 0; i < 3; ++i) {
+    arrivals.push_back(std::async(std::launch::async, [&] {
+      auto view = SharedBarrierTable::open(table->name());
+      if (!view)
+        return WaitResult::STALE;
+      return view->arrive_and_wait(*ticket, std::chrono::seconds(5));
+    }));
+  }
+  for (auto &arrival : arrivals)
+    EXPECT_EQ(arrival.get(), WaitResult::RELEASED);
+
+  table->disarm(*ticket);
+  EXPECT_EQ(table->armed_count(), 0u);
+}
+
+TEST(SharedBarrier, WaitsForLastArrival) {
+  auto table = SharedBarrierTable::create(table_name("wait"));
+  ASSERT_NE(table, nullptr);
+  auto ticket = table->arm(2);
+  ASSERT_TRUE(ticket.has_value());
+
+  auto first = std::async(std::launch::async, [&] {
+    return table->arrive_and_wait(*ticket, std::chrono::seconds(5));
+  });
+  EXPECT_EQ(first.wait_for(std::chrono::milliseconds(50)),
+            std::future_status::timeout);
+
+  EXPECT_EQ(table->arrive_and_wait(*ticket, std::chrono::seconds(5)),
+            WaitResult::RELEASED);
+  EXPECT_EQ(first.get(), WaitResult::RELEASED);
+  table->disarm(*ticket);
+}
+
+TEST(SharedBarrier, TimeoutBreaksBarrierForOthers) {
+  auto table = SharedBarrierTable::create(table_name("timeout"));
+  ASSERT_NE(table, nullptr);
+  auto ticket = table->arm(3);
+  ASSERT_TRUE(ticket.has_value());
+
+  int idle_calls = 0;
+  auto patient = std::async(std::launch::async, [&] {
+    return table->arrive_and_wait(*ticket, std::chrono::seconds(5));
+  });
+  EXPECT_EQ(table->arrive_and_wait(
+                *ticket, std::chrono::milliseconds(100),
+                [&] { idle_calls++; }, std::chrono::milliseconds(10)),
+            WaitResult::TIMED_OUT);
+  EXPECT_GT(idle_calls, 0);
+  EXPECT_EQ(patient.get(), WaitResult::BROKEN);
+
+  // A late arrival learns it is too late instead of being released
+  EXPECT_EQ(table->arrive_and_wait(*ticket, std::chrono::seconds(5)),
+            WaitResult::BROKEN);
+  table->disarm(*ticket);
+}
+
+TEST(SharedBarrier, DisarmBreaksWaitersAndRearmIgnoresOldTickets) {
+  auto table = SharedBarrierTable::create(table_name("disarm"));
+  ASSERT_NE(table, nullptr);
+  auto old_ticket = table->arm(2);
+  ASSERT_TRUE(old_ticket.has_value());
+
+  auto waiter = std::async(std::launch::async, [&] {
+    return table->arrive_and_wait(*old_ticket, std::chrono::seconds(5));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  table->disarm(*old_ticket);
+  EXPECT_EQ(waiter.get(), WaitResult::BROKEN);
+
+  // The slot comes back with a new epoch; the old ticket no longer counts
+  auto new_ticket = table->arm(1);
+  ASSERT_TRUE(new_ticket.has_value());
+  EXPECT_EQ(new_ticket->slot, old_ticket->slot);
+  EXPECT_NE(new_ticket->epoch, old_ticket->epoch);
+  EXPECT_EQ(table->arrive_and_wait(*old_ticket, std::chrono::seconds(1)),
+            WaitResult::STALE);
+  EXPECT_EQ(table->arrive_and_wait(*new_ticket, std::chrono::seconds(1)),
+            WaitResult::RELEASED);
+  table->disarm(*new_ticket);
+}
+
+TEST(SharedBarrier, RunsOutOfSlots) {
+  auto table = SharedBarrierTable::create(table_name("slots"));
+  ASSERT_NE(table, nullptr);
+
+  std::vector<SharedBarrierTicket> tickets;
+  for (uint32_t i = 0; i < SHARED_BARRIER_SLOTS; ++i) {
+    auto ticket = table->arm(2);
+    ASSERT_TRUE(ticket.has_value());
+    tickets.push_back(*ticket);
+  }
+  EXPECT_FALSE(table->arm(2).has_value());
+  EXPECT_EQ(table->armed_count(), SHARED_BARRIER_SLOTS);
+
+  table->disarm(tickets.back());
+  table->disarm(tickets.back()); // Second disarm is a no-op
+  EXPECT_EQ(table->armed_count(), SHARED_BARRIER_SLOTS - 1);
+  EXPECT_TRUE(table->arm(2).has_value());
+  EXPECT_FALSE(table->arm(2).has_value());
+
+  EXPECT_FALSE(table->arm(0).has_value());
+}
+
+#if defined(__linux__)
+
+TEST(SharedBarrier, ReleasesAcrossProcesses) {
+  auto table = SharedBarrierTable::create(table_name("fork"));
+  ASSERT_NE(table, nullptr);
+  auto ticket = table->arm(2);
+  ASSERT_TRUE(ticket.has_value());
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    auto view = SharedBarrierTable::open(table->name());
+    bool released =
+        view && view->arrive_and_wait(*ticket, std::chrono::seconds(5)) ==
+                    WaitResult::RELEASED;
+    _exit(released ? 0 : 1);
+  }
+
+  // Give the child time to park on the futex before we arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(table->arrive_and_wait(*ticket, std::chrono::seconds(5)),
+            WaitResult::RELEASED);
+
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  table->disarm(*ticket);
+}
+
+#endif
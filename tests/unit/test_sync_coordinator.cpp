@@ -1,7 +1,10 @@
 #include "instrument-server/server/SyncCoordinator.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <gtest/gtest.h>
+#include <thread>
 
 using namespace instserver;
 
@@ -107,3 +110,138 @@ TEST(SyncCoordinator, UnexpectedInstrument) {
   // ACK from instrument not in barrier
   EXPECT_FALSE(sync.handle_ack(1, "DMM1"));
 }
+
+TEST(SyncCoordinator, InternedIdsAreStable) {
+  uint32_t id = SyncCoordinator::intern_instrument("InternedDAC");
+  EXPECT_EQ(SyncCoordinator::intern_instrument("InternedDAC"), id);
+  EXPECT_NE(SyncCoordinator::intern_instrument("InternedDMM"), id);
+  EXPECT_EQ(SyncCoordinator::instrument_name(id), "InternedDAC");
+}
+
+TEST(SyncCoordinator, AcksByIdAndNameAgree) {
+  SyncCoordinator sync;
+  uint32_t dac = SyncCoordinator::intern_instrument("DAC1");
+
+  sync.register_barrier(1, {"DAC1", "DAC2"});
+  EXPECT_FALSE(sync.handle_ack(1, dac));
+  EXPECT_FALSE(sync.handle_ack(1, "DAC1")); // Same instrument - duplicate
+  EXPECT_TRUE(sync.handle_ack(1, "DAC2"));
+  EXPECT_FALSE(sync.has_barrier(1));
+}
+
+TEST(SyncCoordinator, WideBarrier) {
+  SyncCoordinator sync;
+
+  // More instruments than one 64-bit mask word holds
+  std::vector<std::string> instruments;
+  for (int i = 0; i < 150; ++i)
+    instruments.push_back("Wide" + std::to_string(i));
+  sync.register_barrier(7, instruments);
+
+  for (int i = 0; i < 149; ++i)
+    EXPECT_FALSE(sync.handle_ack(7, instruments[i]));
+
+  auto waiting = sync.get_waiting_instruments(7);
+  ASSERT_EQ(waiting.size(), 1u);
+  EXPECT_EQ(waiting[0], "Wide149");
+
+  EXPECT_TRUE(sync.handle_ack(7, instruments[149]));
+  EXPECT_EQ(sync.active_barrier_count(), 0u);
+}
+
+TEST(SyncCoordinator, ConcurrentAcksCompleteOnce) {
+  SyncCoordinator sync;
+
+  std::vector<uint32_t> ids;
+  for (int i = 0; i < 32; ++i)
+    ids.push_back(SyncCoordinator::intern_instrument("Par" + std::to_string(i)));
+
+  for (uint64_t token = 1; token <= 50; ++token) {
+    sync.register_barrier_ids(token, ids);
+
+    // Every instrument ACKs twice from its own thread
+    std::atomic<int> completions{0};
+    std::vector<std::thread> threads;
+    for (uint32_t id : ids) {
+      threads.emplace_back([&, id] {
+        for (int repeat = 0; repeat < 2; ++repeat) {
+          if (sync.handle_ack(token, id))
+            completions++;
+        }
+      });
+    }
+    for (auto &t : threads)
+      t.join();
+
+    EXPECT_EQ(completions.load(), 1);
+    EXPECT_FALSE(sync.has_barrier(token));
+  }
+}
+
+namespace {
+
+BarrierArrivalStats arrivals_of(const std::string &instrument) {
+  for (auto &stats : SyncCoordinator::arrival_stats()) {
+    if (stats.instrument == instrument)
+      return stats;
+  }
+  return {};
+}
+
+} // namespace
+
+TEST(SyncCoordinator, TokensAreUnique) {
+  SyncCoordinator sync;
+  uint64_t first = sync.next_token();
+  EXPECT_NE(sync.next_token(), first);
+}
+
+TEST(SyncCoordinator, BarrierDeadline) {
+  SyncCoordinator sync;
+  auto before = std::chrono::steady_clock::now();
+  sync.register_barrier(1, {"DAC1"}, std::chrono::milliseconds(250));
+
+  auto deadline = sync.barrier_deadline(1);
+  ASSERT_TRUE(deadline.has_value());
+  EXPECT_GE(*deadline, before + std::chrono::milliseconds(250));
+  EXPECT_FALSE(sync.barrier_deadline(2).has_value());
+}
+
+TEST(SyncCoordinator, FailBarrierReportsMissingInstruments) {
+  SyncCoordinator sync;
+  sync.register_barrier(1, {"SlowA", "SlowB", "SlowC"});
+  EXPECT_FALSE(sync.handle_ack(1, "SlowB"));
+
+  auto missing = sync.fail_barrier(1);
+  std::sort(missing.begin(), missing.end());
+  EXPECT_EQ(missing, (std::vector<std::string>{"SlowA", "SlowC"}));
+  EXPECT_FALSE(sync.has_barrier(1));
+  EXPECT_TRUE(sync.fail_barrier(1).empty());
+
+  EXPECT_EQ(arrivals_of("SlowA").timeouts, 1u);
+  EXPECT_EQ(arrivals_of("SlowB").timeouts, 0u);
+  EXPECT_EQ(arrivals_of("SlowB").arrivals, 1u);
+}
+
+TEST(SyncCoordinator, ArrivalLatencyHistogram) {
+  SyncCoordinator sync;
+  for (uint64_t token = 1; token <= 4; ++token) {
+    sync.register_barrier(token, {"FastInst", "LateInst"});
+    EXPECT_FALSE(sync.handle_ack(token, "FastInst"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_TRUE(sync.handle_ack(token, "LateInst"));
+  }
+
+  auto fast = arrivals_of("FastInst");
+  auto late = arrivals_of("LateInst");
+  EXPECT_EQ(fast.arrivals, 4u);
+  EXPECT_EQ(late.arrivals, 4u);
+  ASSERT_EQ(late.buckets.size(), BARRIER_ARRIVAL_BUCKETS);
+  EXPECT_GE(late.max_us, 5000u);
+  EXPECT_GE(late.quantile_us(0.5), 5000u);
+  EXPECT_LT(fast.quantile_us(0.5), late.quantile_us(0.5));
+
+  SyncCoordinator::reset_arrival_stats();
+  EXPECT_EQ(arrivals_of("LateInst").arrivals, 0u);
+  EXPECT_EQ(arrivals_of("LateInst").quantile_us(0.5), 0u);
+}